@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2023-2024 PostGraphDB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Portions Copyright (c) 2020-2023, Apache Software Foundation
+ * Portions Copyright (c) 2019-2020, Bitnine Global
+ */ 
+
+LOAD 'postgraph';
+SET search_path TO postgraph;
+
+CREATE GRAPH aggregation;
+USE GRAPH aggregation;
+
+CREATE TABLE agg_values (v gtype);
+
+--
+-- all NULL input never creates a transition state
+--
+INSERT INTO agg_values VALUES (NULL), (NULL), (NULL);
+
+SELECT sum(v) AS s, max(v) AS mx, min(v) AS mn FROM agg_values;
+
+--
+-- mixed integer, float and numeric input
+--
+SELECT sum(v) AS s FROM (VALUES ('1'::gtype), ('2'::gtype)) AS t(v);
+SELECT sum(v) AS s FROM (VALUES ('1'::gtype), ('2.5'::gtype)) AS t(v);
+SELECT sum(v) AS s FROM (VALUES ('1'::gtype), ('2.5'::gtype), ('1.25::numeric'::gtype)) AS t(v);
+SELECT sum(v) AS s FROM (VALUES ('1.25::numeric'::gtype), ('1'::gtype), (NULL)) AS t(v);
+SELECT max(v) AS mx, min(v) AS mn FROM (VALUES ('1'::gtype), ('2.5'::gtype), (NULL), ('2'::gtype)) AS t(v);
+
+--
+-- integer overflow promotes the sum to numeric
+--
+SELECT sum(v) AS s FROM (VALUES ('9223372036854775807'::gtype), ('1'::gtype)) AS t(v);
+
+--
+-- parallel plans combine and serialize the transition states
+--
+INSERT INTO agg_values SELECT i::int8::gtype FROM generate_series(1, 10000) AS g(i);
+ANALYZE agg_values;
+
+SET parallel_setup_cost = 0;
+SET parallel_tuple_cost = 0;
+SET min_parallel_table_scan_size = 0;
+SET max_parallel_workers_per_gather = 2;
+
+EXPLAIN (COSTS OFF) SELECT sum(v), max(v), min(v) FROM agg_values;
+
+SELECT sum(v) AS s, max(v) AS mx, min(v) AS mn FROM agg_values;
+SELECT sum(v) AS s, max(v) AS mx, min(v) AS mn FROM agg_values WHERE v IS NULL;
+
+-- percentiles, only the approximate one has a parallel plan
+EXPLAIN (COSTS OFF) SELECT percentileapprox(v, '0.5'::gtype) FROM agg_values;
+
+SELECT percentilecont(v, '0.5'::gtype) AS cont, percentiledisc(v, '0.5'::gtype) AS disc FROM agg_values;
+SELECT percentileapprox(v, '0'::gtype) AS p0, percentileapprox(v, '1'::gtype) AS p100 FROM agg_values;
+SELECT abs(percentileapprox(v, '0.5'::gtype)::float8 - 5000.5) < 50 AS close FROM agg_values;
+SELECT percentilecont(v, '0.5'::gtype) AS cont, percentiledisc(v, '0.5'::gtype) AS disc,
+       percentileapprox(v, '0.5'::gtype) AS approx
+FROM agg_values WHERE v IS NULL;
+
+-- collect, past the 32 elements after which gtype arrays store offsets
+CREATE TABLE collect_values (v gtype);
+INSERT INTO collect_values
+SELECT gtype_in(CASE i % 6
+                WHEN 0 THEN format('%s', i)
+                WHEN 1 THEN format('%s.5', i)
+                WHEN 2 THEN format('%s.25::numeric', i)
+                WHEN 3 THEN format('"s%s"', i)
+                WHEN 4 THEN format('[%s, "s%s", [%s.5, {"n": %s}]]', i, i, i, i)
+                ELSE format('{"k": %s, "l": [%s, {"m": "x%s"}], "b": true}', i, i, i)
+                END::cstring)
+FROM generate_series(1, 2000) AS g(i);
+ANALYZE collect_values;
+EXPLAIN (COSTS OFF) SELECT collect(v) FROM collect_values;
+CREATE TABLE collect_result AS SELECT collect(v) AS l FROM collect_values;
+SELECT size(l) AS n FROM collect_result;
+SELECT count(*) AS found
+FROM (SELECT DISTINCT gtype_out(r.l -> g.i)::text AS e
+      FROM collect_result r, generate_series(0, 1999) AS g(i)) AS s
+WHERE e IN (SELECT gtype_out(v)::text FROM collect_values);
+SELECT collect(v) AS c FROM collect_values WHERE v IS NULL;
+DROP TABLE collect_result;
+DROP TABLE collect_values;
+
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
+RESET min_parallel_table_scan_size;
+RESET max_parallel_workers_per_gather;
+
+--
+-- Cleanup
+--
+DROP TABLE agg_values;
+DROP GRAPH aggregation CASCADE;
+
+--
+-- End
+--
@@ -161,6 +161,18 @@ SELECT * FROM cypher('cypher_create', $$ MATCH (a:Part) RETURN a $$) as (a verte
 END;
 */
 
+--
+-- Terminal CREATE writes its entities in batches, check the batches past the
+-- first one and the last partial one reach the unique index
+--
+CREATE (:batch {k: 0});
+SELECT create_property_index('cypher_create', 'batch', 'k', true);
+UNWIND range(1, 1500) AS i CREATE (:batch {k: i});
+MATCH (n:batch) RETURN count(*);
+-- 1500 is only reached in the second batch, nothing should be created
+UNWIND range(3000, 1, -1) AS i CREATE (:batch {k: i});
+MATCH (n:batch) RETURN count(*);
+
 --
 -- Errors
 --
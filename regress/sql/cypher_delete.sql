@@ -225,6 +225,50 @@ MATCH p=()-[]->() RETURN p;
 -- Clean Up
 MATCH(n) DELETE n RETURN n;
 
+--Test 25: edge labels with start_id and end_id indexes, self-loops included
+CREATE GRAPH delete_index;
+USE GRAPH delete_index;
+CREATE (:v {i: 1})-[:e {k: 'out'}]->(:v {i: 2});
+MATCH (a:v) CREATE (a)-[:e {k: 'loop'}]->(a);
+SELECT count(*) AS indexes FROM pg_indexes
+WHERE schemaname = 'delete_index' AND tablename = 'e' AND (indexdef LIKE '%(start_id)' OR indexdef LIKE '%(end_id)');
+
+--Should Fail
+MATCH (a:v {i: 2}) DELETE a;
+
+MATCH (a:v {i: 1})-[e:e]->(a) DELETE e;
+MATCH (a:v {i: 1})-[e:e]->(b:v) RETURN e.k, b.i;
+MATCH (a:v {i: 1}) DETACH DELETE a RETURN a.i;
+
+--Should Fail, only the self-loop is left
+MATCH (a:v {i: 2}) DELETE a;
+
+MATCH (a:v {i: 2}) DETACH DELETE a RETURN a.i;
+MATCH ()-[e]->() RETURN e;
+MATCH (n) RETURN n;
+
+DROP GRAPH delete_index CASCADE;
+
+--Test 26: the graph keeps the setting it was created with
+SET postgraph.edge_endpoint_indexes = off;
+CREATE GRAPH delete_noindex;
+RESET postgraph.edge_endpoint_indexes;
+USE GRAPH delete_noindex;
+CREATE (:v {i: 1})-[:e]->(:v {i: 2});
+MATCH (a:v) CREATE (a)-[:e]->(a);
+SELECT count(*) AS indexes FROM pg_indexes
+WHERE schemaname = 'delete_noindex' AND tablename = 'e' AND (indexdef LIKE '%(start_id)' OR indexdef LIKE '%(end_id)');
+
+--Should Fail
+MATCH (a:v {i: 2}) DELETE a;
+
+MATCH (n:v) DETACH DELETE n;
+MATCH ()-[e]->() RETURN e;
+MATCH (n) RETURN n;
+
+DROP GRAPH delete_noindex CASCADE;
+USE GRAPH cypher_delete;
+
 --
 -- Clean up
 --
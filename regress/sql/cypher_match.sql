@@ -311,6 +311,24 @@ MATCH (n:e1)-[]-() RETURN n;
 
 MATCH (n:vmissing)-[]-() RETURN n;
 
+--
+-- Property maps and property indexes
+--
+CREATE (:prop_idx {k: 1}), (:prop_idx {k: 1.0}), (:prop_idx {k: 2}), (:prop_idx {k: '1'});
+SELECT create_property_index('cypher_match', 'prop_idx', 'k');
+-- Each should find 1, an integer doesn't match a float
+MATCH (n:prop_idx {k: 1}) RETURN n.k;
+MATCH (n:prop_idx {k: 1.0}) RETURN n.k;
+MATCH (n:prop_idx {k: '1'}) RETURN n.k;
+-- The property map uses the index
+BEGIN;
+SET LOCAL enable_seqscan = off;
+MATCH (n:prop_idx {k: 1}) RETURN n.k;
+SELECT pg_stat_get_xact_numscans(i.indexrelid) > 0 AS index_used
+FROM pg_index i
+WHERE i.indrelid = 'cypher_match.prop_idx'::regclass AND i.indexprs IS NOT NULL;
+COMMIT;
+
 --
 -- Clean up
 --
@@ -59,6 +59,14 @@ MATCH (u:begin)-[*1..200]-(v:end) RETURN count(*);
 MATCH (u:begin)-[:edge*]-(v:end) RETURN count(*);
 MATCH (u:begin)-[:edge* {name: 'main edge'}]-(v:end) RETURN count(*);
 MATCH (u:begin)-[* {name: 'main edge'}]-(v:end) RETURN count(*);
+-- shortestPath and allShortestPaths
+MATCH p = shortestPath((u:begin)-[*]->(v:end)) RETURN count(*);
+MATCH p = allShortestPaths((u:begin)-[*]->(v:end)) RETURN count(*);
+MATCH p = shortestPath((u:begin)-[*]-(v:end)) RETURN count(*);
+MATCH p = allShortestPaths((u:begin)-[*]-(v:end)) RETURN count(*);
+MATCH p = allShortestPaths((u:begin)<-[*]-(v:end)) RETURN count(*);
+MATCH p = allShortestPaths((u:begin)-[:edge*]->(v:end)) RETURN count(*);
+MATCH p = allShortestPaths((u:begin)-[*..2]->(v:end)) RETURN count(*);
 -- Each should find 1
 MATCH ()<-[*4..4 {name: 'main edge'}]-() RETURN count(*);
 MATCH (u)<-[*4..4 {name: 'main edge'}]-() RETURN count(*);
@@ -95,6 +103,16 @@ MATCH (a) MATCH (a)-[e1*1..1]->(v) RETURN count(*);
 MATCH (a) MATCH ()-[e1*1..1]->(a) RETURN count(*);
 MATCH (a)-[e*1..1]->() RETURN count(*);
 
+-- The end vertex label of a VLE includes the labels inheriting from it
+CREATE (:hub {name: 'hub'})-[:road]->(:town {name: 'town'})-[:road]->(:city {name: 'city'});
+SELECT create_vlabel('cypher_vle', 'capital');
+ALTER TABLE cypher_vle.capital INHERIT cypher_vle.town;
+MATCH (t:town {name: 'town'}) CREATE (t)-[:road]->(:capital {name: 'capital'});
+-- Should find 2
+MATCH (u:hub)-[*]->(v:town) RETURN count(*);
+-- Should find 1
+MATCH (u:hub)-[*]->(v:capital) RETURN v.name;
+
 -- Should return 1 path
  MATCH p=()<-[e1*]-(:end)-[e2*]->(:begin) RETURN p $$) AS (result traversal);
 -- Each should return 3
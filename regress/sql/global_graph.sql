@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2023-2024 PostGraphDB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Portions Copyright (c) 2020-2023, Apache Software Foundation
+ * Portions Copyright (c) 2019-2020, Bitnine Global
+ */ 
+
+LOAD 'postgraph';
+SET search_path TO postgraph;
+
+CREATE GRAPH global_graph;
+USE GRAPH global_graph;
+
+CREATE (:start)-[:e]->(:v)-[:e]->(:v);
+
+--
+-- Shared graph cache
+--
+SET postgraph.shared_graph_cache = on;
+SET client_min_messages = debug1;
+-- The graph is loaded and published in the shared graph cache
+MATCH p = shortestPath((a:start)-[*]->(b:v)) RETURN count(*);
+RESET client_min_messages;
+
+-- A new backend uses the published image instead of loading the graph
+\c
+LOAD 'postgraph';
+SET search_path TO postgraph;
+USE GRAPH global_graph;
+SET postgraph.shared_graph_cache = on;
+SET client_min_messages = debug1;
+MATCH p = shortestPath((a:start)-[*]->(b:v)) RETURN count(*);
+RESET client_min_messages;
+
+--
+-- Changes made by the transaction
+--
+SET client_min_messages = debug1;
+BEGIN;
+MATCH p = shortestPath((a:start)-[*]->(b:v)) RETURN count(*);
+MATCH (:start)-[:e]->(:v)-[:e]->(b:v) CREATE (b)-[:e]->(:v);
+-- The changes are applied to the graph in memory instead of loading it again
+MATCH p = shortestPath((a:start)-[*]->(b:v)) RETURN count(*);
+COMMIT;
+-- The graph is still valid once the transaction committed
+MATCH p = shortestPath((a:start)-[*]->(b:v)) RETURN count(*);
+RESET client_min_messages;
+
+--
+-- Cleanup
+--
+DROP GRAPH global_graph CASCADE;
+
+--
+-- End
+--
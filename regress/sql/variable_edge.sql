@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2023-2024 PostGraphDB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Portions Copyright (c) 2020-2023, Apache Software Foundation
+ * Portions Copyright (c) 2019-2020, Bitnine Global
+ */ 
+
+LOAD 'postgraph';
+SET search_path TO postgraph;
+
+CREATE GRAPH variable_edge;
+USE GRAPH variable_edge;
+
+CREATE (:v {i: 1})-[:e {j: 1}]->(:v {i: 2})-[:e {j: 2}]->(:v {i: 3});
+
+--
+-- the path functions
+--
+MATCH (:v {i: 1})-[e*]->(:v {i: 3}) RETURN length(e) AS len;
+MATCH (:v {i: 1})-[e*]->(:v {i: 3}) UNWIND nodes(e) AS n RETURN n.i AS i;
+MATCH (:v {i: 1})-[e*]->(:v {i: 3}) UNWIND relationships(e) AS r RETURN r.j AS j;
+MATCH (:v {i: 1})-[e*]->(:v {i: 3}) RETURN e;
+
+--
+-- paths returned by a SET or DELETE show the entities as they were matched
+--
+MATCH (:v {i: 1})-[e*]->(:v {i: 3}), (b:v {i: 2}) SET b.k = 1 RETURN e;
+MATCH (:v {i: 1})-[e*]->(:v {i: 3}) RETURN e;
+MATCH (:v {i: 1})-[e*]->(:v {i: 3}), (b:v {i: 2}) DETACH DELETE b RETURN e;
+MATCH (n:v) RETURN n.i AS i;
+MATCH ()-[r]->() RETURN count(*) AS cnt;
+
+--
+-- Cleanup
+--
+DROP GRAPH variable_edge CASCADE;
+
+--
+-- End
+--
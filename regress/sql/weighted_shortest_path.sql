@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2023-2024 PostGraphDB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Portions Copyright (c) 2020-2023, Apache Software Foundation
+ * Portions Copyright (c) 2019-2020, Bitnine Global
+ */ 
+
+LOAD 'postgraph';
+SET search_path TO postgraph;
+
+CREATE GRAPH weighted_shortest_path;
+USE GRAPH weighted_shortest_path;
+
+CREATE (a:city {name: 'a', x: 0, y: 0})-[:road {cost: 1}]->(b:city {name: 'b', x: 1, y: 0})-[:road {cost: 1}]->(d:city {name: 'd', x: 2, y: 0}),
+       (a)-[:road {cost: 5}]->(d),
+       (a)-[:road]->(c:city {name: 'c', x: 0, y: 1})-[:road {cost: 0}]->(d),
+       (:city {name: 'e', x: 5, y: 5}),
+       (:city {name: 'f', x: 6, y: 6})-[:road {cost: -1}]->(:city {name: 'g', x: 7, y: 7});
+
+-- the cheaper of the two ways from a to d
+MATCH (u:city {name: 'a'}), (v:city {name: 'd'})
+WITH weighted_shortest_path(u, v, 'cost') AS p
+RETURN length(p) AS len;
+
+MATCH (u:city {name: 'a'}), (v:city {name: 'd'})
+WITH weighted_shortest_path(u, v, 'cost') AS p
+UNWIND relationships(p) AS r
+RETURN r.cost AS cost;
+
+-- A* guided by the distance between the x and y coordinates
+MATCH (u:city {name: 'a'}), (v:city {name: 'd'})
+WITH weighted_shortest_path(u, v, 'cost', ['x', 'y']) AS p
+UNWIND relationships(p) AS r
+RETURN r.cost AS cost;
+
+-- no path
+MATCH (u:city {name: 'a'}), (v:city {name: 'e'})
+WITH weighted_shortest_path(u, v, 'cost') AS p
+RETURN count(p) AS paths;
+
+-- the start vertex is the end vertex
+MATCH (u:city {name: 'a'}), (v:city {name: 'a'})
+WITH weighted_shortest_path(u, v, 'cost') AS p
+RETURN count(p) AS paths;
+
+-- the only edge into c has no weight, so it can't be taken
+MATCH (u:city {name: 'a'}), (v:city {name: 'c'})
+WITH weighted_shortest_path(u, v, 'cost') AS p
+RETURN count(p) AS paths;
+
+-- negative weights are an error
+MATCH (u:city {name: 'f'}), (v:city {name: 'g'})
+WITH weighted_shortest_path(u, v, 'cost') AS p
+RETURN count(p) AS paths;
+
+-- The path finding functions run in the leader, above a parallel scan of the
+-- start vertices. 1407374883553283 is the id of z.
+CREATE (:town {name: 'x'})-[:way {cost: 1}]->(:town {name: 'y'})-[:way {cost: 1}]->(:town {name: 'z'});
+ALTER TABLE weighted_shortest_path.town SET (parallel_workers = 2);
+SET parallel_setup_cost = 0;
+SET parallel_tuple_cost = 0;
+SET min_parallel_table_scan_size = 0;
+SET max_parallel_workers_per_gather = 2;
+EXPLAIN (COSTS OFF)
+SELECT count(*)
+FROM weighted_shortest_path.town u,
+     weighted_shortest_path('"weighted_shortest_path"', build_vertex(u.id, u.tableoid, u.properties),
+                            build_vertex('1407374883553283'::graphid, 'weighted_shortest_path.town'::regclass, '{}'),
+                            '"cost"') AS p;
+SELECT count(*)
+FROM weighted_shortest_path.town u,
+     weighted_shortest_path('"weighted_shortest_path"', build_vertex(u.id, u.tableoid, u.properties),
+                            build_vertex('1407374883553283'::graphid, 'weighted_shortest_path.town'::regclass, '{}'),
+                            '"cost"') AS p;
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
+RESET min_parallel_table_scan_size;
+RESET max_parallel_workers_per_gather;
+
+-- A vertex without coordinates is estimated at 0, so m is first expanded
+-- from s at cost 5, and again once it is reached through u at cost 2.
+CREATE (s:spot {name: 's', x: 0, y: 0})-[:link {cost: 1}]->(:spot {name: 'u', x: 1, y: 0})-[:link {cost: 1}]->(m:spot {name: 'm'}),
+       (s)-[:link {cost: 5}]->(m),
+       (m)-[:link {cost: 10}]->(:spot {name: 't', x: 10, y: 0});
+MATCH (u:spot {name: 's'}), (v:spot {name: 't'})
+WITH weighted_shortest_path(u, v, 'cost', ['x', 'y']) AS p
+UNWIND relationships(p) AS r
+RETURN r.cost AS cost;
+
+--
+-- Cleanup
+--
+DROP GRAPH weighted_shortest_path CASCADE;
+
+--
+-- End
+--
@@ -40,11 +40,11 @@
 
 static Oid get_graph_namespace(const char *graph_name);
 
-// INSERT INTO postgraph.ag_graph VALUES (graph_name, nsp_id)
-void insert_graph(const Name graph_name, const Oid nsp_id)
+// INSERT INTO postgraph.ag_graph VALUES (graph_name, nsp_id, ...)
+void insert_graph(const Name graph_name, const Oid nsp_id, bool edge_endpoint_indexes)
 {
-    Datum values[Natts_ag_graph + 1];
-    bool nulls[Natts_ag_graph + 1];
+    Datum values[Natts_ag_graph];
+    bool nulls[Natts_ag_graph];
     Relation ag_graph;
     HeapTuple tuple;
 
@@ -62,8 +62,11 @@ void insert_graph(const Name graph_name, const Oid nsp_id)
     values[Anum_ag_graph_namespace - 1] = ObjectIdGetDatum(nsp_id);
     nulls[Anum_ag_graph_namespace - 1] = false;
 
-    values[Anum_ag_graph_namespace] = BoolGetDatum(true);
-    nulls[Anum_ag_graph_namespace] = false;
+    values[Anum_ag_graph_directed - 1] = BoolGetDatum(true);
+    nulls[Anum_ag_graph_directed - 1] = false;
+
+    values[Anum_ag_graph_edge_endpoint_indexes - 1] = BoolGetDatum(edge_endpoint_indexes);
+    nulls[Anum_ag_graph_edge_endpoint_indexes - 1] = false;
 
     tuple = heap_form_tuple(RelationGetDescr(ag_graph), values, nulls);
 
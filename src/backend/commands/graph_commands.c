@@ -80,7 +80,7 @@ Datum create_graph_if_not_exists(PG_FUNCTION_ARGS)
 
     nsp_id = create_schema_for_graph(graph_name);
 
-    insert_graph(graph_name, nsp_id);
+    insert_graph(graph_name, nsp_id, edge_endpoint_indexes);
 
     //Increment the Command counter before create the generic labels.
     CommandCounterIncrement();
@@ -201,7 +201,7 @@ Datum create_graph(PG_FUNCTION_ARGS)
 
     nsp_id = create_schema_for_graph(graph_name_str);
 
-    insert_graph(graph_name_str, nsp_id);
+    insert_graph(graph_name_str, nsp_id, edge_endpoint_indexes);
 
     //Increment the Command counter before create the generic labels.
     CommandCounterIncrement();
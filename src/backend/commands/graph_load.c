@@ -0,0 +1,686 @@
+/*
+ * Copyright (C) 2023 PostGraphDB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Bulk loading of vertices and edges from files on the server.
+ *
+ * Every line of a file is one entity. Files ending in ".csv" start with a
+ * header line naming the properties, and every field is loaded as a string.
+ * Other files have one gtype map per line (JSONL). Quoted CSV fields cannot
+ * span lines.
+ *
+ * Vertices are mapped from the value of their id property to the graphid
+ * they were given, so the edges loaded later in the transaction can refer to
+ * them by that value. The tuples are written with table_multi_insert, and
+ * index entries are added for the new tuples only.
+ */
+#include "postgres.h"
+
+#include "access/table.h"
+#include "access/xact.h"
+#include "catalog/dependency.h"
+#include "catalog/pg_authid.h"
+#include "common/hashfn.h"
+#include "common/string.h"
+#include "commands/sequence.h"
+#include "executor/executor.h"
+#include "fmgr.h"
+#include "lib/stringinfo.h"
+#include "miscadmin.h"
+#include "storage/fd.h"
+#include "utils/acl.h"
+#include "utils/builtins.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+
+#include "catalog/ag_graph.h"
+#include "catalog/ag_label.h"
+#include "commands/label_commands.h"
+#include "executor/cypher_utils.h"
+#include "utils/ag_cache.h"
+#include "utils/graphid.h"
+#include "utils/gtype.h"
+
+// external id of a loaded vertex, the string is owned by the map
+typedef struct loaded_vertex_key
+{
+    Oid graph_oid;
+    char *id;
+} loaded_vertex_key;
+
+typedef struct loaded_vertex_entry
+{
+    loaded_vertex_key key;
+    graphid id;
+    // subtransaction the vertex was loaded in
+    SubTransactionId subid;
+} loaded_vertex_entry;
+
+typedef struct graph_load_state
+{
+    char *file_path;
+    FILE *file;
+    bool csv;
+    // property names from the header line of a CSV file
+    List *csv_header;
+    int64 line_number;
+    StringInfoData line;
+
+    Oid graph_oid;
+    int32 label_id;
+    Oid seq_oid;
+    Relation rel;
+    EState *estate;
+    ResultRelInfo *resultRelInfo;
+    TupleTableSlot *elemTupleSlot;
+    entity_insert_buffer *buffer;
+    // reset after every line
+    MemoryContext row_context;
+} graph_load_state;
+
+// the ids of the vertices loaded in the current transaction
+static HTAB *loaded_vertices = NULL;
+static MemoryContext loaded_vertices_context = NULL;
+
+static void begin_graph_load(graph_load_state *state, Name graph_name,
+                             Name label_name, char label_type,
+                             text *file_path);
+static void end_graph_load(graph_load_state *state);
+static bool read_row(graph_load_state *state);
+static List *split_csv_line(graph_load_state *state, char *line);
+static gtype *row_properties(graph_load_state *state);
+static char *get_external_id(graph_load_state *state, gtype *properties,
+                             char *field, bool missing_ok);
+static void remember_loaded_vertex(Oid graph_oid, char *external_id,
+                                   graphid id, graph_load_state *state);
+static graphid find_loaded_vertex(graph_load_state *state,
+                                  char *external_id);
+static uint32 loaded_vertex_hash(const void *key, Size keysize);
+static int loaded_vertex_match(const void *key1, const void *key2,
+                               Size keysize);
+static void loaded_vertices_xact_callback(XactEvent event, void *arg);
+static void loaded_vertices_subxact_callback(SubXactEvent event,
+                                             SubTransactionId mySubid,
+                                             SubTransactionId parentSubid,
+                                             void *arg);
+
+PG_FUNCTION_INFO_V1(load_vertices_from_file);
+
+/*
+ * load_vertices_from_file(graph_name, label_name, file_path, id_field)
+ *
+ * Loads a vertex for every line of the file, returns the number of vertices
+ * loaded. Vertices with the id_field property can be referred to by the
+ * edges loaded later in the same transaction.
+ */
+Datum load_vertices_from_file(PG_FUNCTION_ARGS)
+{
+    graph_load_state state;
+    char *id_field;
+    int64 count = 0;
+
+    if (PG_ARGISNULL(0) || PG_ARGISNULL(1) || PG_ARGISNULL(2))
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                        errmsg("graph name, label name and file path must not be NULL")));
+
+    id_field = PG_ARGISNULL(3) ? NULL : text_to_cstring(PG_GETARG_TEXT_PP(3));
+
+    begin_graph_load(&state, PG_GETARG_NAME(0), PG_GETARG_NAME(1),
+                     LABEL_TYPE_VERTEX, PG_GETARG_TEXT_PP(2));
+
+    while (read_row(&state))
+    {
+        TupleTableSlot *slot = state.elemTupleSlot;
+        MemoryContext oldctx;
+        gtype *properties;
+        char *external_id = NULL;
+        graphid id;
+
+        oldctx = MemoryContextSwitchTo(state.row_context);
+
+        properties = row_properties(&state);
+        if (id_field != NULL)
+            external_id = get_external_id(&state, properties, id_field, true);
+
+        MemoryContextSwitchTo(oldctx);
+
+        id = make_graphid(state.label_id, nextval_internal(state.seq_oid, true));
+
+        if (external_id != NULL)
+            remember_loaded_vertex(state.graph_oid, external_id, id, &state);
+
+        ExecClearTuple(slot);
+
+        slot->tts_values[vertex_tuple_id] = GRAPHID_GET_DATUM(id);
+        slot->tts_isnull[vertex_tuple_id] = false;
+        slot->tts_values[vertex_tuple_properties] = GTYPE_P_GET_DATUM(properties);
+        slot->tts_isnull[vertex_tuple_properties] = false;
+
+        buffer_entity_tuple(state.buffer, slot, state.estate);
+
+        MemoryContextReset(state.row_context);
+        count++;
+    }
+
+    end_graph_load(&state);
+
+    PG_RETURN_INT64(count);
+}
+
+PG_FUNCTION_INFO_V1(load_edges_from_file);
+
+/*
+ * load_edges_from_file(graph_name, label_name, file_path, start_field,
+ *                      end_field)
+ *
+ * Loads an edge for every line of the file, returns the number of edges
+ * loaded. The start_field and end_field properties hold the ids of vertices
+ * loaded earlier in the same transaction.
+ */
+Datum load_edges_from_file(PG_FUNCTION_ARGS)
+{
+    graph_load_state state;
+    char *start_field;
+    char *end_field;
+    int64 count = 0;
+
+    if (PG_ARGISNULL(0) || PG_ARGISNULL(1) || PG_ARGISNULL(2))
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                        errmsg("graph name, label name and file path must not be NULL")));
+
+    if (PG_ARGISNULL(3) || PG_ARGISNULL(4))
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                        errmsg("start and end fields must not be NULL")));
+
+    start_field = text_to_cstring(PG_GETARG_TEXT_PP(3));
+    end_field = text_to_cstring(PG_GETARG_TEXT_PP(4));
+
+    begin_graph_load(&state, PG_GETARG_NAME(0), PG_GETARG_NAME(1),
+                     LABEL_TYPE_EDGE, PG_GETARG_TEXT_PP(2));
+
+    while (read_row(&state))
+    {
+        TupleTableSlot *slot = state.elemTupleSlot;
+        MemoryContext oldctx;
+        gtype *properties;
+        graphid start_id, end_id;
+
+        oldctx = MemoryContextSwitchTo(state.row_context);
+
+        properties = row_properties(&state);
+        start_id = find_loaded_vertex(&state, get_external_id(&state, properties, start_field, false));
+        end_id = find_loaded_vertex(&state, get_external_id(&state, properties, end_field, false));
+
+        MemoryContextSwitchTo(oldctx);
+
+        ExecClearTuple(slot);
+
+        slot->tts_values[edge_tuple_id] =
+            GRAPHID_GET_DATUM(make_graphid(state.label_id, nextval_internal(state.seq_oid, true)));
+        slot->tts_isnull[edge_tuple_id] = false;
+        slot->tts_values[edge_tuple_start_id] = GRAPHID_GET_DATUM(start_id);
+        slot->tts_isnull[edge_tuple_start_id] = false;
+        slot->tts_values[edge_tuple_end_id] = GRAPHID_GET_DATUM(end_id);
+        slot->tts_isnull[edge_tuple_end_id] = false;
+        slot->tts_values[edge_tuple_properties] = GTYPE_P_GET_DATUM(properties);
+        slot->tts_isnull[edge_tuple_properties] = false;
+
+        buffer_entity_tuple(state.buffer, slot, state.estate);
+
+        MemoryContextReset(state.row_context);
+        count++;
+    }
+
+    end_graph_load(&state);
+
+    PG_RETURN_INT64(count);
+}
+
+/*
+ * Open the file and the label table, creating the label if it does not
+ * exist yet.
+ */
+static void begin_graph_load(graph_load_state *state, Name graph_name,
+                             Name label_name, char label_type,
+                             text *file_path)
+{
+    char *graph = NameStr(*graph_name);
+    char *label = NameStr(*label_name);
+    label_cache_data *label_cache;
+    List *sequences;
+    AclResult aclresult;
+    size_t path_len;
+
+    memset(state, 0, sizeof(graph_load_state));
+
+    if (!is_member_of_role(GetUserId(), ROLE_PG_READ_SERVER_FILES))
+        ereport(ERROR, (errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+                        errmsg("must be superuser or a member of the pg_read_server_files role to load a graph from a file")));
+
+    state->graph_oid = get_graph_oid(graph);
+    if (!OidIsValid(state->graph_oid))
+        ereport(ERROR, (errcode(ERRCODE_UNDEFINED_SCHEMA),
+                        errmsg("graph \"%s\" does not exist", graph)));
+
+    if (!label_exists(label, state->graph_oid))
+    {
+        char *parent = label_type == LABEL_TYPE_VERTEX ? AG_DEFAULT_LABEL_VERTEX : AG_DEFAULT_LABEL_EDGE;
+
+        create_label(graph, label, label_type,
+                     list_make1(get_label_range_var(graph, state->graph_oid, parent)));
+    }
+
+    label_cache = search_label_name_graph_cache(label, state->graph_oid);
+    if (label_cache->kind != label_type)
+        ereport(ERROR, (errcode(ERRCODE_WRONG_OBJECT_TYPE),
+                        errmsg("label \"%s\" is not %s label", label,
+                               label_type == LABEL_TYPE_VERTEX ? "a vertex" : "an edge")));
+
+    state->label_id = label_cache->id;
+
+    // the ids come from the sequence of the label's "id" column
+    sequences = getOwnedSequences(label_cache->relation);
+    if (list_length(sequences) != 1)
+        ereport(ERROR, (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+                        errmsg("label \"%s\" has no id sequence", label)));
+    state->seq_oid = linitial_oid(sequences);
+
+    state->rel = table_open(label_cache->relation, RowExclusiveLock);
+
+    aclresult = pg_class_aclcheck(label_cache->relation, GetUserId(), ACL_INSERT);
+    if (aclresult != ACLCHECK_OK)
+        aclcheck_error(aclresult, OBJECT_TABLE, RelationGetRelationName(state->rel));
+
+    state->estate = CreateExecutorState();
+    state->resultRelInfo = makeNode(ResultRelInfo);
+    InitResultRelInfo(state->resultRelInfo, state->rel, 0, NULL, 0);
+
+    state->elemTupleSlot = MakeSingleTupleTableSlot(RelationGetDescr(state->rel), &TTSOpsVirtual);
+
+    // index entries are added as the buffer is flushed
+    ExecOpenIndices(state->resultRelInfo, false);
+    state->buffer = create_entity_insert_buffer(state->resultRelInfo);
+
+    state->row_context = AllocSetContextCreate(CurrentMemoryContext, "graph load row",
+                                               ALLOCSET_DEFAULT_SIZES);
+
+    state->file_path = text_to_cstring(file_path);
+    path_len = strlen(state->file_path);
+    state->csv = path_len > 4 && pg_strcasecmp(state->file_path + path_len - 4, ".csv") == 0;
+
+    state->file = AllocateFile(state->file_path, "r");
+    if (state->file == NULL)
+        ereport(ERROR, (errcode_for_file_access(),
+                        errmsg("could not open file \"%s\" for reading: %m", state->file_path)));
+
+    initStringInfo(&state->line);
+
+    if (state->csv)
+    {
+        if (!read_row(state))
+            ereport(ERROR, (errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+                            errmsg("file \"%s\" has no header line", state->file_path)));
+
+        state->csv_header = split_csv_line(state, state->line.data);
+    }
+}
+
+/*
+ * Write the remaining tuples and release everything begin_graph_load
+ * acquired.
+ */
+static void end_graph_load(graph_load_state *state)
+{
+    flush_entity_insert_buffer(state->buffer, state->estate);
+    free_entity_insert_buffer(state->buffer);
+
+    FreeFile(state->file);
+
+    ExecCloseIndices(state->resultRelInfo);
+    ExecDropSingleTupleTableSlot(state->elemTupleSlot);
+    FreeExecutorState(state->estate);
+    MemoryContextDelete(state->row_context);
+
+    // keep the lock until the end of the transaction
+    table_close(state->rel, NoLock);
+
+    CommandCounterIncrement();
+}
+
+/*
+ * Read the next non-empty line of the file into state->line, without its
+ * line terminator.
+ */
+static bool read_row(graph_load_state *state)
+{
+    while (pg_get_line_buf(state->file, &state->line))
+    {
+        state->line_number++;
+
+        while (state->line.len > 0 &&
+               (state->line.data[state->line.len - 1] == '\n' ||
+                state->line.data[state->line.len - 1] == '\r'))
+            state->line.data[--state->line.len] = '\0';
+
+        if (state->line.len > 0)
+            return true;
+    }
+
+    if (ferror(state->file))
+        ereport(ERROR, (errcode_for_file_access(),
+                        errmsg("could not read file \"%s\": %m", state->file_path)));
+
+    return false;
+}
+
+/*
+ * Split a line of a CSV file into its fields. Fields may be quoted, with ""
+ * standing for a quote inside a quoted field.
+ */
+static List *split_csv_line(graph_load_state *state, char *line)
+{
+    List *fields = NIL;
+    StringInfoData field;
+    char *c = line;
+
+    initStringInfo(&field);
+
+    while (true)
+    {
+        resetStringInfo(&field);
+
+        if (*c == '"')
+        {
+            c++;
+
+            while (true)
+            {
+                if (*c == '\0')
+                    ereport(ERROR, (errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+                                    errmsg("unterminated quoted field on line " INT64_FORMAT " of file \"%s\"",
+                                           state->line_number, state->file_path)));
+
+                if (*c == '"')
+                {
+                    if (c[1] != '"')
+                        break;
+                    c++;
+                }
+
+                appendStringInfoChar(&field, *c);
+                c++;
+            }
+
+            // skip the closing quote
+            c++;
+
+            if (*c != ',' && *c != '\0')
+                ereport(ERROR, (errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+                                errmsg("unexpected character after quoted field on line " INT64_FORMAT " of file \"%s\"",
+                                       state->line_number, state->file_path)));
+        }
+        else
+        {
+            while (*c != ',' && *c != '\0')
+            {
+                appendStringInfoChar(&field, *c);
+                c++;
+            }
+        }
+
+        fields = lappend(fields, pstrdup(field.data));
+
+        if (*c == '\0')
+            break;
+
+        // skip the comma
+        c++;
+    }
+
+    pfree(field.data);
+
+    return fields;
+}
+
+/*
+ * Build the properties of the entity on the current line. A JSONL line goes
+ * through the gtype input function, a CSV line becomes a map from the header
+ * fields to its string fields.
+ */
+static gtype *row_properties(graph_load_state *state)
+{
+    gtype_in_state result;
+    List *fields;
+    ListCell *name_lc, *field_lc;
+
+    if (!state->csv)
+    {
+        gtype *properties = DATUM_GET_GTYPE_P(gtype_from_cstring(state->line.data, state->line.len));
+
+        if (!AGT_ROOT_IS_OBJECT(properties))
+            ereport(ERROR, (errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+                            errmsg("line " INT64_FORMAT " of file \"%s\" is not a map",
+                                   state->line_number, state->file_path)));
+
+        return properties;
+    }
+
+    fields = split_csv_line(state, state->line.data);
+
+    if (list_length(fields) != list_length(state->csv_header))
+        ereport(ERROR, (errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+                        errmsg("line " INT64_FORMAT " of file \"%s\" has %d fields, the header has %d",
+                               state->line_number, state->file_path,
+                               list_length(fields), list_length(state->csv_header))));
+
+    memset(&result, 0, sizeof(gtype_in_state));
+
+    result.res = push_gtype_value(&result.parse_state, WGT_BEGIN_OBJECT, NULL);
+
+    forboth (name_lc, state->csv_header, field_lc, fields)
+    {
+        result.res = push_gtype_value(&result.parse_state, WGT_KEY, string_to_gtype_value(lfirst(name_lc)));
+        result.res = push_gtype_value(&result.parse_state, WGT_VALUE, string_to_gtype_value(lfirst(field_lc)));
+    }
+
+    result.res = push_gtype_value(&result.parse_state, WGT_END_OBJECT, NULL);
+
+    return gtype_value_to_gtype(result.res);
+}
+
+/*
+ * Get the external id stored in the field property as a string. Integer and
+ * string ids are supported. Returns NULL for a missing id when missing_ok.
+ */
+static char *get_external_id(graph_load_state *state, gtype *properties,
+                             char *field, bool missing_ok)
+{
+    gtype_value key;
+    gtype_value *value;
+
+    key.type = AGTV_STRING;
+    key.val.string.val = field;
+    key.val.string.len = strlen(field);
+
+    value = find_gtype_value_from_container(&properties->root, GT_FOBJECT, &key);
+
+    if ((value == NULL || value->type == AGTV_NULL) && missing_ok)
+        return NULL;
+
+    if (value == NULL || value->type == AGTV_NULL)
+        ereport(ERROR, (errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+                        errmsg("line " INT64_FORMAT " of file \"%s\" has no \"%s\" property",
+                               state->line_number, state->file_path, field)));
+
+    if (value->type == AGTV_STRING)
+        return pnstrdup(value->val.string.val, value->val.string.len);
+    else if (value->type == AGTV_INTEGER)
+        return psprintf(INT64_FORMAT, value->val.int_value);
+
+    ereport(ERROR, (errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+                    errmsg("the \"%s\" property on line " INT64_FORMAT " of file \"%s\" must be an integer or a string",
+                           field, state->line_number, state->file_path)));
+
+    return NULL;
+}
+
+/*
+ * Map the external id of a loaded vertex to its graphid.
+ */
+static void remember_loaded_vertex(Oid graph_oid, char *external_id,
+                                   graphid id, graph_load_state *state)
+{
+    loaded_vertex_key key;
+    loaded_vertex_entry *entry;
+    bool found;
+
+    if (loaded_vertices == NULL)
+    {
+        static bool callback_registered = false;
+        HASHCTL hash_ctl;
+
+        if (!callback_registered)
+        {
+            RegisterXactCallback(loaded_vertices_xact_callback, NULL);
+            RegisterSubXactCallback(loaded_vertices_subxact_callback, NULL);
+            callback_registered = true;
+        }
+
+        loaded_vertices_context = AllocSetContextCreate(TopTransactionContext, "loaded vertex ids",
+                                                        ALLOCSET_DEFAULT_SIZES);
+
+        MemSet(&hash_ctl, 0, sizeof(hash_ctl));
+        hash_ctl.keysize = sizeof(loaded_vertex_key);
+        hash_ctl.entrysize = sizeof(loaded_vertex_entry);
+        hash_ctl.hash = loaded_vertex_hash;
+        hash_ctl.match = loaded_vertex_match;
+        hash_ctl.hcxt = loaded_vertices_context;
+
+        loaded_vertices = hash_create("loaded vertex ids", 1024, &hash_ctl,
+                                      HASH_ELEM | HASH_FUNCTION | HASH_COMPARE | HASH_CONTEXT);
+    }
+
+    key.graph_oid = graph_oid;
+    key.id = external_id;
+
+    entry = hash_search(loaded_vertices, &key, HASH_ENTER, &found);
+
+    if (found)
+        ereport(ERROR, (errcode(ERRCODE_UNIQUE_VIOLATION),
+                        errmsg("vertex \"%s\" on line " INT64_FORMAT " of file \"%s\" has already been loaded",
+                               external_id, state->line_number, state->file_path)));
+
+    // the key points to the row's copy of the id until here
+    entry->key.id = MemoryContextStrdup(loaded_vertices_context, external_id);
+    entry->id = id;
+    entry->subid = GetCurrentSubTransactionId();
+}
+
+static graphid find_loaded_vertex(graph_load_state *state, char *external_id)
+{
+    loaded_vertex_key key;
+    loaded_vertex_entry *entry = NULL;
+
+    key.graph_oid = state->graph_oid;
+    key.id = external_id;
+
+    if (loaded_vertices != NULL)
+        entry = hash_search(loaded_vertices, &key, HASH_FIND, NULL);
+
+    if (entry == NULL)
+        ereport(ERROR, (errcode(ERRCODE_UNDEFINED_OBJECT),
+                        errmsg("vertex \"%s\" on line " INT64_FORMAT " of file \"%s\" has not been loaded",
+                               external_id, state->line_number, state->file_path)));
+
+    return entry->id;
+}
+
+static uint32 loaded_vertex_hash(const void *key, Size keysize)
+{
+    const loaded_vertex_key *k = key;
+
+    return hash_combine(hash_bytes_uint32(k->graph_oid),
+                        hash_bytes((const unsigned char *)k->id, strlen(k->id)));
+}
+
+static int loaded_vertex_match(const void *key1, const void *key2, Size keysize)
+{
+    const loaded_vertex_key *k1 = key1;
+    const loaded_vertex_key *k2 = key2;
+
+    if (k1->graph_oid != k2->graph_oid)
+        return 1;
+
+    return strcmp(k1->id, k2->id);
+}
+
+/*
+ * The ids only last as long as the transaction that loaded the vertices,
+ * whether it commits or aborts.
+ */
+static void loaded_vertices_xact_callback(XactEvent event, void *arg)
+{
+    switch (event)
+    {
+        case XACT_EVENT_COMMIT:
+        case XACT_EVENT_PARALLEL_COMMIT:
+        case XACT_EVENT_PREPARE:
+        case XACT_EVENT_ABORT:
+        case XACT_EVENT_PARALLEL_ABORT:
+            break;
+        default:
+            return;
+    }
+
+    if (loaded_vertices_context != NULL)
+        MemoryContextDelete(loaded_vertices_context);
+
+    loaded_vertices = NULL;
+    loaded_vertices_context = NULL;
+}
+
+/*
+ * Forget the vertices loaded in an aborted subtransaction. Subtransaction ids
+ * only grow, so the ones at or above mySubid belong to it or its children.
+ */
+static void loaded_vertices_subxact_callback(SubXactEvent event,
+                                             SubTransactionId mySubid,
+                                             SubTransactionId parentSubid,
+                                             void *arg)
+{
+    HASH_SEQ_STATUS status;
+    loaded_vertex_entry *entry;
+    char *id;
+
+    if (event != SUBXACT_EVENT_ABORT_SUB || loaded_vertices == NULL)
+        return;
+
+    hash_seq_init(&status, loaded_vertices);
+    while ((entry = hash_seq_search(&status)) != NULL)
+    {
+        if (entry->subid < mySubid)
+            continue;
+
+        // the key still points to the id, free it once the entry is gone
+        id = entry->key.id;
+
+        hash_search(loaded_vertices, &entry->key, HASH_REMOVE, NULL);
+        pfree(id);
+    }
+}
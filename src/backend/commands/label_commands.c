@@ -19,12 +19,16 @@
 
 #include "postgraph.h"
 
+#include "access/genam.h"
 #include "access/heapam.h"
+#include "access/table.h"
 #include "access/xact.h"
 #include "catalog/dependency.h"
 #include "catalog/namespace.h"
 #include "catalog/objectaddress.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_class_d.h"
+#include "catalog/pg_index.h"
 #include "commands/defrem.h"
 #include "commands/sequence.h"
 #include "commands/tablecmds.h"
@@ -43,13 +47,17 @@
 #include "tcop/utility.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
+#include "utils/guc.h"
 #include "utils/inval.h"
 #include "utils/lsyscache.h"
+#include "utils/rel.h"
+#include "utils/syscache.h"
 
 #include "catalog/ag_graph.h"
 #include "catalog/ag_label.h"
 #include "commands/label_commands.h"
 #include "utils/ag_cache.h"
+#include "utils/global_graph.h"
 #include "utils/gtype.h"
 #include "utils/graphid.h"
 
@@ -59,30 +67,35 @@
  */
 #define gen_label_relation_name(label_name) (label_name)
 
-static void create_table_for_label(char *graph_name, char *label_name,
-                                   char *schema_name, char *rel_name,
-                                   char *seq_name, char label_type,
-                                   List *parents);
+/*
+ * Number of entry ids a backend takes from a label's sequence at a time. The
+ * ids are then handed out without touching the sequence.
+ */
+#define ENTRY_ID_CACHE_SIZE 1024
+
+static void create_table_for_label(int32 label_id, char *schema_name,
+                                   char *rel_name, char *seq_name,
+                                   char label_type, List *parents);
 
 // common
-static List *create_edge_table_elements(char *graph_name, char *label_name,
-                                        char *schema_name, char *rel_name,
-                                        char *seq_name);
-static List *create_vertex_table_elements(char *graph_name, char *label_name,
-                                          char *schema_name, char *rel_name,
-                                          char *seq_name);
+static List *create_edge_table_elements(int32 label_id, char *schema_name,
+                                        char *rel_name, char *seq_name);
+static List *create_vertex_table_elements(int32 label_id, char *schema_name,
+                                          char *rel_name, char *seq_name);
 static void create_sequence_for_label(RangeVar *seq_range_var);
+static void create_edge_endpoint_index(char *schema_name, char *rel_name,
+                                       char *column_name);
 static Constraint *build_pk_constraint(void);
-static Constraint *build_id_default(char *graph_name, char *label_name,
-                                    char *schema_name, char *seq_name);
-static FuncCall *build_id_default_func_expr(char *graph_name, char *label_name,
-                                            char *schema_name, char *seq_name);
+static Constraint *build_id_default(int32 label_id, char *schema_name,
+                                    char *seq_name);
+static FuncCall *build_id_default_func_expr(int32 label_id, char *schema_name,
+                                            char *seq_name);
 static Constraint *build_not_null_constraint(void);
 static Constraint *build_properties_default(void);
 static void alter_sequence_owned_by_for_label(RangeVar *seq_range_var,
                                               char *rel_name);
 static int32 get_new_label_id(Oid graph_oid, Oid nsp_id);
-static void change_label_id_default(char *graph_name, char *label_name,
+static void change_label_id_default(int32 label_id, char *label_name,
                                     char *schema_name, char *seq_name,
                                     Oid relid);
 
@@ -533,6 +546,17 @@ Datum create_property_index(PG_FUNCTION_ARGS)
 
 
 
+// create indexes on start_id and end_id of the edge label tables of new graphs
+bool edge_endpoint_indexes = true;
+
+void label_commands_init(void)
+{
+    DefineCustomBoolVariable("postgraph.edge_endpoint_indexes",
+                             "Creates indexes on the start_id and end_id of the edge labels of new graphs.",
+                             "The setting is recorded with the graph when it is created, and applies to all of its edge labels.",
+                             &edge_endpoint_indexes, true, PGC_USERSET, 0, NULL, NULL, NULL);
+}
+
 /*
  * For the new label, create an entry in CATALOG_SCHEMA.ag_label, create a
  * new table and sequence. Returns the oid from the new tuple in
@@ -560,6 +584,12 @@ void create_label(char *graph_name, char *label_name, char label_type,
     graph_oid = cache_data->oid;
     nsp_id = cache_data->namespace;
 
+    /*
+     * get a new "id" for the new label, it is a constant in the default of
+     * the table's "id" column
+     */
+    label_id = get_new_label_id(graph_oid, nsp_id);
+
     // create a sequence for the new label to generate unique IDs for vertices
     schema_name = get_namespace_name(nsp_id);
     rel_name = gen_label_relation_name(label_name);
@@ -568,38 +598,138 @@ void create_label(char *graph_name, char *label_name, char label_type,
     create_sequence_for_label(seq_range_var);
 
     // create a table for the new label
-    create_table_for_label(graph_name, label_name, schema_name, rel_name,
-                           seq_name, label_type, parents);
+    create_table_for_label(label_id, schema_name, rel_name, seq_name,
+                           label_type, parents);
 
     // record the new label in ag_label
     relation_id = get_relname_relid(rel_name, nsp_id);
 
     // If a label has parents, switch the parents id default, with its own.
     if (list_length(parents) != 0)
-        change_label_id_default(graph_name, label_name, schema_name, seq_name,
+        change_label_id_default(label_id, label_name, schema_name, seq_name,
                                 relation_id);
 
     // associate the sequence with the "id" column
     alter_sequence_owned_by_for_label(seq_range_var, rel_name);
 
-    // get a new "id" for the new label
-    label_id = get_new_label_id(graph_oid, nsp_id);
+    // index the edges by the vertices they connect, indexes aren't inherited
+    if (label_type == LABEL_TYPE_EDGE && cache_data->edge_endpoint_indexes)
+    {
+        create_edge_endpoint_index(schema_name, rel_name, AG_EDGE_COLNAME_START_ID);
+        create_edge_endpoint_index(schema_name, rel_name, AG_EDGE_COLNAME_END_ID);
+    }
 
     insert_label(label_name, graph_oid, label_id, label_type, relation_id);
 
     CommandCounterIncrement();
 }
 
+/*
+ * Find a btree index of the edge label table whose first column is the
+ * start_id or end_id column, InvalidOid if there is none.
+ */
+Oid get_edge_endpoint_index(Relation rel, AttrNumber attnum)
+{
+    List *indexes = RelationGetIndexList(rel);
+    Oid result = InvalidOid;
+    ListCell *lc;
+
+    foreach (lc, indexes)
+    {
+        Oid index_oid = lfirst_oid(lc);
+        HeapTuple tuple = SearchSysCache1(INDEXRELID, ObjectIdGetDatum(index_oid));
+        Form_pg_index index;
+
+        if (!HeapTupleIsValid(tuple))
+            continue;
+
+        index = (Form_pg_index)GETSTRUCT(tuple);
+
+        if (index->indisvalid && index->indnatts > 0 &&
+            index->indkey.values[0] == attnum)
+        {
+            Relation index_rel = index_open(index_oid, AccessShareLock);
+            bool is_btree = index_rel->rd_rel->relam == BTREE_AM_OID;
+
+            index_close(index_rel, AccessShareLock);
+
+            if (is_btree)
+            {
+                result = index_oid;
+                ReleaseSysCache(tuple);
+                break;
+            }
+        }
+
+        ReleaseSysCache(tuple);
+    }
+
+    list_free(indexes);
+
+    return result;
+}
+
+// CREATE INDEX ON `schema_name`.`rel_name` USING btree (`column_name`)
+static void create_edge_endpoint_index(char *schema_name, char *rel_name,
+                                       char *column_name)
+{
+    IndexElem *idx_elem = makeNode(IndexElem);
+    IndexStmt *idx = makeNode(IndexStmt);
+    PlannedStmt *wrapper;
+
+    idx_elem->name = column_name;
+    idx_elem->expr = NULL;
+    idx_elem->indexcolname = NULL;
+    idx_elem->collation = NIL;
+    idx_elem->opclass = NIL;
+    idx_elem->opclassopts = NIL;
+    idx_elem->ordering = SORTBY_DEFAULT;
+    idx_elem->nulls_ordering = SORTBY_NULLS_DEFAULT;
+
+    idx->unique = false;
+    idx->concurrent = false;
+    idx->idxname = NULL;
+    idx->relation = makeRangeVar(schema_name, rel_name, -1);
+    idx->accessMethod = "btree";
+    idx->indexParams = list_make1(idx_elem);
+    idx->indexIncludingParams = NIL;
+    idx->options = NIL;
+    idx->tableSpace = NULL;
+    idx->whereClause = NULL;
+    idx->excludeOpNames = NIL;
+    idx->idxcomment = NULL;
+    idx->indexOid = InvalidOid;
+    idx->oldNode = InvalidOid;
+    idx->oldCreateSubid = InvalidSubTransactionId;
+    idx->oldFirstRelfilenodeSubid = InvalidSubTransactionId;
+    idx->primary = false;
+    idx->isconstraint = false;
+    idx->deferrable = false;
+    idx->initdeferred = false;
+    idx->transformed = false;
+    idx->if_not_exists = false;
+    idx->reset_default_tblspc = false;
+
+    wrapper = makeNode(PlannedStmt);
+    wrapper->commandType = CMD_UTILITY;
+    wrapper->canSetTag = false;
+    wrapper->utilityStmt = (Node *)idx;
+    wrapper->stmt_location = -1;
+    wrapper->stmt_len = 0;
+
+    ProcessUtility(wrapper, "(generated CREATE INDEX command)", false, PROCESS_UTILITY_SUBCOMMAND, NULL, NULL,
+                   None_Receiver, NULL);
+}
+
 // CREATE TABLE `schema_name`.`rel_name` (
 //   "id" graphid PRIMARY KEY DEFAULT CATALOG_SCHEMA."_graphid"(...),
 //   "start_id" graphid NOT NULL note: only for edge labels
 //   "end_id" graphid NOT NULL  note: only for edge labels
 //   "properties" gtype NOT NULL DEFAULT CATALOG_SCHEMA."gtype_build_map"()
 // )
-static void create_table_for_label(char *graph_name, char *label_name,
-                                   char *schema_name, char *rel_name,
-                                   char *seq_name, char label_type,
-                                   List *parents)
+static void create_table_for_label(int32 label_id, char *schema_name,
+                                   char *rel_name, char *seq_name,
+                                   char label_type, List *parents)
 {
     CreateStmt *create_stmt;
     PlannedStmt *wrapper;
@@ -618,10 +748,10 @@ static void create_table_for_label(char *graph_name, char *label_name,
         create_stmt->tableElts = NIL;
     else if (label_type == LABEL_TYPE_EDGE)
         create_stmt->tableElts = create_edge_table_elements(
-            graph_name, label_name, schema_name, rel_name, seq_name);
+            label_id, schema_name, rel_name, seq_name);
     else if (label_type == LABEL_TYPE_VERTEX)
         create_stmt->tableElts = create_vertex_table_elements(
-            graph_name, label_name, schema_name, rel_name, seq_name);
+            label_id, schema_name, rel_name, seq_name);
     else
         ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR),
                         errmsg("undefined label type \'%c\'", label_type)));
@@ -654,9 +784,8 @@ static void create_table_for_label(char *graph_name, char *label_name,
 //   "end_id" graphid NOT NULL
 //   "properties" gtype NOT NULL DEFAULT CATALOG_SCHEMA."gtype_build_map"()
 // )
-static List *create_edge_table_elements(char *graph_name, char *label_name,
-                                        char *schema_name, char *rel_name,
-                                        char *seq_name)
+static List *create_edge_table_elements(int32 label_id, char *schema_name,
+                                        char *rel_name, char *seq_name)
 {
     ColumnDef *id;
     ColumnDef *start_id;
@@ -666,8 +795,8 @@ static List *create_edge_table_elements(char *graph_name, char *label_name,
     // "id" graphid PRIMARY KEY DEFAULT CATALOG_SCHEMA."_graphid"(...)
     id = makeColumnDef(AG_EDGE_COLNAME_ID, GRAPHIDOID, -1, InvalidOid);
     id->constraints = list_make2(build_pk_constraint(),
-                                 build_id_default(graph_name, label_name,
-                                                  schema_name, seq_name));
+                                 build_id_default(label_id, schema_name,
+                                                  seq_name));
 
     // "start_id" graphid NOT NULL
     start_id = makeColumnDef(AG_EDGE_COLNAME_START_ID, GRAPHIDOID, -1,
@@ -691,9 +820,8 @@ static List *create_edge_table_elements(char *graph_name, char *label_name,
 //   "id" graphid PRIMARY KEY DEFAULT CATALOG_SCHEMA."_graphid"(...),
 //   "properties" gtype NOT NULL DEFAULT CATALOG_SCHEMA."gtype_build_map"()
 // )
-static List *create_vertex_table_elements(char *graph_name, char *label_name,
-                                          char *schema_name, char *rel_name,
-                                          char *seq_name)
+static List *create_vertex_table_elements(int32 label_id, char *schema_name,
+                                          char *rel_name, char *seq_name)
 {
     ColumnDef *id;
     ColumnDef *props;
@@ -701,8 +829,8 @@ static List *create_vertex_table_elements(char *graph_name, char *label_name,
     // "id" graphid PRIMARY KEY DEFAULT CATALOG_SCHEMA."_graphid"(...)
     id = makeColumnDef(AG_VERTEX_COLNAME_ID, GRAPHIDOID, -1, InvalidOid);
     id->constraints = list_make2(build_pk_constraint(),
-                                 build_id_default(graph_name, label_name,
-                                                  schema_name, seq_name));
+                                 build_id_default(label_id, schema_name,
+                                                  seq_name));
 
     // "properties" gtype NOT NULL DEFAULT CATALOG_SCHEMA."gtype_build_map"()
     props = makeColumnDef(AG_VERTEX_COLNAME_PROPERTIES, GTYPEOID, -1,
@@ -713,13 +841,14 @@ static List *create_vertex_table_elements(char *graph_name, char *label_name,
     return list_make2(id, props);
 }
 
-// CREATE SEQUENCE `seq_range_var` MAXVALUE `LOCAL_ID_MAX`
+// CREATE SEQUENCE `seq_range_var` MAXVALUE `LOCAL_ID_MAX` CACHE `ENTRY_ID_CACHE_SIZE`
 static void create_sequence_for_label(RangeVar *seq_range_var)
 {
     ParseState *pstate;
     CreateSeqStmt *seq_stmt;
     char buf[32]; // greater than MAXINT8LEN+1
     DefElem *maxvalue;
+    DefElem *cache;
 
     pstate = make_parsestate(NULL);
     pstate->p_sourcetext = "(generated CREATE SEQUENCE command)";
@@ -728,7 +857,8 @@ static void create_sequence_for_label(RangeVar *seq_range_var)
     seq_stmt->sequence = seq_range_var;
     pg_lltoa(ENTRY_ID_MAX, buf);
     maxvalue = makeDefElem("maxvalue", (Node *)makeFloat(pstrdup(buf)), -1);
-    seq_stmt->options = list_make1(maxvalue);
+    cache = makeDefElem("cache", (Node *)makeInteger(ENTRY_ID_CACHE_SIZE), -1);
+    seq_stmt->options = list_make2(maxvalue, cache);
     seq_stmt->ownerId = InvalidOid;
     seq_stmt->for_identity = false;
     seq_stmt->if_not_exists = false;
@@ -759,14 +889,10 @@ static Constraint *build_pk_constraint(void)
  * Construct a FuncCall node that will create the default logic for the label's
  * id.
  */
-static FuncCall *build_id_default_func_expr(char *graph_name, char *label_name,
-                                            char *schema_name, char *seq_name)
+static FuncCall *build_id_default_func_expr(int32 label_id, char *schema_name,
+                                            char *seq_name)
 {
-    List *label_id_func_name;
-    A_Const *graph_name_const;
-    A_Const *label_name_const;
-    List *label_id_func_args;
-    FuncCall *label_id_func;
+    A_Const *label_id_const;
     List *nextval_func_name;
     char *qualified_seq_name;
     A_Const *qualified_seq_name_const;
@@ -777,19 +903,14 @@ static FuncCall *build_id_default_func_expr(char *graph_name, char *label_name,
     List *graphid_func_args;
     FuncCall *graphid_func;
 
-    // Build a node that gets the label id
-    label_id_func_name = list_make2(makeString(CATALOG_SCHEMA),
-                                    makeString("_label_id"));
-    graph_name_const = makeNode(A_Const);
-    graph_name_const->val.type = T_String;
-    graph_name_const->val.val.str = graph_name;
-    graph_name_const->location = -1;
-    label_name_const = makeNode(A_Const);
-    label_name_const->val.type = T_String;
-    label_name_const->val.val.str = label_name;
-    label_name_const->location = -1;
-    label_id_func_args = list_make2(graph_name_const, label_name_const);
-    label_id_func = makeFuncCall(label_id_func_name, label_id_func_args, COERCE_SQL_SYNTAX, -1);
+    /*
+     * The label id never changes, so it is a constant. Looking it up by the
+     * graph and label names would cost a cache lookup for every new entity.
+     */
+    label_id_const = makeNode(A_Const);
+    label_id_const->val.type = T_Integer;
+    label_id_const->val.val.ival = label_id;
+    label_id_const->location = -1;
 
     //Build a node that will get the next val from the label's sequence
     nextval_func_name = SystemFuncName("nextval");
@@ -806,12 +927,12 @@ static FuncCall *build_id_default_func_expr(char *graph_name, char *label_name,
     nextval_func = makeFuncCall(nextval_func_name, nextval_func_args, COERCE_SQL_SYNTAX, -1);
 
     /*
-     * Build a node that contructs the graphid from the label id function
-     * and the next val function for the given sequence.
+     * Build a node that contructs the graphid from the label id and the
+     * next val function for the given sequence.
      */
     graphid_func_name = list_make2(makeString(CATALOG_SCHEMA),
                                    makeString("_graphid"));
-    graphid_func_args = list_make2(label_id_func, nextval_func);
+    graphid_func_args = list_make2(label_id_const, nextval_func);
     graphid_func = makeFuncCall(graphid_func_name, graphid_func_args, COERCE_SQL_SYNTAX, -1);
 
     return graphid_func;
@@ -820,14 +941,13 @@ static FuncCall *build_id_default_func_expr(char *graph_name, char *label_name,
 /*
  * Construct a default constraint on the id column for a newly created table
  */
-static Constraint *build_id_default(char *graph_name, char *label_name,
-                                    char *schema_name, char *seq_name)
+static Constraint *build_id_default(int32 label_id, char *schema_name,
+                                    char *seq_name)
 {
     FuncCall *graphid_func;
     Constraint *id_default;
 
-    graphid_func = build_id_default_func_expr(graph_name, label_name,
-                                              schema_name, seq_name);
+    graphid_func = build_id_default_func_expr(label_id, schema_name, seq_name);
 
     id_default = makeNode(Constraint);
     id_default->contype = CONSTR_DEFAULT;
@@ -875,7 +995,7 @@ static Constraint *build_properties_default(void)
  * Alter the default constraint on the label's id to the use the given
  * sequence.
  */
-static void change_label_id_default(char *graph_name, char *label_name,
+static void change_label_id_default(int32 label_id, char *label_name,
                                     char *schema_name, char *seq_name,
                                     Oid relid)
 {
@@ -886,8 +1006,7 @@ static void change_label_id_default(char *graph_name, char *label_name,
     FuncCall *func_call;
     AlterTableUtilityContext atuc;
 
-    func_call = build_id_default_func_expr(graph_name, label_name, schema_name,
-                                           seq_name);
+    func_call = build_id_default_func_expr(label_id, schema_name, seq_name);
 
     rv = makeRangeVar(schema_name, label_name, -1);
 
@@ -1034,6 +1153,9 @@ Datum drop_label(PG_FUNCTION_ARGS)
     rel_name = get_rel_name(label_relation);
     qname = list_make2(makeString(schema_name), makeString(rel_name));
 
+    // its vertices or edges leave the graphs in memory without being logged
+    mark_unlogged_graph_write(label_relation);
+
     remove_relation(qname);
     // CommandCounterIncrement() is called in performDeletion()
 
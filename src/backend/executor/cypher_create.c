@@ -54,6 +54,9 @@ static Datum create_vertex_1(cypher_create_custom_scan_state *css,
 
 static void process_pattern(cypher_create_custom_scan_state *css);
 
+static void insert_entity(cypher_create_custom_scan_state *css,
+                          cypher_target_node *node, EState *estate);
+
 
 const CustomExecMethods cypher_create_exec_methods = {CREATE_SCAN_STATE_NAME,
                                                       begin_cypher_create,
@@ -149,6 +152,14 @@ static void begin_cypher_create(CustomScanState *node, EState *estate, int eflag
 
             if (cypher_node->id_expr != NULL)
                 cypher_node->id_expr_state = ExecInitExpr(cypher_node->id_expr, (PlanState *)node); 
+
+            /*
+             * Nothing reads the tuples of a terminal CREATE before it is
+             * done, so they are inserted in batches.
+             */
+            if (CYPHER_CLAUSE_IS_TERMINAL(css->flags))
+                css->insert_buffers = lappend(css->insert_buffers,
+                                              create_entity_insert_buffer(cypher_node->resultRelInfo));
 	}
     } 
     /* 
@@ -249,6 +260,14 @@ static TupleTableSlot *exec_cypher_create(CustomScanState *node)
         }
     } while (terminal);
 
+    if (terminal)
+    {
+        ListCell *lc;
+
+        foreach (lc, css->insert_buffers)
+            flush_entity_insert_buffer(lfirst(lc), estate);
+    }
+
     if (!used)
         return NULL;
 
@@ -264,7 +283,18 @@ static void end_cypher_create(CustomScanState *node)
 {
     cypher_create_custom_scan_state *css =
         (cypher_create_custom_scan_state *)node;
+    EState *estate = css->css.ss.ps.state;
     ListCell *lc;
+
+    foreach (lc, css->insert_buffers)
+    {
+        entity_insert_buffer *buffer = lfirst(lc);
+
+        flush_entity_insert_buffer(buffer, estate);
+        free_entity_insert_buffer(buffer);
+    }
+    css->insert_buffers = NIL;
+
     CommandCounterIncrement();
 
     ExecEndNode(node->ss.ps.lefttree);
@@ -316,6 +346,7 @@ Node *create_cypher_create_plan_state(CustomScan *cscan)
     Assert(is_ag_node(target_nodes, cypher_create_target_nodes));
 
     cypher_css->path_values = NIL;
+    cypher_css->insert_buffers = NIL;
     cypher_css->pattern = target_nodes->paths;
     cypher_css->flags = target_nodes->flags;
     cypher_css->graph_oid = target_nodes->graph_oid;
@@ -403,7 +434,7 @@ static void create_edge_1(cypher_create_custom_scan_state *css,
         scanTupleSlot->tts_isnull[node->prop_attr_num];
 
     // Insert the new edge
-    insert_entity_tuple(resultRelInfo, elemTupleSlot, estate);
+    insert_entity(css, node, estate);
 
     /* restore the old result relation info */
     estate->es_result_relations = old_estate_es_result_relations_info;
@@ -487,7 +518,7 @@ static Datum create_vertex_1(cypher_create_custom_scan_state *css,
             scanTupleSlot->tts_isnull[node->prop_attr_num];
 
         // Insert the new vertex
-        insert_entity_tuple(resultRelInfo, elemTupleSlot, estate);
+        insert_entity(css, node, estate);
 
         /* restore the old result relation info */
         estate->es_result_relations = old_estate_es_result_relations_info;
@@ -570,3 +601,25 @@ static Datum create_vertex_1(cypher_create_custom_scan_state *css,
     return id;
 }
 
+/*
+ * Insert the tuple in the target node's elemTupleSlot, or add it to the
+ * node's insert buffer when the CREATE inserts in batches.
+ */
+static void insert_entity(cypher_create_custom_scan_state *css,
+                          cypher_target_node *node, EState *estate)
+{
+    ListCell *lc;
+
+    foreach (lc, css->insert_buffers)
+    {
+        entity_insert_buffer *buffer = lfirst(lc);
+
+        if (buffer->resultRelInfo == node->resultRelInfo)
+        {
+            buffer_entity_tuple(buffer, node->elemTupleSlot, estate);
+            return;
+        }
+    }
+
+    insert_entity_tuple(node->resultRelInfo, node->elemTupleSlot, estate);
+}
@@ -19,10 +19,12 @@
 
 #include "postgres.h"
 
+#include "access/genam.h"
 #include "access/heapam.h"
 #include "access/htup_details.h"
 #include "access/multixact.h"
 #include "access/table.h"
+#include "access/tableam.h"
 #include "access/xact.h"
 #include "executor/tuptable.h"
 #include "nodes/execnodes.h"
@@ -34,9 +36,11 @@
 #include "utils/rel.h"
 
 #include "catalog/ag_label.h"
+#include "commands/label_commands.h"
 #include "executor/cypher_executor.h"
 #include "executor/cypher_utils.h"
 #include "nodes/cypher_nodes.h"
+#include "utils/global_graph.h"
 #include "utils/gtype.h"
 #include "utils/graphid.h"
 #include "utils/vertex.h"
@@ -52,6 +56,15 @@ static void process_delete_list(CustomScanState *node);
 static void find_connected_edges(CustomScanState *node, char *graph_name,
                                  List *labels, char *var_name, graphid id,
                                  bool detach_delete);
+static void find_connected_edges_by_index(EState *estate,
+                                          ResultRelInfo *resultRelInfo,
+                                          Oid index_oid, char *var_name,
+                                          graphid id, bool skip_self_loops,
+                                          bool detach_delete);
+static void process_connected_edge(EState *estate,
+                                   ResultRelInfo *resultRelInfo,
+                                   HeapTuple tuple, char *var_name,
+                                   bool detach_delete);
 static void delete_entity(EState *estate, ResultRelInfo *resultRelInfo,
                           HeapTuple tuple);
 
@@ -166,15 +179,24 @@ static TupleTableSlot *exec_cypher_delete(CustomScanState *node)
         //Process the subtree first
         Decrement_Estate_CommandId(estate)
         slot = ExecProcNode(node->ss.ps.lefttree);
-        Increment_Estate_CommandId(estate)
 
         if (TupIsNull(slot))
+        {
+            Increment_Estate_CommandId(estate)
             return NULL;
+        }
 
         // setup the scantuple that the process_delete_list needs
         econtext->ecxt_scantuple =
             node->ss.ps.lefttree->ps_ProjInfo->pi_exprContext->ecxt_scantuple;
 
+        /*
+         * The paths returned must not depend on the entities being deleted.
+         * A terminal DELETE, above, returns nothing and skips this.
+         */
+        materialize_slot_variable_edges(econtext->ecxt_scantuple);
+        Increment_Estate_CommandId(estate)
+
         process_delete_list(node);
 
         econtext->ecxt_scantuple =
@@ -300,6 +322,10 @@ static void delete_entity(EState *estate, ResultRelInfo *resultRelInfo, HeapTupl
             /* elog never gets here */
             break;
         }
+
+        /* let the graphs in memory know about it */
+        log_graph_change(resultRelInfo->ri_RelationDesc, tuple, GetCurrentCommandId(false), GRAPH_CHANGE_DELETE);
+
         /* increment the command counter */
         CommandCounterIncrement();
     }
@@ -332,9 +358,8 @@ static void process_delete_list(CustomScanState *node) {
     {
         cypher_delete_item *item;
         gtype_value *original_entity_value, *id, *label;
-        ScanKeyData scan_keys[1];
-        TableScanDesc scan_desc;
         ResultRelInfo *resultRelInfo;
+        TupleTableSlot *slot;
         HeapTuple heap_tuple;
         Value *pos;
         int entity_position;
@@ -356,10 +381,6 @@ static void process_delete_list(CustomScanState *node) {
              char *label = extract_edge_label(e);
 
              resultRelInfo = create_entity_result_rel_info(estate, css->delete_data->graph_name, label); 
-
-	     ScanKeyInit(&scan_keys[0], Anum_ag_label_edge_table_id,
-                         BTEqualStrategyNumber, F_GRAPHIDEQ, GRAPHID_GET_DATUM(gid));
-
         } else if (tupleDescriptor->attrs[entity_position -1].atttypid == VERTEXOID) {
             vertex *v = DATUM_GET_VERTEX(scanTupleSlot->tts_values[entity_position - 1]);
  
@@ -367,33 +388,29 @@ static void process_delete_list(CustomScanState *node) {
             char *label = extract_vertex_label(v);
 
             resultRelInfo = create_entity_result_rel_info(estate, css->delete_data->graph_name, label);
-            
-
-	    ScanKeyInit(&scan_keys[0], Anum_ag_label_vertex_table_id,
-                        BTEqualStrategyNumber, F_GRAPHIDEQ, GRAPHID_GET_DATUM(gid));
         } else {
             ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
                     errmsg("DELETE clause can only delete vertices and edges")));
         }
 
-        scan_desc = table_beginscan(resultRelInfo->ri_RelationDesc, estate->es_snapshot, 1, scan_keys);
-
-        heap_tuple = heap_getnext(scan_desc, ForwardScanDirection);
+        slot = table_slot_create(resultRelInfo->ri_RelationDesc, NULL);
 
-        if (!HeapTupleIsValid(heap_tuple))
+        if (!find_entity_tuple(resultRelInfo->ri_RelationDesc, estate->es_snapshot, gid, slot))
         {
-            table_endscan(scan_desc);
+            ExecDropSingleTupleTableSlot(slot);
             destroy_entity_result_rel_info(resultRelInfo);
 
             continue;
         }
 
+        heap_tuple = ExecFetchSlotHeapTuple(slot, false, NULL);
+
 	if (tupleDescriptor->attrs[entity_position -1].atttypid == VERTEXOID)
             find_connected_edges(node, graph_name, css->edge_labels, item->var_name, gid, css->delete_data->detach);
 
         delete_entity(estate, resultRelInfo, heap_tuple);
 
-        table_endscan(scan_desc);
+        ExecDropSingleTupleTableSlot(slot);
         destroy_entity_result_rel_info(resultRelInfo);
     }
 }
@@ -409,18 +426,16 @@ static void find_connected_edges(CustomScanState *node, char *graph_name,
     cypher_delete_custom_scan_state *css =
         (cypher_delete_custom_scan_state *)node;
     EState *estate = css->css.ss.ps.state;
+    bool find_indexes = !css->edge_indexes_found;
     ListCell *lc;
 
     Increment_Estate_CommandId(estate);
 
     /*
-     * We need to scan through all the edges to see if this vertex has
-     * any edges attached to it.
-     *
-     * XXX: If we implement an on-disc graph storage system. Such as
-     * an adjacency matrix, the performace of this check can be massively
-     * improved. However, right now we have to scan every edge to see if
-     * one has this vertex as a start or end vertex.
+     * Edge labels with indexes on start_id and end_id are probed for the
+     * vertex. Otherwise, we have to scan every edge to see if one has this
+     * vertex as a start or end vertex. The indexes are looked up once, for
+     * the first vertex the statement deletes.
      */
     foreach(lc, labels)
     {
@@ -429,10 +444,43 @@ static void find_connected_edges(CustomScanState *node, char *graph_name,
         TableScanDesc scan_desc;
         HeapTuple tuple;
         TupleTableSlot *slot;
+        Oid start_index;
+        Oid end_index;
 
         resultRelInfo = create_entity_result_rel_info(estate,
                                                       graph_name, label_name);
 
+        if (find_indexes)
+        {
+            MemoryContext oldctx = MemoryContextSwitchTo(estate->es_query_cxt);
+
+            css->edge_start_indexes = lappend_oid(css->edge_start_indexes,
+                get_edge_endpoint_index(resultRelInfo->ri_RelationDesc,
+                                        Anum_ag_label_edge_table_start_id));
+            css->edge_end_indexes = lappend_oid(css->edge_end_indexes,
+                get_edge_endpoint_index(resultRelInfo->ri_RelationDesc,
+                                        Anum_ag_label_edge_table_end_id));
+
+            MemoryContextSwitchTo(oldctx);
+        }
+
+        start_index = list_nth_oid(css->edge_start_indexes,
+                                   foreach_current_index(lc));
+        end_index = list_nth_oid(css->edge_end_indexes,
+                                 foreach_current_index(lc));
+
+        if (OidIsValid(start_index) && OidIsValid(end_index))
+        {
+            find_connected_edges_by_index(estate, resultRelInfo, start_index,
+                                          var_name, id, false, detach_delete);
+            // self loops were found by their start_id
+            find_connected_edges_by_index(estate, resultRelInfo, end_index,
+                                          var_name, id, true, detach_delete);
+
+            destroy_entity_result_rel_info(resultRelInfo);
+            continue;
+        }
+
         scan_desc = table_beginscan(resultRelInfo->ri_RelationDesc,
                                     estate->es_snapshot, 0, NULL);
 
@@ -458,26 +506,88 @@ static void find_connected_edges(CustomScanState *node, char *graph_name,
             endid = GRAPHID_GET_DATUM(slot_getattr(slot, Anum_ag_label_edge_table_end_id, &isNull));
 
             if (id == startid || id == endid)
-            {
-                /*
-                 * We have found an edge that uses the vertex. Either delete the
-                 * edge or throw an error. Depending on whether the DETACH
-                 * option was specified in the query.
-                 */
-                if (detach_delete)
-                    delete_entity(estate, resultRelInfo, tuple);
-                else
-                    ereport(ERROR,
-                            (errcode(ERRCODE_INTERNAL_ERROR),
-                             errmsg("Cannot delete vertex %s, because it still has edges attached. "
-                                    "To delete this vertex, you must first delete the attached edges.",
-                                    var_name)));
-            }
+                process_connected_edge(estate, resultRelInfo, tuple, var_name,
+                                       detach_delete);
         }
 
         table_endscan(scan_desc);
         destroy_entity_result_rel_info(resultRelInfo);
     }
 
+    css->edge_indexes_found = true;
+
     Decrement_Estate_CommandId(estate);
 }
+
+/*
+ * Use the index on the start_id or end_id of the edge label to find the
+ * edges connected to the given vertex.
+ */
+static void find_connected_edges_by_index(EState *estate,
+                                          ResultRelInfo *resultRelInfo,
+                                          Oid index_oid, char *var_name,
+                                          graphid id, bool skip_self_loops,
+                                          bool detach_delete)
+{
+    Relation rel = resultRelInfo->ri_RelationDesc;
+    Relation index_rel;
+    IndexScanDesc scan_desc;
+    ScanKeyData scan_key;
+    TupleTableSlot *slot;
+
+    index_rel = index_open(index_oid, AccessShareLock);
+    slot = table_slot_create(rel, NULL);
+
+    ScanKeyInit(&scan_key, 1, BTEqualStrategyNumber, F_GRAPHIDEQ,
+                GRAPHID_GET_DATUM(id));
+
+    scan_desc = index_beginscan(rel, index_rel, estate->es_snapshot, 1, 0);
+    index_rescan(scan_desc, &scan_key, 1, NULL, 0);
+
+    while (index_getnext_slot(scan_desc, ForwardScanDirection, slot))
+    {
+        HeapTuple tuple;
+        bool should_free;
+
+        if (skip_self_loops)
+        {
+            bool isNull;
+            graphid startid = DATUM_GET_GRAPHID(
+                slot_getattr(slot, Anum_ag_label_edge_table_start_id, &isNull));
+
+            if (startid == id)
+                continue;
+        }
+
+        tuple = ExecFetchSlotHeapTuple(slot, false, &should_free);
+
+        process_connected_edge(estate, resultRelInfo, tuple, var_name,
+                               detach_delete);
+
+        if (should_free)
+            heap_freetuple(tuple);
+    }
+
+    index_endscan(scan_desc);
+    index_close(index_rel, AccessShareLock);
+    ExecDropSingleTupleTableSlot(slot);
+}
+
+/*
+ * We have found an edge that uses the vertex. Either delete the edge or throw
+ * an error. Depending on whether the DETACH option was specified in the query.
+ */
+static void process_connected_edge(EState *estate,
+                                   ResultRelInfo *resultRelInfo,
+                                   HeapTuple tuple, char *var_name,
+                                   bool detach_delete)
+{
+    if (detach_delete)
+        delete_entity(estate, resultRelInfo, tuple);
+    else
+        ereport(ERROR,
+                (errcode(ERRCODE_INTERNAL_ERROR),
+                 errmsg("Cannot delete vertex %s, because it still has edges attached. "
+                        "To delete this vertex, you must first delete the attached edges.",
+                        var_name)));
+}
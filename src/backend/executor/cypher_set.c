@@ -34,6 +34,7 @@
 #include "executor/cypher_executor.h"
 #include "executor/cypher_utils.h"
 #include "nodes/cypher_nodes.h"
+#include "utils/global_graph.h"
 #include "utils/gtype.h"
 #include "utils/graphid.h"
 #include "utils/vertex.h"
@@ -155,6 +156,9 @@ static HeapTuple update_entity_tuple(ResultRelInfo *resultRelInfo, TupleTableSlo
             ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR),
                     errmsg("Entity failed to be updated: %i", result)));
 
+        // Let the graphs in memory know about it
+        log_graph_change(resultRelInfo->ri_RelationDesc, tuple, GetCurrentCommandId(false), GRAPH_CHANGE_UPDATE);
+
         // Insert index entries for the tuple
         if (resultRelInfo->ri_NumIndices > 0 && update_indexes)
           ExecInsertIndexTuples(resultRelInfo, elemTupleSlot, estate, false, false, NULL, NIL);
@@ -425,8 +429,7 @@ static void process_update_list(CustomScanState *node)
         gtype *new_property_value;
         TupleTableSlot *slot;
         ResultRelInfo *resultRelInfo;
-        ScanKeyData scan_keys[1];
-        TableScanDesc scan_desc;
+        TupleTableSlot *old_slot;
         bool remove_property;
         char *label_name;
         cypher_update_item *update_item;
@@ -523,18 +526,16 @@ static void process_update_list(CustomScanState *node)
 
         if (luindex[update_item->entity_position - 1] == lidx)
         {
-            ScanKeyInit(&scan_keys[0], 1, BTEqualStrategyNumber, F_GRAPHIDEQ,
-                        GRAPHID_GET_DATUM(id));
-
-            scan_desc = table_beginscan(resultRelInfo->ri_RelationDesc,
-                                        estate->es_snapshot, 1, scan_keys);
-
-            heap_tuple = heap_getnext(scan_desc, ForwardScanDirection);
+            old_slot = table_slot_create(resultRelInfo->ri_RelationDesc, NULL);
 
-            if (HeapTupleIsValid(heap_tuple))
+            if (find_entity_tuple(resultRelInfo->ri_RelationDesc,
+                                  estate->es_snapshot, id, old_slot))
+            {
+                heap_tuple = ExecFetchSlotHeapTuple(old_slot, false, NULL);
                 heap_tuple = update_entity_tuple(resultRelInfo, slot, estate, heap_tuple);
+            }
 
-            table_endscan(scan_desc);
+            ExecDropSingleTupleTableSlot(old_slot);
         }
 
         estate->es_snapshot->curcid = cid;
@@ -562,16 +563,22 @@ static TupleTableSlot *exec_cypher_set(CustomScanState *node)
     //Process the subtree first
     Decrement_Estate_CommandId(estate);
     slot = ExecProcNode(node->ss.ps.lefttree);
-    Increment_Estate_CommandId(estate);
 
     if (TupIsNull(slot))
     {
+        Increment_Estate_CommandId(estate);
         return NULL;
     }
 
     econtext->ecxt_scantuple =
         node->ss.ps.lefttree->ps_ProjInfo->pi_exprContext->ecxt_scantuple;
 
+    // the paths returned show the entities as they were before the update
+    if (!CYPHER_CLAUSE_IS_TERMINAL(css->flags))
+        materialize_slot_variable_edges(econtext->ecxt_scantuple);
+
+    Increment_Estate_CommandId(estate);
+
     if (CYPHER_CLAUSE_IS_TERMINAL(css->flags))
     {
         estate->es_result_relations = saved_resultRelsInfo;
@@ -24,6 +24,7 @@
 
 #include "postgres.h"
 
+#include "access/genam.h"
 #include "access/htup_details.h"
 #include "access/sysattr.h"
 #include "access/xact.h"
@@ -38,7 +39,9 @@
 #include "parser/parsetree.h"
 #include "parser/parse_relation.h"
 #include "storage/procarray.h"
+#include "utils/datum.h"
 #include "utils/rel.h"
+#include "utils/relcache.h"
 
 #include "catalog/ag_label.h"
 #include "commands/label_commands.h"
@@ -46,8 +49,10 @@
 #include "executor/cypher_utils.h"
 #include "utils/gtype.h"
 #include "utils/ag_cache.h"
+#include "utils/global_graph.h"
 #include "utils/gtype.h"
 #include "utils/graphid.h"
+#include "utils/variable_edge.h"
 
 /*
  * Given the graph name and the label name, create a ResultRelInfo for the table
@@ -173,11 +178,9 @@ TupleTableSlot *populate_edge_tts(
 bool entity_exists(EState *estate, Oid graph_oid, graphid id)
 {
     label_cache_data *label;
-    ScanKeyData scan_keys[1];
-    TableScanDesc scan_desc;
-    HeapTuple tuple;
+    TupleTableSlot *slot;
     Relation rel;
-    bool result = true;
+    bool result;
 
     /*
      * Extract the label id from the graph id and get the table name
@@ -185,28 +188,62 @@ bool entity_exists(EState *estate, Oid graph_oid, graphid id)
      */
     label = search_label_graph_oid_cache(graph_oid, GET_LABEL_ID(id));
 
+    rel = table_open(label->relation, RowExclusiveLock);
+    slot = table_slot_create(rel, NULL);
+
+    result = find_entity_tuple(rel, estate->es_snapshot, id, slot);
+
+    ExecDropSingleTupleTableSlot(slot);
+    table_close(rel, RowExclusiveLock);
+
+    return result;
+}
+
+/*
+ * Find the tuple of the entity with the given id in its label table and store
+ * it in the slot. Returns false if no such tuple is visible to the snapshot.
+ *
+ * The primary key on "id" is used for the lookup. Label tables without one
+ * are scanned with the id as a scan key.
+ */
+bool find_entity_tuple(Relation rel, Snapshot snapshot, graphid id,
+                       TupleTableSlot *slot)
+{
+    ScanKeyData scan_keys[1];
+    Oid index_oid;
+    bool found;
+
     // Setup the scan key to be the graphid
     ScanKeyInit(&scan_keys[0], 1, BTEqualStrategyNumber,
                 F_GRAPHIDEQ, GRAPHID_GET_DATUM(id));
 
-    rel = table_open(label->relation, RowExclusiveLock);
-    scan_desc = table_beginscan(rel, estate->es_snapshot, 1, scan_keys);
-
-    tuple = heap_getnext(scan_desc, ForwardScanDirection);
+    index_oid = RelationGetPrimaryKeyIndex(rel);
 
-    /*
-     * If a single tuple was returned, the tuple is still valid, otherwise'
-     * set to false.
-     */
-    if (!HeapTupleIsValid(tuple))
+    if (OidIsValid(index_oid))
     {
-        result = false;
+        Relation index_rel = index_open(index_oid, AccessShareLock);
+        IndexScanDesc scan_desc;
+
+        scan_desc = index_beginscan(rel, index_rel, snapshot, 1, 0);
+        index_rescan(scan_desc, scan_keys, 1, NULL, 0);
+
+        found = index_getnext_slot(scan_desc, ForwardScanDirection, slot);
+
+        index_endscan(scan_desc);
+        index_close(index_rel, AccessShareLock);
     }
+    else
+    {
+        TableScanDesc scan_desc;
 
-    table_endscan(scan_desc);
-    table_close(rel, RowExclusiveLock);
+        scan_desc = table_beginscan(rel, snapshot, 1, scan_keys);
 
-    return result;
+        found = table_scan_getnextslot(scan_desc, ForwardScanDirection, slot);
+
+        table_endscan(scan_desc);
+    }
+
+    return found;
 }
 
 /*
@@ -251,6 +288,10 @@ HeapTuple insert_entity_tuple_cid(ResultRelInfo *resultRelInfo,
     table_tuple_insert(resultRelInfo->ri_RelationDesc, elemTupleSlot,
                 GetCurrentCommandId(true), 0, NULL);
 
+    // Let the graphs in memory know about it
+    log_graph_change(resultRelInfo->ri_RelationDesc, tuple,
+                     GetCurrentCommandId(false), GRAPH_CHANGE_INSERT);
+
     // Insert index entries for the tuple
     if (resultRelInfo->ri_NumIndices > 0)
     {
@@ -259,3 +300,170 @@ HeapTuple insert_entity_tuple_cid(ResultRelInfo *resultRelInfo,
 
     return tuple;
 }
+
+/*
+ * Create a buffer that collects the tuples for the label table of the
+ * ResultRelInfo, so they can be inserted with a single table_multi_insert.
+ */
+entity_insert_buffer *create_entity_insert_buffer(ResultRelInfo *resultRelInfo)
+{
+    entity_insert_buffer *buffer = palloc0(sizeof(entity_insert_buffer));
+
+    buffer->resultRelInfo = resultRelInfo;
+    buffer->bistate = GetBulkInsertState();
+    buffer->nused = 0;
+
+    return buffer;
+}
+
+/*
+ * Check the table's constraints for the edge/vertex tuple and add a copy of
+ * it to the buffer. The buffer is flushed when it is full.
+ */
+void buffer_entity_tuple(entity_insert_buffer *buffer,
+                         TupleTableSlot *elemTupleSlot, EState *estate)
+{
+    ResultRelInfo *resultRelInfo = buffer->resultRelInfo;
+    TupleTableSlot *slot;
+
+    ExecStoreVirtualTuple(elemTupleSlot);
+
+    /* Check the constraints of the tuple */
+    if (resultRelInfo->ri_RelationDesc->rd_att->constr != NULL)
+    {
+        ExecConstraints(resultRelInfo, elemTupleSlot, estate);
+    }
+
+    if (buffer->slots[buffer->nused] == NULL)
+        buffer->slots[buffer->nused] =
+            table_slot_create(resultRelInfo->ri_RelationDesc, NULL);
+
+    // the values of elemTupleSlot belong to the current row, copy them
+    slot = buffer->slots[buffer->nused++];
+    ExecCopySlot(slot, elemTupleSlot);
+
+    if (buffer->nused == ENTITY_INSERT_BUFFER_SIZE)
+        flush_entity_insert_buffer(buffer, estate);
+}
+
+/*
+ * Insert the buffered tuples into the table and indices.
+ */
+void flush_entity_insert_buffer(entity_insert_buffer *buffer, EState *estate)
+{
+    ResultRelInfo *resultRelInfo = buffer->resultRelInfo;
+    Relation rel = resultRelInfo->ri_RelationDesc;
+    int i;
+
+    if (buffer->nused == 0)
+        return;
+
+    table_multi_insert(rel, buffer->slots, buffer->nused,
+                       GetCurrentCommandId(true), 0, buffer->bistate);
+
+    for (i = 0; i < buffer->nused; i++)
+    {
+        TupleTableSlot *slot = buffer->slots[i];
+
+        // Let the graphs in memory know about it
+        log_graph_change(rel, ExecFetchSlotHeapTuple(slot, false, NULL),
+                         GetCurrentCommandId(false), GRAPH_CHANGE_INSERT);
+
+        // Insert index entries for the tuple
+        if (resultRelInfo->ri_NumIndices > 0)
+        {
+            ExecInsertIndexTuples(resultRelInfo, slot, estate, false, false,
+                                  NULL, NIL);
+        }
+
+        ExecClearTuple(slot);
+    }
+
+    buffer->nused = 0;
+}
+
+/*
+ * Release the buffer, any tuples still in it must have been flushed.
+ */
+void free_entity_insert_buffer(entity_insert_buffer *buffer)
+{
+    int i;
+
+    Assert(buffer->nused == 0);
+
+    for (i = 0; i < ENTITY_INSERT_BUFFER_SIZE && buffer->slots[i] != NULL; i++)
+        ExecDropSingleTupleTableSlot(buffer->slots[i]);
+
+    FreeBulkInsertState(buffer->bistate);
+    pfree(buffer);
+}
+
+/*
+ * Replace the compact variable_edges in the slot with full copies of their
+ * edges and vertices. A clause that changes the graph calls this on its input
+ * before it makes the changes, so the paths it passes on show the entities
+ * as they were matched, even once they are updated or deleted.
+ */
+void materialize_slot_variable_edges(TupleTableSlot *slot)
+{
+    TupleDesc tupdesc = slot->tts_tupleDescriptor;
+    bool copy_by_ref;
+    Datum *values;
+    bool *isnull;
+    bool found = false;
+    int i;
+
+    slot_getallattrs(slot);
+
+    for (i = 0; i < tupdesc->natts && !found; i++)
+    {
+        found = !slot->tts_isnull[i] &&
+                TupleDescAttr(tupdesc, i)->atttypid == VARIABLEEDGEOID &&
+                IS_COMPACT_VARIABLE_EDGE(DATUM_GET_VARIABLE_EDGE(slot->tts_values[i]));
+    }
+
+    if (!found)
+        return;
+
+    /*
+     * Clearing the slot releases the tuple its values point into, unless it
+     * is a virtual tuple that the slot doesn't own.
+     */
+    copy_by_ref = !TTS_IS_VIRTUAL(slot) || TTS_SHOULDFREE(slot);
+
+    values = palloc(sizeof(Datum) * tupdesc->natts);
+    isnull = palloc(sizeof(bool) * tupdesc->natts);
+
+    for (i = 0; i < tupdesc->natts; i++)
+    {
+        Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
+
+        values[i] = slot->tts_values[i];
+        isnull[i] = slot->tts_isnull[i];
+
+        if (isnull[i])
+            continue;
+
+        if (attr->atttypid == VARIABLEEDGEOID &&
+            IS_COMPACT_VARIABLE_EDGE(DATUM_GET_VARIABLE_EDGE(values[i])))
+        {
+            VariableEdge *ve = DATUM_GET_VARIABLE_EDGE(values[i]);
+
+            values[i] = VARIABLE_EDGE_GET_DATUM(materialize_variable_edge(ve));
+        }
+        else if (copy_by_ref && !attr->attbyval)
+        {
+            values[i] = datumCopy(values[i], false, attr->attlen);
+        }
+    }
+
+    ExecClearTuple(slot);
+
+    memcpy(slot->tts_values, values, sizeof(Datum) * tupdesc->natts);
+    memcpy(slot->tts_isnull, isnull, sizeof(bool) * tupdesc->natts);
+
+    ExecStoreVirtualTuple(slot);
+
+    pfree(values);
+    pfree(isnull);
+}
@@ -217,6 +217,7 @@ void out_cypher_path(StringInfo str, const ExtensibleNode *node)
     DEFINE_AG_NODE(cypher_path);
 
     WRITE_NODE_FIELD(path);
+    WRITE_ENUM_FIELD(kind, cypher_path_kind);
     WRITE_LOCATION_FIELD(location);
 }
 
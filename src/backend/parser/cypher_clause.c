@@ -28,6 +28,7 @@
 #include "access/sysattr.h"
 #include "access/heapam.h"
 #include "catalog/pg_amproc.h"
+#include "catalog/pg_inherits.h"
 #include "catalog/pg_type_d.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
@@ -77,6 +78,10 @@
 #define INCLUDE_NODE_IN_JOIN_TREE(path, node) \
     (path->var_name || node->name || node->props)
 
+// shortest path patterns are always found by a path finding function
+#define IS_PATH_FINDING_EDGE(path, rel) \
+    (rel->varlen != NULL || path->kind != CYPHER_PATH_NORMAL)
+
 typedef Query *(*transform_method)(cypher_parsestate *cpstate, cypher_clause *clause);
 
 // projection
@@ -93,6 +98,7 @@ static void transform_match_pattern(cypher_parsestate *cpstate, Query *query, Li
 static List *transform_match_path(cypher_parsestate *cpstate, Query *query, cypher_path *path);
 static Expr *transform_cypher_edge(cypher_parsestate *cpstate, cypher_relationship *rel, List **target_list);
 static Expr *transform_cypher_node(cypher_parsestate *cpstate, cypher_node *node, List **target_list, bool output_node);
+static Expr *add_vertex_target_entries(cypher_parsestate *cpstate, ParseNamespaceItem *pnsi, char *name, List **target_list);
 static Node *make_vertex_expr(cypher_parsestate *cpstate, ParseNamespaceItem *pnsi);
 static Node *make_edge_expr(cypher_parsestate *cpstate, ParseNamespaceItem *pnsi);
 static Node *make_qual(cypher_parsestate *cpstate, transform_entity *entity, char *name);
@@ -104,8 +110,11 @@ static List *make_join_condition_for_edge(cypher_parsestate *cpstate, transform_
 static List *make_edge_quals(cypher_parsestate *cpstate, transform_entity *edge, enum transform_entity_join_side side);
 static A_Expr *filter_vertices_on_label_id(cypher_parsestate *cpstate, Node *id_field, char *label);
 static Node *create_property_constraints(cypher_parsestate *cpstate, transform_entity *entity, Node *property_constraints);
+static bool is_scalar_literal(Node *node);
 static TargetEntry *findTarget(List *targetList, char *resname);
 static transform_entity *transform_VLE_edge_entity(cypher_parsestate *cpstate, cypher_relationship *rel, Query *query, FuncCall *func);
+static bool is_vertex_bound(cypher_parsestate *cpstate, Query *query, cypher_node *node);
+static void transform_VLE_single_source(cypher_parsestate *cpstate, Query *query, cypher_node *prev_node, cypher_relationship *rel, cypher_node *node, transform_entity **vle_entity, transform_entity **next_entity);
 static ParseNamespaceItem *add_vle_to_query(cypher_parsestate *cpstate, Node *n);
 // create clause
 static Query *transform_cypher_create(cypher_parsestate *cpstate, cypher_clause *clause);
@@ -2656,11 +2665,12 @@ static ParseNamespaceItem *add_vle_to_query(cypher_parsestate *cpstate, Node *n)
     return lfirst(list_head(namespace));
 }
 
-static FuncCall *make_vle_func_call(cypher_parsestate *cpstate, cypher_node *prev_node, cypher_relationship *rel, cypher_node *next_node)
+static FuncCall *make_vle_func_call(cypher_parsestate *cpstate, cypher_path *path, cypher_node *prev_node, cypher_relationship *rel, cypher_node *next_node)
 {
     ColumnRef *cref;
     A_Indices *ai = (A_Indices *)rel->varlen;
     List *args = NIL;
+    char *func_name;
 
 
     // start node    
@@ -2669,22 +2679,28 @@ static FuncCall *make_vle_func_call(cypher_parsestate *cpstate, cypher_node *pre
     cref->fields = list_make1(makeString(prev_node->name));
     args = lappend(args, cref);
 
-    //end node
-    Assert(next_node->name != NULL);
+    // end node, there is none when the traversal finds the end vertices
+    if (next_node != NULL) {
+        Assert(next_node->name != NULL);
 
-    cref = makeNode(ColumnRef);
-    cref->location = -1;
-    cref->fields = list_make1(makeString(next_node->name));
-    args = lappend(args, cref);
+        cref = makeNode(ColumnRef);
+        cref->location = -1;
+        cref->fields = list_make1(makeString(next_node->name));
+        args = lappend(args, cref);
+    }
 
-    // lower bound
-    if (ai == NULL || ai->lidx == NULL)
+    // lower bound, a shortest path over a single edge has no range
+    if (ai == NULL)
+        args = lappend(args, make_int_const(1, -1));
+    else if (ai->lidx == NULL)
         args = lappend(args, make_null_const(-1));
     else
         args = lappend(args, ai->lidx);
 
     // upper bound
-    if (ai == NULL || ai->uidx == NULL)
+    if (ai == NULL)
+        args = lappend(args, make_int_const(1, -1));
+    else if (ai->uidx == NULL)
         args = lappend(args, make_null_const(-1));
     else
         args = lappend(args, ai->uidx);
@@ -2702,7 +2718,16 @@ static FuncCall *make_vle_func_call(cypher_parsestate *cpstate, cypher_node *pre
     else                    
         args = lappend(args, rel->props);   
 
-    return makeFuncCall(list_make1(makeString("vle")), args, COERCE_SQL_SYNTAX, -1);
+    if (path->kind == CYPHER_PATH_SHORTEST)
+        func_name = "shortest_path";
+    else if (path->kind == CYPHER_PATH_ALL_SHORTEST)
+        func_name = "all_shortest_paths";
+    else if (next_node == NULL)
+        func_name = "vle_single_source";
+    else
+        func_name = "vle";
+
+    return makeFuncCall(list_make1(makeString(func_name)), args, COERCE_SQL_SYNTAX, -1);
 }
 
 static transform_entity *handle_vertex(cypher_parsestate *cpstate, Query *query,
@@ -2714,7 +2739,7 @@ static transform_entity *handle_vertex(cypher_parsestate *cpstate, Query *query,
     if(node->name == NULL && !INCLUDE_NODE_IN_JOIN_TREE(path, node) && i + 1 < list_length(path->path)) {
         cypher_relationship *rel = list_nth(path->path, i + 1);
 
-        if (rel->varlen != NULL)
+        if (IS_PATH_FINDING_EDGE(path, rel))
             node->name = get_next_default_alias(cpstate);
     }
 
@@ -3232,26 +3257,44 @@ static List *make_edge_quals(cypher_parsestate *cpstate, transform_entity *edge,
 
 /*
  * Creates a node that will create a filter on the passed field node
- * that removes all labels that do not have the same label_id
+ * that removes all labels that are neither the label nor one of the
+ * labels that inherit from it, the same vertices a scan of the label's
+ * table returns.
  */
 static A_Expr *filter_vertices_on_label_id(cypher_parsestate *cpstate, Node *id_field, char *label) {
     label_cache_data *lcd = search_label_name_graph_cache(label, cpstate->graph_oid);
-    A_Const *n;
+    List *label_ids = NIL;
+    List *relids;
+    ListCell *lc;
     FuncCall *fc;
     Value *catalog, *extract_label_id;
-    int32 label_id = lcd->id;
 
-    n = makeNode(A_Const);
-    n->val.type = T_Integer;
-    n->val.val.ival = label_id;
-    n->location = -1;
+    relids = find_all_inheritors(lcd->relation, AccessShareLock, NULL);
+
+    foreach (lc, relids) {
+        label_cache_data *child = search_label_relation_cache(lfirst_oid(lc));
+        A_Const *n;
+
+        if (child == NULL || child->graph != cpstate->graph_oid)
+            continue;
+
+        n = makeNode(A_Const);
+        n->val.type = T_Integer;
+        n->val.val.ival = child->id;
+        n->location = -1;
+
+        label_ids = lappend(label_ids, n);
+    }
 
     catalog = makeString(CATALOG_SCHEMA);
     extract_label_id = makeString("_extract_label_id");
 
     fc = makeFuncCall(list_make2(catalog, extract_label_id), list_make1(id_field), COERCE_EXPLICIT_CALL, -1);
 
-    return makeSimpleCypherA_Expr(AEXPR_OP, "=", (Node *)fc, (Node *)n, -1);
+    if (list_length(label_ids) == 1)
+        return makeSimpleCypherA_Expr(AEXPR_OP, "=", (Node *)fc, linitial(label_ids), -1);
+
+    return makeSimpleCypherA_Expr(AEXPR_IN, "=", (Node *)fc, (Node *)label_ids, -1);
 }
 
 /*
@@ -3263,9 +3306,12 @@ static Node *create_property_constraints(cypher_parsestate *cpstate, transform_e
     ParseState *pstate = (ParseState *)cpstate;
     char *entity_name;
     ColumnRef *cr;
-    Node *prop_expr, *const_expr;
+    Node *prop_expr, *const_expr, *contains;
     Node *last_srf = pstate->p_last_srf;
     ParseNamespaceItem *pnsi;
+    cypher_map *cm;
+    List *quals = NIL;
+    ListCell *lc;
 
     cr = makeNode(ColumnRef);
 
@@ -3282,7 +3328,55 @@ static Node *create_property_constraints(cypher_parsestate *cpstate, transform_e
     // use cypher to get the constraints' transform node
     const_expr = transform_cypher_expr(cpstate, property_constraints, EXPR_KIND_WHERE);
 
-    return (Node *)make_op(pstate, list_make1(makeString("@>")), prop_expr, const_expr, last_srf, -1);
+    contains = (Node *)make_op(pstate, list_make1(makeString("@>")), prop_expr, const_expr, last_srf, -1);
+
+    if (!is_ag_node(property_constraints, cypher_map))
+        return contains;
+
+    /*
+     * The @> cannot use the btree indexes create_property_index builds on
+     * properties -> 'key'. For each key with a scalar literal, add the same
+     * expression compared to the literal, which the planner can match to
+     * such an index. A scalar value contains only what it equals, so the
+     * @> stays as the recheck for the remaining keys and literal kinds.
+     */
+    cm = (cypher_map *)property_constraints;
+    lc = list_head(cm->keyvals);
+    while (lc != NULL) {
+        Node *key = lfirst(lc);
+        Node *val, *key_const, *val_expr, *field;
+
+        lc = lnext(cm->keyvals, lc);
+        val = lfirst(lc);
+        lc = lnext(cm->keyvals, lc);
+
+        if (!is_scalar_literal(val))
+            continue;
+
+        val_expr = transform_cypher_expr(cpstate, val, EXPR_KIND_WHERE);
+        if (exprType(val_expr) != GTYPEOID)
+            continue;
+
+        key_const = (Node *)makeConst(GTYPEOID, -1, InvalidOid, -1, string_to_gtype(strVal(key)), false, false);
+        field = (Node *)make_op(pstate, list_make1(makeString("->")), copyObject(prop_expr), key_const, last_srf, -1);
+
+        quals = lappend(quals, make_op(pstate, list_make1(makeString("=")), field, val_expr, last_srf, -1));
+    }
+
+    if (quals == NIL)
+        return contains;
+
+    return (Node *)makeBoolExpr(AND_EXPR, lappend(quals, contains), -1);
+}
+
+/*
+ * Whether the node is a non-null scalar literal of a property map.
+ */
+static bool is_scalar_literal(Node *node) {
+    if (IsA(node, A_Const))
+        return ((A_Const *)node)->val.type != T_Null;
+
+    return is_ag_node(node, cypher_bool_const);
 }
 
 
@@ -3365,6 +3459,77 @@ static transform_entity *transform_VLE_edge_entity(cypher_parsestate *cpstate, c
     return entity;
 }
 
+/*
+ * Is the vertex already bound when the MATCH reaches it, by an earlier clause
+ * or an earlier part of the pattern.
+ */
+static bool is_vertex_bound(cypher_parsestate *cpstate, Query *query, cypher_node *node) {
+    if (node->name == NULL)
+        return false;
+
+    return find_variable(cpstate, node->name) != NULL ||
+           findTarget(query->targetList, node->name) != NULL ||
+           colNameToVar(&cpstate->pstate, node->name, false, node->location) != NULL;
+}
+
+/*
+ * Transform a variable length edge to an end vertex that isn't bound yet. The
+ * end vertices are found by one traversal from the start vertex, which returns
+ * each end vertex along with the path to it, rather than by scanning the
+ * vertices and running the traversal for every pair.
+ */
+static void transform_VLE_single_source(cypher_parsestate *cpstate, Query *query, cypher_node *prev_node,
+                                        cypher_relationship *rel, cypher_node *node,
+                                        transform_entity **vle_entity, transform_entity **next_entity) {
+    ParseState *pstate = (ParseState *)cpstate;
+    cypher_path path = { .kind = CYPHER_PATH_NORMAL };
+    FuncCall *fnode;
+    RangeFunction *rf;
+    ParseNamespaceItem *pnsi;
+    Node *var;
+    TargetEntry *te;
+    Expr *expr;
+
+    // check the label, the vertex itself comes from the traversal
+    transform_cypher_node(cpstate, node, &query->targetList, false);
+
+    if (node->name == NULL)
+        node->name = get_next_default_alias(cpstate);
+
+    if (rel->name == NULL)
+        rel->name = get_next_default_alias(cpstate);
+
+    fnode = make_vle_func_call(cpstate, &path, prev_node, rel, NULL);
+
+    rf = make_range_function(fnode, make_alias(node->name, NIL), false, false, false);
+    pnsi = add_vle_to_query(cpstate, (Node *)rf);
+
+    // the edges
+    var = scanNSItemForColumn(pstate, pnsi, 0, "edges", -1);
+    te = makeTargetEntry((Expr *)var, pstate->p_next_resno++, rel->name, false);
+    query->targetList = lappend(query->targetList, te);
+
+    *vle_entity = make_transform_entity(cpstate, ENT_VLE_EDGE, (Node *)rel, (Expr *)var, rel->name);
+
+    // the end vertex
+    expr = add_vertex_target_entries(cpstate, pnsi, node->name, &query->targetList);
+
+    *next_entity = make_transform_entity(cpstate, ENT_VERTEX, (Node *)node, expr, node->name);
+
+    if (!IS_DEFAULT_LABEL_VERTEX(node->label)) {
+        Node *id = scanNSItemForColumn(pstate, pnsi, 0, AG_VERTEX_COLNAME_ID, -1);
+
+        cpstate->property_constraint_quals = lappend(cpstate->property_constraint_quals,
+            transformExpr(pstate, (Node *)filter_vertices_on_label_id(cpstate, id, node->label), EXPR_KIND_WHERE));
+    }
+
+    if (node->props) {
+        Node *n = create_property_constraints(cpstate, *next_entity, node->props);
+
+        cpstate->property_constraint_quals = lappend(cpstate->property_constraint_quals, n);
+    }
+}
+
 /*
  * Iterate through the path and construct all edges and necessary vertices
  */
@@ -3398,11 +3563,29 @@ static List *transform_match_entities(cypher_parsestate *cpstate, Query *query,
 
             rel = list_nth(path->path, i);
             
-            if (!rel->varlen) {
+            if (!IS_PATH_FINDING_EDGE(path, rel)) {
         entity = handle_edge(cpstate, query, path, rel, i, lc, prev_node_entity);
 
                 cpstate->entities = lappend(cpstate->entities, entity);
                 entities = lappend(entities, entity);
+            } else if (path->kind == CYPHER_PATH_NORMAL &&
+                       !is_vertex_bound(cpstate, query, list_nth(path->path, i + 1))) {
+                transform_entity *vle_entity = NULL;
+                transform_entity *next_entity = NULL;
+
+                cypher_node *node = (cypher_node *)list_nth(path->path, i + 1);
+
+                transform_VLE_single_source(cpstate, query, prev_node_entity->entity.node, rel, node,
+                                            &vle_entity, &next_entity);
+
+                cpstate->entities = lappend(cpstate->entities, vle_entity);
+                entities = lappend(entities, vle_entity);
+                cpstate->entities = lappend(cpstate->entities, next_entity);
+                entities = lappend(entities, next_entity);
+
+                prev_node_entity = next_entity;
+
+                i++;
             } else {
                 transform_entity *vle_entity = NULL;
                 transform_entity *next_entity = NULL;
@@ -3418,7 +3601,7 @@ static List *transform_match_entities(cypher_parsestate *cpstate, Query *query,
                 cpstate->entities = lappend(cpstate->entities, next_entity);
                entities = lappend(entities, next_entity);
 
-                fnode = make_vle_func_call(cpstate, prev_node_entity->entity.node, rel, node);
+                fnode = make_vle_func_call(cpstate, path, prev_node_entity->entity.node, rel, node);
 
                 vle_entity = transform_VLE_edge_entity(cpstate, rel, query, fnode);
 
@@ -3827,9 +4010,6 @@ static Expr *transform_cypher_node(cypher_parsestate *cpstate, cypher_node *node
     char *rel_name;
     RangeVar *label_range_var;
     Alias *alias;
-    int resno;
-    TargetEntry *te;
-    Expr *expr;
     ParseNamespaceItem *pnsi;
 
     if (!node->label) {
@@ -3895,19 +4075,32 @@ static Expr *transform_cypher_node(cypher_parsestate *cpstate, cypher_node *node
 
     addNSItemToQuery(pstate, pnsi, true, true, true);
 
+    return add_vertex_target_entries(cpstate, pnsi, node->name, target_list);
+}
+
+/*
+ * Add the vertex, its id and its properties to the target list, taking them
+ * from the id and properties columns of the range table entry.
+ */
+static Expr *add_vertex_target_entries(cypher_parsestate *cpstate, ParseNamespaceItem *pnsi, char *name, List **target_list) {
+    ParseState *pstate = (ParseState *)cpstate;
+    int resno;
+    TargetEntry *te;
+    Expr *expr;
+
     resno = pstate->p_next_resno++;
 
     expr = (Expr *)make_vertex_expr(cpstate, pnsi);
 
     // make target entry and add it 
-    te = makeTargetEntry(expr, resno, node->name, false);
+    te = makeTargetEntry(expr, resno, name, false);
     *target_list = lappend(*target_list, te);
 
     // id field
     Node *id = scanNSItemForColumn(pstate, pnsi, 0, AG_VERTEX_COLNAME_ID, -1);
    resno = pstate->p_next_resno++;
 
-    te = makeTargetEntry(id, resno, make_id_alias(node->name), false);
+    te = makeTargetEntry(id, resno, make_id_alias(name), false);
     *target_list = lappend(*target_list, te);
 
     /*
@@ -3916,7 +4109,7 @@ static Expr *transform_cypher_node(cypher_parsestate *cpstate, cypher_node *node
     Node *props = scanNSItemForColumn(pstate, pnsi, 0, AG_VERTEX_COLNAME_PROPERTIES, -1);
    resno = pstate->p_next_resno++;
 
-    te = makeTargetEntry(props, resno, make_property_alias(node->name), false);
+    te = makeTargetEntry(props, resno, make_property_alias(name), false);
     *target_list = lappend(*target_list, te);
 
 
@@ -2600,7 +2600,9 @@ make_qualified_function_name(cypher_parsestate *cpstate, List *lst, List *targs)
         fname = list_make2(makeString(CATALOG_SCHEMA), makeString(ag_name));
 
     // Some functions need the graph name passed to them in order to work
-    if (strcmp("vle", ag_name) == 0) {
+    if (strcmp("vle", ag_name) == 0 || strcmp("vle_single_source", ag_name) == 0 ||
+        strcmp("shortest_path", ag_name) == 0 ||
+        strcmp("all_shortest_paths", ag_name) == 0 || strcmp("weighted_shortest_path", ag_name) == 0) {
         char *graph_name = cpstate->graph_name;
         Datum d = string_to_gtype(graph_name);
         Const *c = makeConst(GTYPEOID, -1, InvalidOid, -1, d, false, false);
@@ -586,7 +586,7 @@ makeSimpleCypherA_Expr(A_Expr_Kind kind, char *name,
 
 /* pattern */
 %type <list> pattern simple_path_opt_parens simple_path
-%type <node> path anonymous_path
+%type <node> path anonymous_path shortest_path
              path_node path_relationship path_relationship_body
              properties_opt
 %type <string> label_opt 
@@ -16798,7 +16798,44 @@ path:
 
             $$ = (Node *)p;
         }
+    | shortest_path
+    | cypher_var_name '=' shortest_path /* named shortest path */
+        {
+            cypher_path *p;
+
+            p = (cypher_path *)$3;
+            p->var_name = $1;
+
+            $$ = (Node *)p;
+        }
+    ;
+
+/* shortestPath() and allShortestPaths() over a single relationship */
+shortest_path:
+    IDENTIFIER '(' anonymous_path ')'
+        {
+            cypher_path *p = (cypher_path *)$3;
+
+            if (pg_strcasecmp($1, "shortestpath") == 0)
+                p->kind = CYPHER_PATH_SHORTEST;
+            else if (pg_strcasecmp($1, "allshortestpaths") == 0)
+                p->kind = CYPHER_PATH_ALL_SHORTEST;
+            else
+                ereport(ERROR,
+                        (errcode(ERRCODE_SYNTAX_ERROR),
+                         errmsg("%s is not a path function", $1),
+                         ag_scanner_errposition(@1, scanner)));
+
+            if (list_length(p->path) != 3)
+                ereport(ERROR,
+                        (errcode(ERRCODE_SYNTAX_ERROR),
+                         errmsg("%s requires a pattern with a single relationship", $1),
+                         ag_scanner_errposition(@1, scanner)));
+
+            p->location = @1;
 
+            $$ = (Node *)p;
+        }
     ;
 
 anonymous_path:
@@ -16809,6 +16846,7 @@ anonymous_path:
             n = make_ag_node(cypher_path);
             n->path = $1;
             n->var_name = NULL;
+            n->kind = CYPHER_PATH_NORMAL;
             n->location = @1;
 
             $$ = (Node *)n;
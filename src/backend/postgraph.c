@@ -26,6 +26,7 @@
 #include "nodes/ag_nodes.h"
 #include "optimizer/cypher_paths.h"
 #include "parser/cypher_analyze.h"
+#include "utils/global_graph.h"
 
 PG_MODULE_MAGIC;
 
@@ -40,6 +41,8 @@ void _PG_init(void)
     parse_analyze_init();
     parse_init();
     IvfflatInit();
+    global_graph_init();
+    label_commands_init();
 }
 
 void _PG_fini(void);
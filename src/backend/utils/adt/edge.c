@@ -43,6 +43,7 @@
 
 #include "catalog/ag_label.h"
 #include "commands/label_commands.h"
+#include "executor/cypher_utils.h"
 #include "utils/ag_cache.h"
 #include "utils/gtype.h"
 #include "utils/graphid.h"
@@ -50,7 +51,6 @@
 #include "utils/vertex.h"
 
 static void append_to_buffer(StringInfo buffer, const char *data, int len);
-static Datum get_vertex(Oid graph_oid, int64 graphid);
 static int edge_btree_fast_cmp(Datum x, Datum y, SortSupport ssup);
 
 /*
@@ -176,22 +176,8 @@ PG_FUNCTION_INFO_V1(edge_property_access_gtype);
 Datum
 edge_property_access_gtype(PG_FUNCTION_ARGS) {
     edge *v = AG_GET_ARG_EDGE(0);
-    gtype *agt = extract_edge_properties(v);
-    gtype *key = AG_GET_ARG_GTYPE_P(1);
-    gtype_value *key_value;
-
-    if (!AGT_ROOT_IS_SCALAR(key))
-        PG_RETURN_NULL();
-
-    key_value = get_ith_gtype_value_from_container(&key->root, 0);
 
-    if (key_value->type == AGTV_INTEGER)
-        AG_RETURN_GTYPE_P(gtype_array_element_impl(fcinfo, agt, key_value->val.int_value, false));
-    else if (key_value->type == AGTV_STRING)
-        AG_RETURN_GTYPE_P(gtype_object_field_impl(fcinfo, agt, key_value->val.string.val,
-                                                    key_value->val.string.len, false));
-    else
-        PG_RETURN_NULL();
+    return gtype_field_access_impl(fcinfo, extract_edge_properties(v), AG_GET_ARG_GTYPE_P(1));
 }
 
 
@@ -375,37 +361,63 @@ Datum edge_endnode(PG_FUNCTION_ARGS) {
 }
 
 
-static Datum get_vertex(Oid graph_oid, int64 graphid)
+Datum get_vertex(Oid graph_oid, int64 graphid)
 {
-    ScanKeyData scan_keys[1];
     Relation graph_vertex_label;
-    TableScanDesc scan_desc;
-    HeapTuple tuple;
-    TupleDesc tupdesc;
+    TupleTableSlot *slot;
     Datum properties, result;
+    bool isnull;
     int32 labelid = (graphid >> ENTRY_ID_BITS);
     
     label_cache_data *lcd = search_label_graph_oid_cache(graph_oid, labelid);
 
     Snapshot snapshot = GetActiveSnapshot();
 
-    ScanKeyInit(&scan_keys[0], 1, BTEqualStrategyNumber, F_OIDEQ, Int64GetDatum(graphid));
-
     graph_vertex_label = table_open(lcd->relation, ShareLock);
-    scan_desc = table_beginscan(graph_vertex_label, snapshot, 1, scan_keys);
-    tuple = heap_getnext(scan_desc, ForwardScanDirection);
+    slot = table_slot_create(graph_vertex_label, NULL);
 
-    if (!HeapTupleIsValid(tuple))
+    if (!find_entity_tuple(graph_vertex_label, snapshot, graphid, slot))
         ereport(ERROR, (errcode(ERRCODE_UNDEFINED_TABLE), errmsg("id %lu does not exist", graphid)));
 
-    tupdesc = RelationGetDescr(graph_vertex_label);
+    properties = slot_getattr(slot, Anum_ag_label_vertex_table_properties, &isnull);
 
-    properties = column_get_datum(tupdesc, tuple, 1, "properties", GTYPEOID, true);
+    result = VERTEX_GET_DATUM(create_vertex(graphid, graph_oid, DATUM_GET_GTYPE_P(properties)));
 
-    table_endscan(scan_desc);
+    ExecDropSingleTupleTableSlot(slot);
     table_close(graph_vertex_label, ShareLock);
 
-    return VERTEX_GET_DATUM(create_vertex(graphid, graph_oid, DATUM_GET_GTYPE_P(properties)));
+    return result;
+}
+
+Datum get_edge(Oid graph_oid, int64 graphid)
+{
+    Relation graph_edge_label;
+    TupleTableSlot *slot;
+    Datum start_id, end_id, properties, result;
+    bool isnull;
+    int32 labelid = (graphid >> ENTRY_ID_BITS);
+
+    label_cache_data *lcd = search_label_graph_oid_cache(graph_oid, labelid);
+
+    Snapshot snapshot = GetActiveSnapshot();
+
+    graph_edge_label = table_open(lcd->relation, ShareLock);
+    slot = table_slot_create(graph_edge_label, NULL);
+
+    if (!find_entity_tuple(graph_edge_label, snapshot, graphid, slot))
+        ereport(ERROR, (errcode(ERRCODE_UNDEFINED_TABLE), errmsg("id %lu does not exist", graphid)));
+
+    start_id = slot_getattr(slot, Anum_ag_label_edge_table_start_id, &isnull);
+    end_id = slot_getattr(slot, Anum_ag_label_edge_table_end_id, &isnull);
+    properties = slot_getattr(slot, Anum_ag_label_edge_table_properties, &isnull);
+
+    result = EDGE_GET_DATUM(create_edge(graphid, DATUM_GET_GRAPHID(start_id), DATUM_GET_GRAPHID(end_id),
+                                        graph_oid, DATUM_GET_GTYPE_P(properties)));
+
+    ExecDropSingleTupleTableSlot(slot);
+    table_close(graph_edge_label, ShareLock);
+
+    return result;
 }
 
 PG_FUNCTION_INFO_V1(edge_unnest);
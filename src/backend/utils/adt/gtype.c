@@ -40,6 +40,7 @@
 #include "catalog/pg_aggregate_d.h"
 #include "catalog/pg_collation_d.h"
 #include "catalog/pg_operator_d.h"
+#include "common/int.h"
 #include "executor/nodeAgg.h"
 #include "funcapi.h"
 #include "libpq/pqformat.h"
@@ -48,16 +49,19 @@
 #include "portability/instr_time.h"
 #include "nodes/pg_list.h"
 #include "utils/builtins.h"
+#include "utils/datum.h"
 #include "utils/float.h"
 #include "utils/fmgroids.h"
 #include "utils/int8.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/snapmgr.h"
 #include "utils/timestamp.h"
 #include "utils/typcache.h"
 
 #include "utils/gtype.h"
+#include "utils/gtype_ext.h"
 #include "utils/edge.h"
 #include "utils/variable_edge.h"
 #include "utils/vector.h"
@@ -1618,25 +1622,35 @@ static gtype_value *execute_array_access_operator_internal(gtype *array, int64 a
     return get_ith_gtype_value_from_container(&array->root, array_index);
 }
 
-PG_FUNCTION_INFO_V1(gtype_field_access);
-Datum gtype_field_access(PG_FUNCTION_ARGS)
+/*
+ * The -> operator with a gtype key, shared with the vertex and edge
+ * versions. The key is read in place rather than through a palloc'd
+ * gtype_value: strings index objects, integers index arrays.
+ */
+Datum gtype_field_access_impl(FunctionCallInfo fcinfo, gtype *gtype_in, gtype *key)
 {
-    gtype *agt = AG_GET_ARG_GTYPE_P(0);
-    gtype *key = AG_GET_ARG_GTYPE_P(1);
-    gtype_value *key_value;
+    gtype_container *key_root = &key->root;
+    gtype_value int_key;
 
     if (!AGT_ROOT_IS_SCALAR(key))
         PG_RETURN_NULL();
 
-    key_value = get_ith_gtype_value_from_container(&key->root, 0);
+    if (GTE_IS_STRING(key_root->children[0]))
+        return gtype_object_field_impl(fcinfo, gtype_in, (char *)&key_root->children[1],
+                                       get_gtype_length(key_root, 0), false);
 
-    if (key_value->type == AGTV_INTEGER)
-        AG_RETURN_GTYPE_P(gtype_array_element_impl(fcinfo, agt, key_value->val.int_value, false));
-    else if (key_value->type == AGTV_STRING)
-        AG_RETURN_GTYPE_P(gtype_object_field_impl(fcinfo, agt, key_value->val.string.val,
-                                                    key_value->val.string.len, false));
-    else
+    if (!is_gtype_integer(key))
         PG_RETURN_NULL();
+
+    ag_deserialize_extended_type((char *)&key_root->children[1], 0, &int_key);
+
+    return gtype_array_element_impl(fcinfo, gtype_in, int_key.val.int_value, false);
+}
+
+PG_FUNCTION_INFO_V1(gtype_field_access);
+Datum gtype_field_access(PG_FUNCTION_ARGS)
+{
+    return gtype_field_access_impl(fcinfo, AG_GET_ARG_GTYPE_P(0), AG_GET_ARG_GTYPE_P(1));
 }
 
 static Datum process_access_operator_result(FunctionCallInfo fcinfo, gtype_value *agtv, bool as_text)
@@ -1688,6 +1702,18 @@ Datum gtype_object_field_impl(FunctionCallInfo fcinfo, gtype *gtype_in, char *ke
     if (!AGT_ROOT_IS_OBJECT(gtype_in))
         PG_RETURN_NULL();
 
+    // copy the value's binary form straight into the result, the only allocation needed
+    if (!as_text) {
+        gtentry entry;
+        char *data;
+        uint32 len;
+
+        if (!find_gtype_slice_from_object(agtc, key, key_len, &entry, &data, &len) || GTE_IS_NULL(entry))
+            PG_RETURN_NULL();
+
+        return GTYPE_P_GET_DATUM(gtype_slice_to_gtype(entry, data, len));
+    }
+
     v = find_gtype_value_from_container(agtc, GT_FOBJECT, &new_key_value);
 
     return process_access_operator_result(fcinfo, v, as_text);
@@ -2310,42 +2336,352 @@ gtype_value *alter_property_value(gtype *properties, char *var_name,
 }
 
 /*
- * Transfer function for age_sum(gtype, gtype).
+ * Transition state for sum(gtype).
  *
- * Note: that the running sum will change type depending on the
- * precision of the input. The most precise value determines the
- * result type.
+ * The running sum is kept in a native accumulator and only turned back
+ * into a gtype by the final function. The most precise input determines
+ * the result type: integer, then float, then numeric. An integer sum that
+ * overflows int64 is promoted to numeric.
  */
-PG_FUNCTION_INFO_V1(gtype_gtype_sum);
-Datum gtype_gtype_sum(PG_FUNCTION_ARGS) {
-    gtype *lhs = AG_GET_ARG_GTYPE_P(0);
-    gtype *rhs = AG_GET_ARG_GTYPE_P(1);
+typedef struct gtype_sum_state
+{
+    enum gtype_value_type type;
+    int64 int_value;
+    float8 float_value;
+    Numeric numeric;
+} gtype_sum_state;
+
+static int gtype_sum_rank(enum gtype_value_type type)
+{
+    switch (type)
+    {
+        case AGTV_INTEGER:
+            return 0;
+        case AGTV_FLOAT:
+            return 1;
+        default:
+            return 2;
+    }
+}
+
+static enum gtype_value_type gtype_sum_input_type(gtype *agt)
+{
+    if (is_gtype_numeric(agt))
+        return AGTV_NUMERIC;
+    else if (is_gtype_float(agt))
+        return AGTV_FLOAT;
+
+    return AGTV_INTEGER;
+}
+
+/*
+ * Read an integer or float scalar straight out of the container. Anything
+ * else goes through the regular typecasting routines.
+ */
+static int64 gtype_sum_get_int8(gtype *agt)
+{
+    gtype_value gtv;
+
+    if (!is_gtype_integer(agt))
+        return DatumGetInt64(convert_to_scalar(gtype_to_int8_internal, agt, "int"));
+
+    ag_deserialize_extended_type((char *)&agt->root.children[1], 0, &gtv);
+
+    return gtv.val.int_value;
+}
 
+static float8 gtype_sum_get_float8(gtype *agt)
+{
     gtype_value gtv;
-    if (is_gtype_numeric(lhs) || is_gtype_numeric(rhs))
-        gtv.type = AGTV_NUMERIC;
-    else if (is_gtype_float(lhs) || is_gtype_float(rhs))
-        gtv.type = AGTV_FLOAT;
+
+    if (!is_gtype_integer(agt) && !is_gtype_float(agt))
+        return DatumGetFloat8(convert_to_scalar(gtype_to_float8_internal, agt, "float"));
+
+    ag_deserialize_extended_type((char *)&agt->root.children[1], 0, &gtv);
+
+    if (gtv.type == AGTV_INTEGER)
+        return (float8)gtv.val.int_value;
+
+    return gtv.val.float_value;
+}
+
+static Numeric gtype_sum_get_numeric(gtype *agt)
+{
+    // numerics are stored as is, so they can be used without a copy
+    if (is_gtype_numeric(agt))
+        return (Numeric)&agt->root.children[1];
+
+    return DatumGetNumeric(convert_to_scalar(gtype_to_numeric_internal, agt, "numeric"));
+}
+
+// widen the accumulator to the given type, must be called in the aggregate context
+static void gtype_sum_promote(gtype_sum_state *state, enum gtype_value_type type)
+{
+    if (gtype_sum_rank(type) <= gtype_sum_rank(state->type))
+        return;
+
+    if (type == AGTV_FLOAT)
+        state->float_value = (float8)state->int_value;
+    else if (state->type == AGTV_INTEGER)
+        state->numeric = int64_to_numeric(state->int_value);
     else
-        gtv.type = AGTV_INTEGER;
+        state->numeric = DatumGetNumeric(DirectFunctionCall1(float8_numeric, Float8GetDatum(state->float_value)));
+
+    state->type = type;
+}
+
+static void gtype_sum_add_numeric(gtype_sum_state *state, Numeric value)
+{
+    Numeric old = state->numeric;
+
+    state->numeric = DatumGetNumeric(DirectFunctionCall2(numeric_add, NumericGetDatum(old), NumericGetDatum(value)));
+
+    pfree(old);
+}
+
+static void gtype_sum_add_int8(gtype_sum_state *state, int64 value)
+{
+    int64 result;
 
-    Datum x, y;
-    switch(gtv.type)
+    if (!pg_add_s64_overflow(state->int_value, value, &result))
+    {
+        state->int_value = result;
+        return;
+    }
+
+    // promote to numeric rather than fail on overflow
+    gtype_sum_promote(state, AGTV_NUMERIC);
+    gtype_sum_add_numeric(state, int64_to_numeric(value));
+}
+
+/*
+ * Transition function for sum(gtype). Inputs are converted in the caller's
+ * memory context; only the accumulator lives in the aggregate context.
+ */
+PG_FUNCTION_INFO_V1(gtype_sum_transfn);
+Datum gtype_sum_transfn(PG_FUNCTION_ARGS) {
+    MemoryContext agg_context;
+    MemoryContext old_mcxt;
+    gtype_sum_state *state;
+    enum gtype_value_type type;
+    gtype *agt;
+    int64 int_value = 0;
+    float8 float_value = 0;
+    Numeric numeric = NULL;
+
+    if (!AggCheckCallContext(fcinfo, &agg_context))
+        elog(ERROR, "gtype_sum_transfn called in non-aggregate context");
+
+    state = PG_ARGISNULL(0) ? NULL : (gtype_sum_state *)PG_GETARG_POINTER(0);
+
+    if (PG_ARGISNULL(1))
+        AGG_RETURN_STATE(state);
+
+    agt = AG_GET_ARG_GTYPE_P(1);
+
+    type = gtype_sum_input_type(agt);
+    if (state != NULL && gtype_sum_rank(state->type) > gtype_sum_rank(type))
+        type = state->type;
+
+    switch (type)
     {
         case AGTV_INTEGER:
-            x = convert_to_scalar(gtype_to_int8_internal, lhs, "int");
-	    y = convert_to_scalar(gtype_to_int8_internal, rhs, "int");
-	    gtv.val.int_value = DatumGetInt64(DirectFunctionCall2(int8pl, x, y));
-	    break;
+            int_value = gtype_sum_get_int8(agt);
+            break;
+        case AGTV_FLOAT:
+            float_value = gtype_sum_get_float8(agt);
+            break;
+        default:
+            numeric = gtype_sum_get_numeric(agt);
+            break;
+    }
+
+    old_mcxt = MemoryContextSwitchTo(agg_context);
+
+    if (state == NULL)
+    {
+        state = palloc0(sizeof(gtype_sum_state));
+        state->type = type;
+        state->int_value = int_value;
+        state->float_value = float_value;
+        if (type == AGTV_NUMERIC)
+            state->numeric = DatumGetNumeric(datumCopy(NumericGetDatum(numeric), false, -1));
+    }
+    else
+    {
+        gtype_sum_promote(state, type);
+
+        switch (type)
+        {
+            case AGTV_INTEGER:
+                gtype_sum_add_int8(state, int_value);
+                break;
+            case AGTV_FLOAT:
+                state->float_value = float8_pl(state->float_value, float_value);
+                break;
+            default:
+                gtype_sum_add_numeric(state, numeric);
+                break;
+        }
+    }
+
+    MemoryContextSwitchTo(old_mcxt);
+
+    PG_RETURN_POINTER(state);
+}
+
+PG_FUNCTION_INFO_V1(gtype_sum_combinefn);
+Datum gtype_sum_combinefn(PG_FUNCTION_ARGS) {
+    MemoryContext agg_context;
+    MemoryContext old_mcxt;
+    gtype_sum_state *state1;
+    gtype_sum_state *state2;
+
+    if (!AggCheckCallContext(fcinfo, &agg_context))
+        elog(ERROR, "gtype_sum_combinefn called in non-aggregate context");
+
+    state1 = PG_ARGISNULL(0) ? NULL : (gtype_sum_state *)PG_GETARG_POINTER(0);
+    state2 = PG_ARGISNULL(1) ? NULL : (gtype_sum_state *)PG_GETARG_POINTER(1);
+
+    if (state2 == NULL)
+        AGG_RETURN_STATE(state1);
+
+    old_mcxt = MemoryContextSwitchTo(agg_context);
+
+    if (state1 == NULL)
+    {
+        state1 = palloc(sizeof(gtype_sum_state));
+        memcpy(state1, state2, sizeof(gtype_sum_state));
+
+        if (state1->type == AGTV_NUMERIC)
+            state1->numeric = DatumGetNumeric(datumCopy(NumericGetDatum(state2->numeric), false, -1));
+
+        MemoryContextSwitchTo(old_mcxt);
+        PG_RETURN_POINTER(state1);
+    }
+
+    gtype_sum_promote(state1, state2->type);
+
+    switch (state1->type)
+    {
+        case AGTV_INTEGER:
+            gtype_sum_add_int8(state1, state2->int_value);
+            break;
+        case AGTV_FLOAT:
+            if (state2->type == AGTV_INTEGER)
+                state1->float_value = float8_pl(state1->float_value, (float8)state2->int_value);
+            else
+                state1->float_value = float8_pl(state1->float_value, state2->float_value);
+            break;
+        default:
+            if (state2->type == AGTV_INTEGER)
+                gtype_sum_add_numeric(state1, int64_to_numeric(state2->int_value));
+            else if (state2->type == AGTV_FLOAT)
+                gtype_sum_add_numeric(state1, DatumGetNumeric(DirectFunctionCall1(float8_numeric,
+                                                                                  Float8GetDatum(state2->float_value))));
+            else
+                gtype_sum_add_numeric(state1, state2->numeric);
+            break;
+    }
+
+    MemoryContextSwitchTo(old_mcxt);
+
+    PG_RETURN_POINTER(state1);
+}
+
+PG_FUNCTION_INFO_V1(gtype_sum_serialize);
+Datum gtype_sum_serialize(PG_FUNCTION_ARGS) {
+    gtype_sum_state *state;
+    StringInfoData buf;
+
+    if (!AggCheckCallContext(fcinfo, NULL))
+        elog(ERROR, "gtype_sum_serialize called in non-aggregate context");
+
+    state = (gtype_sum_state *)PG_GETARG_POINTER(0);
+
+    pq_begintypsend(&buf);
+
+    pq_sendint32(&buf, state->type);
+
+    switch (state->type)
+    {
+        case AGTV_INTEGER:
+            pq_sendint64(&buf, state->int_value);
+            break;
+        case AGTV_FLOAT:
+            pq_sendfloat8(&buf, state->float_value);
+            break;
+        default:
+        {
+            bytea *numeric = DatumGetByteaPP(DirectFunctionCall1(numeric_send, NumericGetDatum(state->numeric)));
+
+            pq_sendbytes(&buf, VARDATA_ANY(numeric), VARSIZE_ANY_EXHDR(numeric));
+            break;
+        }
+    }
+
+    PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+PG_FUNCTION_INFO_V1(gtype_sum_deserialize);
+Datum gtype_sum_deserialize(PG_FUNCTION_ARGS) {
+    bytea *sstate;
+    gtype_sum_state *state;
+    StringInfoData buf;
+
+    if (!AggCheckCallContext(fcinfo, NULL))
+        elog(ERROR, "gtype_sum_deserialize called in non-aggregate context");
+
+    sstate = PG_GETARG_BYTEA_PP(0);
+
+    initStringInfo(&buf);
+    appendBinaryStringInfo(&buf, VARDATA_ANY(sstate), VARSIZE_ANY_EXHDR(sstate));
+
+    state = palloc0(sizeof(gtype_sum_state));
+    state->type = (enum gtype_value_type)pq_getmsgint(&buf, 4);
+
+    switch (state->type)
+    {
+        case AGTV_INTEGER:
+            state->int_value = pq_getmsgint64(&buf);
+            break;
+        case AGTV_FLOAT:
+            state->float_value = pq_getmsgfloat8(&buf);
+            break;
+        default:
+            state->numeric = DatumGetNumeric(DirectFunctionCall3(numeric_recv, PointerGetDatum(&buf),
+                                                                 ObjectIdGetDatum(InvalidOid), Int32GetDatum(-1)));
+            break;
+    }
+
+    pq_getmsgend(&buf);
+    pfree(buf.data);
+
+    PG_RETURN_POINTER(state);
+}
+
+PG_FUNCTION_INFO_V1(gtype_sum_finalfn);
+Datum gtype_sum_finalfn(PG_FUNCTION_ARGS) {
+    gtype_sum_state *state;
+    gtype_value gtv;
+
+    if (PG_ARGISNULL(0))
+        PG_RETURN_NULL();
+
+    state = (gtype_sum_state *)PG_GETARG_POINTER(0);
+
+    gtv.type = state->type;
+
+    switch (state->type)
+    {
+        case AGTV_INTEGER:
+            gtv.val.int_value = state->int_value;
+            break;
         case AGTV_FLOAT:
-            x = convert_to_scalar(gtype_to_float8_internal, lhs, "float");
-            y = convert_to_scalar(gtype_to_float8_internal, rhs, "float");
-	    gtv.val.float_value = DatumGetFloat8(DirectFunctionCall2(float8pl, x, y));
+            gtv.val.float_value = state->float_value;
             break;
-        case AGTV_NUMERIC:
-            x = convert_to_scalar(gtype_to_numeric_internal, lhs, "numeric");
-            y = convert_to_scalar(gtype_to_numeric_internal, rhs, "numeric");
-	    gtv.val.numeric = DatumGetNumeric(DirectFunctionCall2(numeric_add, x, y));
+        default:
+            gtv.val.numeric = state->numeric;
             break;
     }
 
@@ -2394,24 +2730,149 @@ REGRESSIONAGGFINAL(stddev_samp);
 REGRESSIONAGGFINAL(stddev_pop);
 
 
-PG_FUNCTION_INFO_V1(gtype_max_trans);
+/*
+ * Transition state for min(gtype) and max(gtype).
+ *
+ * The current extreme is kept as a copy of the winning gtype. The buffer
+ * is reused whenever the new winner fits, so rows that don't change the
+ * result cost only the comparison.
+ */
+typedef struct gtype_extreme_state
+{
+    gtype *value;
+    Size size;
+} gtype_extreme_state;
 
-Datum gtype_max_trans(PG_FUNCTION_ARGS)
+// must be called in the aggregate context
+static gtype_extreme_state *gtype_extreme_set(gtype_extreme_state *state, gtype *agt)
 {
-    gtype *lhs = AG_GET_ARG_GTYPE_P(0);
-    gtype *rhs = AG_GET_ARG_GTYPE_P(1);
+    Size size = VARSIZE(agt);
 
-    AG_RETURN_GTYPE_P((compare_gtype_containers_orderability(&lhs->root, &rhs->root) >= 0) ? lhs : rhs);
+    if (state == NULL)
+    {
+        state = palloc(sizeof(gtype_extreme_state));
+        state->value = palloc(size);
+        state->size = size;
+    }
+    else if (state->size < size)
+    {
+        state->value = repalloc(state->value, size);
+        state->size = size;
+    }
+
+    memcpy(state->value, agt, size);
+
+    return state;
 }
 
-PG_FUNCTION_INFO_V1(gtype_min_trans);
+/*
+ * Shared body of the min and max transition and combine functions. The
+ * value replaces the state when its comparison with the current extreme
+ * has the sign given by direction.
+ */
+static gtype_extreme_state *gtype_extreme_accum(FunctionCallInfo fcinfo, gtype_extreme_state *state,
+                                                gtype *agt, int direction)
+{
+    MemoryContext agg_context;
+    MemoryContext old_mcxt;
+    int cmp;
 
-Datum gtype_min_trans(PG_FUNCTION_ARGS)
+    if (!AggCheckCallContext(fcinfo, &agg_context))
+        elog(ERROR, "min/max transition function called in non-aggregate context");
+
+    if (state != NULL)
+    {
+        cmp = compare_gtype_containers_orderability(&agt->root, &state->value->root);
+
+        if (cmp == 0 || (cmp > 0) != (direction > 0))
+            return state;
+    }
+
+    old_mcxt = MemoryContextSwitchTo(agg_context);
+    state = gtype_extreme_set(state, agt);
+    MemoryContextSwitchTo(old_mcxt);
+
+    return state;
+}
+
+PG_FUNCTION_INFO_V1(gtype_max_transfn);
+Datum gtype_max_transfn(PG_FUNCTION_ARGS)
 {
-    gtype *lhs = AG_GET_ARG_GTYPE_P(0);
-    gtype *rhs = AG_GET_ARG_GTYPE_P(1);
+    gtype_extreme_state *state = PG_ARGISNULL(0) ? NULL : (gtype_extreme_state *)PG_GETARG_POINTER(0);
+
+    if (PG_ARGISNULL(1))
+        AGG_RETURN_STATE(state);
+
+    PG_RETURN_POINTER(gtype_extreme_accum(fcinfo, state, AG_GET_ARG_GTYPE_P(1), 1));
+}
+
+PG_FUNCTION_INFO_V1(gtype_min_transfn);
+Datum gtype_min_transfn(PG_FUNCTION_ARGS)
+{
+    gtype_extreme_state *state = PG_ARGISNULL(0) ? NULL : (gtype_extreme_state *)PG_GETARG_POINTER(0);
+
+    if (PG_ARGISNULL(1))
+        AGG_RETURN_STATE(state);
+
+    PG_RETURN_POINTER(gtype_extreme_accum(fcinfo, state, AG_GET_ARG_GTYPE_P(1), -1));
+}
+
+PG_FUNCTION_INFO_V1(gtype_max_combinefn);
+Datum gtype_max_combinefn(PG_FUNCTION_ARGS)
+{
+    gtype_extreme_state *state = PG_ARGISNULL(0) ? NULL : (gtype_extreme_state *)PG_GETARG_POINTER(0);
+
+    if (PG_ARGISNULL(1))
+        AGG_RETURN_STATE(state);
+
+    PG_RETURN_POINTER(gtype_extreme_accum(fcinfo, state, ((gtype_extreme_state *)PG_GETARG_POINTER(1))->value, 1));
+}
+
+PG_FUNCTION_INFO_V1(gtype_min_combinefn);
+Datum gtype_min_combinefn(PG_FUNCTION_ARGS)
+{
+    gtype_extreme_state *state = PG_ARGISNULL(0) ? NULL : (gtype_extreme_state *)PG_GETARG_POINTER(0);
+
+    if (PG_ARGISNULL(1))
+        AGG_RETURN_STATE(state);
 
-    AG_RETURN_GTYPE_P((compare_gtype_containers_orderability(&lhs->root, &rhs->root) <= 0) ? lhs : rhs);
+    PG_RETURN_POINTER(gtype_extreme_accum(fcinfo, state, ((gtype_extreme_state *)PG_GETARG_POINTER(1))->value, -1));
+}
+
+// the state is a plain gtype, so its varlena doubles as the serialized form
+PG_FUNCTION_INFO_V1(gtype_extreme_serialize);
+Datum gtype_extreme_serialize(PG_FUNCTION_ARGS)
+{
+    gtype_extreme_state *state;
+
+    if (!AggCheckCallContext(fcinfo, NULL))
+        elog(ERROR, "gtype_extreme_serialize called in non-aggregate context");
+
+    state = (gtype_extreme_state *)PG_GETARG_POINTER(0);
+
+    PG_RETURN_BYTEA_P(DatumGetByteaPCopy(PointerGetDatum(state->value)));
+}
+
+PG_FUNCTION_INFO_V1(gtype_extreme_deserialize);
+Datum gtype_extreme_deserialize(PG_FUNCTION_ARGS)
+{
+    if (!AggCheckCallContext(fcinfo, NULL))
+        elog(ERROR, "gtype_extreme_deserialize called in non-aggregate context");
+
+    PG_RETURN_POINTER(gtype_extreme_set(NULL, (gtype *)PG_GETARG_BYTEA_P(0)));
+}
+
+PG_FUNCTION_INFO_V1(gtype_extreme_finalfn);
+Datum gtype_extreme_finalfn(PG_FUNCTION_ARGS)
+{
+    gtype_extreme_state *state;
+
+    if (PG_ARGISNULL(0))
+        PG_RETURN_NULL();
+
+    state = (gtype_extreme_state *)PG_GETARG_POINTER(0);
+
+    AG_RETURN_GTYPE_P(DatumGetPointer(datumCopy(PointerGetDatum(state->value), false, -1)));
 }
 
 // borrowed from PGs float8 routines for percentile_cont 
@@ -2629,57 +3090,228 @@ Datum gtype_percentile_disc_aggfinalfn(PG_FUNCTION_ARGS)
     PG_RETURN_POINTER(gtype_value_to_gtype(&agtv_float));
 }
 
+/*
+ * Transition state for collect(gtype).
+ *
+ * Elements are appended in their final binary form: entries holds one
+ * gtentry per element, carrying its length, and data holds the
+ * concatenated element payloads. Payloads that need alignment are padded
+ * relative to the start of data, so the final function only has to add the
+ * array header and turn every GT_OFFSET_STRIDE'th length into an offset.
+ */
+typedef struct gtype_collect_state
+{
+    StringInfoData entries;
+    StringInfoData data;
+    int nelems;
+} gtype_collect_state;
+
+static gtype_collect_state *gtype_collect_make_state(MemoryContext agg_context)
+{
+    MemoryContext old_mcxt = MemoryContextSwitchTo(agg_context);
+    gtype_collect_state *state = palloc(sizeof(gtype_collect_state));
+
+    initStringInfo(&state->entries);
+    initStringInfo(&state->data);
+    state->nelems = 0;
+
+    MemoryContextSwitchTo(old_mcxt);
+
+    return state;
+}
+
+/*
+ * Append one element. Strings, booleans and nulls are stored unaligned;
+ * numerics, extended types and containers are read with INTALIGN and so
+ * start on an int boundary, the padding counting towards their length.
+ */
+static void gtype_collect_append(gtype_collect_state *state, gtentry type, char *payload, int len)
+{
+    gtentry entry;
+    int padlen = 0;
+
+    if (type == GTENTRY_IS_NUMERIC || type == GTENTRY_IS_GTYPE || type == GTENTRY_IS_CONTAINER)
+        padlen = pad_buffer_to_int(&state->data);
+
+    appendBinaryStringInfo(&state->data, payload, len);
+
+    if (state->data.len > GTENTRY_OFFLENMASK)
+        ereport(ERROR, (errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+                        errmsg("total size of gtype array elements exceeds the maximum of %u bytes",
+                               GTENTRY_OFFLENMASK)));
+
+    entry = type | (padlen + len);
+    appendBinaryStringInfo(&state->entries, (char *)&entry, sizeof(gtentry));
+    state->nelems++;
+}
+
+static void gtype_collect_append_gtype(gtype_collect_state *state, gtype *agt)
+{
+    gtype_container *root = &agt->root;
+
+    // a scalar is stored as a one element array, take its only element
+    if (GTYPE_CONTAINER_IS_SCALAR(root))
+        gtype_collect_append(state, root->children[0] & GTENTRY_TYPEMASK, (char *)&root->children[1],
+                             GTE_OFFLENFLD(root->children[0]));
+    else
+        gtype_collect_append(state, GTENTRY_IS_CONTAINER, (char *)root, VARSIZE(agt) - VARHDRSZ);
+}
+
+// append every element of src to state, re-padding them for their new positions
+static void gtype_collect_append_state(gtype_collect_state *state, gtype_collect_state *src)
+{
+    gtentry *entries = (gtentry *)src->entries.data;
+    int offset = 0;
+    int i;
+
+    for (i = 0; i < src->nelems; i++)
+    {
+        gtentry type = entries[i] & GTENTRY_TYPEMASK;
+        int end = offset + GTE_OFFLENFLD(entries[i]);
+
+        if (type == GTENTRY_IS_NUMERIC || type == GTENTRY_IS_GTYPE || type == GTENTRY_IS_CONTAINER)
+            offset = INTALIGN(offset);
+
+        gtype_collect_append(state, type, src->data.data + offset, end - offset);
+        offset = end;
+    }
+}
+
 // functions to support the aggregate function COLLECT() 
 PG_FUNCTION_INFO_V1(gtype_collect_aggtransfn);
 
 Datum gtype_collect_aggtransfn(PG_FUNCTION_ARGS)
 {
-    // verify we are in an aggregate context 
-    Assert(AggCheckCallContext(fcinfo, NULL) == AGG_CONTEXT_AGGREGATE);
-
-    /*
-     * Switch to the correct aggregate context. Otherwise, the data added to the
-     * array will be lost.
-     */
-    MemoryContext old_mcxt = MemoryContextSwitchTo(fcinfo->flinfo->fn_mcxt);
+    MemoryContext agg_context;
+    gtype_collect_state *state;
 
+    if (!AggCheckCallContext(fcinfo, &agg_context))
+        elog(ERROR, "gtype_collect_aggtransfn called in non-aggregate context");
 
     // if this is the first invocation, create the state 
-    gtype_in_state *castate;
-    if (PG_ARGISNULL(0)) {
-        castate = palloc0(sizeof(gtype_in_state));
+    if (PG_ARGISNULL(0))
+        state = gtype_collect_make_state(agg_context);
+    else
+        state = (gtype_collect_state *) PG_GETARG_POINTER(0);
 
-        castate->res = push_gtype_value(&castate->parse_state, WGT_BEGIN_ARRAY, NULL);
-    } else {
-        castate = (gtype_in_state *) PG_GETARG_POINTER(0);
-    }
+    if (!PG_ARGISNULL(1))
+        gtype_collect_append_gtype(state, AG_GET_ARG_GTYPE_P(1));
 
-    if (!PG_ARGISNULL(1)) {
-        gtype *gt = AG_GET_ARG_GTYPE_P(1);
+    PG_RETURN_POINTER(state);
+}
 
-            
-        add_gtype(gt, false, castate, GTYPEOID, false);
-    }
+PG_FUNCTION_INFO_V1(gtype_collect_aggcombinefn);
 
-    MemoryContextSwitchTo(old_mcxt);
+Datum gtype_collect_aggcombinefn(PG_FUNCTION_ARGS)
+{
+    MemoryContext agg_context;
+    gtype_collect_state *state1;
+    gtype_collect_state *state2;
+
+    if (!AggCheckCallContext(fcinfo, &agg_context))
+        elog(ERROR, "gtype_collect_aggcombinefn called in non-aggregate context");
+
+    state1 = PG_ARGISNULL(0) ? NULL : (gtype_collect_state *) PG_GETARG_POINTER(0);
+    state2 = PG_ARGISNULL(1) ? NULL : (gtype_collect_state *) PG_GETARG_POINTER(1);
 
-    PG_RETURN_POINTER(castate);
+    if (state2 == NULL)
+        AGG_RETURN_STATE(state1);
+
+    if (state1 == NULL)
+        state1 = gtype_collect_make_state(agg_context);
+
+    gtype_collect_append_state(state1, state2);
+
+    PG_RETURN_POINTER(state1);
+}
+
+// the serialized form is the element count, the gtentries and the data
+PG_FUNCTION_INFO_V1(gtype_collect_aggserialize);
+
+Datum gtype_collect_aggserialize(PG_FUNCTION_ARGS)
+{
+    gtype_collect_state *state;
+    StringInfoData buf;
+
+    if (!AggCheckCallContext(fcinfo, NULL))
+        elog(ERROR, "gtype_collect_aggserialize called in non-aggregate context");
+
+    state = (gtype_collect_state *) PG_GETARG_POINTER(0);
+
+    pq_begintypsend(&buf);
+    pq_sendint32(&buf, state->nelems);
+    pq_sendint32(&buf, state->data.len);
+    pq_sendbytes(&buf, state->entries.data, state->entries.len);
+    pq_sendbytes(&buf, state->data.data, state->data.len);
+
+    PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+PG_FUNCTION_INFO_V1(gtype_collect_aggdeserialize);
+
+Datum gtype_collect_aggdeserialize(PG_FUNCTION_ARGS)
+{
+    gtype_collect_state *state;
+    bytea *sstate;
+    StringInfoData buf;
+    int data_len;
+
+    if (!AggCheckCallContext(fcinfo, NULL))
+        elog(ERROR, "gtype_collect_aggdeserialize called in non-aggregate context");
+
+    sstate = PG_GETARG_BYTEA_PP(0);
+
+    initStringInfo(&buf);
+    appendBinaryStringInfo(&buf, VARDATA_ANY(sstate), VARSIZE_ANY_EXHDR(sstate));
+
+    state = gtype_collect_make_state(CurrentMemoryContext);
+    state->nelems = pq_getmsgint(&buf, 4);
+    data_len = pq_getmsgint(&buf, 4);
+
+    appendBinaryStringInfo(&state->entries, pq_getmsgbytes(&buf, sizeof(gtentry) * state->nelems),
+                           sizeof(gtentry) * state->nelems);
+    appendBinaryStringInfo(&state->data, pq_getmsgbytes(&buf, data_len), data_len);
+
+    pq_getmsgend(&buf);
+    pfree(buf.data);
+
+    PG_RETURN_POINTER(state);
 }
 
 PG_FUNCTION_INFO_V1(gtype_collect_aggfinalfn);
 
-Datum gtype_collect_aggfinalfn(PG_FUNCTION_ARGS) {
-    Assert(AggCheckCallContext(fcinfo, NULL) == AGG_CONTEXT_AGGREGATE);
+Datum gtype_collect_aggfinalfn(PG_FUNCTION_ARGS)
+{
+    gtype_collect_state *state;
+    gtentry *entries;
+    gtentry *children;
+    gtype *result;
+    int totallen = 0;
+    int i;
 
-    gtype_in_state *castate = (gtype_in_state *) PG_GETARG_POINTER(0);
+    state = (gtype_collect_state *) PG_GETARG_POINTER(0);
+    entries = (gtentry *)state->entries.data;
 
-    MemoryContext old_mcxt = MemoryContextSwitchTo(fcinfo->flinfo->fn_mcxt);
+    result = palloc(VARHDRSZ + sizeof(uint32) + state->entries.len + state->data.len);
+    SET_VARSIZE(result, VARHDRSZ + sizeof(uint32) + state->entries.len + state->data.len);
 
-    castate->res = push_gtype_value(&castate->parse_state, WGT_END_ARRAY, NULL);
+    result->root.header = state->nelems | GT_FARRAY;
+    children = result->root.children;
 
-    MemoryContextSwitchTo(old_mcxt);
+    // every GT_OFFSET_STRIDE'th gtentry stores an offset instead of a length
+    for (i = 0; i < state->nelems; i++)
+    {
+        totallen += GTE_OFFLENFLD(entries[i]);
+
+        if ((i % GT_OFFSET_STRIDE) == 0)
+            children[i] = (entries[i] & GTENTRY_TYPEMASK) | totallen | GTENTRY_HAS_OFF;
+        else
+            children[i] = entries[i];
+    }
+
+    memcpy(&children[state->nelems], state->data.data, state->data.len);
 
-    PG_RETURN_POINTER(gtype_value_to_gtype(castate->res));
+    AG_RETURN_GTYPE_P(result);
 }
 
 /*
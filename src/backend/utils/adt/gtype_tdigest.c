@@ -0,0 +1,374 @@
+/*
+ * Copyright (C) 2023 PostGraphDB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * percentileApprox, an approximate percentile aggregate backed by a
+ * merging t-digest (Dunning & Ertl, "Computing Extremely Accurate
+ * Quantiles Using t-Digests").
+ *
+ * Values are collected in a small buffer. When the buffer fills, it is
+ * sorted and merged with the existing centroids, with centroid sizes bounded
+ * by the arcsine scale function. That keeps the centroids small near the
+ * tails, where percentile queries need the most precision. The state has a
+ * fixed size no matter how many rows the group holds, and two digests merge
+ * by feeding one digest's centroids into the other.
+ */
+
+#include "postgres.h"
+
+#include <math.h>
+
+#include "fmgr.h"
+#include "libpq/pqformat.h"
+#include "utils/float.h"
+
+#include "utils/gtype.h"
+
+// the compression factor, the digest holds at most about this many centroids
+#define TDIGEST_COMPRESSION 100
+#define TDIGEST_MAX_CENTROIDS (TDIGEST_COMPRESSION + 2)
+#define TDIGEST_BUFFER_SIZE (TDIGEST_COMPRESSION * 2)
+
+typedef struct tdigest_centroid
+{
+    float8 mean;
+    int64 count;
+} tdigest_centroid;
+
+typedef struct tdigest_state
+{
+    // percentile value
+    float8 percentile;
+    // total weight, merged and buffered
+    int64 count;
+    float8 min;
+    float8 max;
+    int ncentroids;
+    int nbuffered;
+    // merged centroids, sorted by mean
+    tdigest_centroid centroids[TDIGEST_MAX_CENTROIDS];
+    // unmerged values and centroids
+    tdigest_centroid buffer[TDIGEST_BUFFER_SIZE];
+} tdigest_state;
+
+static int tdigest_centroid_cmp(const void *a, const void *b)
+{
+    return float8_cmp_internal(((const tdigest_centroid *)a)->mean, ((const tdigest_centroid *)b)->mean);
+}
+
+/*
+ * The largest quantile a centroid starting at q0 may reach. Under the scale
+ * function k(q) = compression / (2 * pi) * asin(2q - 1), a centroid may
+ * cover at most one unit of k.
+ */
+static float8 tdigest_q_limit(float8 q0)
+{
+    float8 k = asin(2 * q0 - 1) + 2 * M_PI / TDIGEST_COMPRESSION;
+
+    if (k >= M_PI / 2)
+        return 1;
+
+    return (sin(k) + 1) / 2;
+}
+
+// walk the centroids and the sorted buffer together, in order of mean
+static tdigest_centroid tdigest_next(tdigest_state *state, int *i, int *j)
+{
+    if (*j >= state->nbuffered ||
+        (*i < state->ncentroids && state->centroids[*i].mean <= state->buffer[*j].mean))
+        return state->centroids[(*i)++];
+
+    return state->buffer[(*j)++];
+}
+
+// merge the buffer into the centroids
+static void tdigest_compress(tdigest_state *state)
+{
+    tdigest_centroid merged[TDIGEST_MAX_CENTROIDS];
+    tdigest_centroid cur;
+    tdigest_centroid next;
+    int nmerged = 0;
+    int i = 0;
+    int j = 0;
+    int64 so_far = 0;
+    float8 total = (float8)state->count;
+    float8 q_limit = tdigest_q_limit(0);
+
+    if (state->nbuffered == 0)
+        return;
+
+    qsort(state->buffer, state->nbuffered, sizeof(tdigest_centroid), tdigest_centroid_cmp);
+
+    cur = tdigest_next(state, &i, &j);
+
+    while (i < state->ncentroids || j < state->nbuffered)
+    {
+        next = tdigest_next(state, &i, &j);
+
+        // the last slot absorbs everything, should rounding ever run the centroids out
+        if ((so_far + cur.count + next.count) / total <= q_limit || nmerged == TDIGEST_MAX_CENTROIDS - 1)
+        {
+            cur.count += next.count;
+            cur.mean += (next.mean - cur.mean) * next.count / cur.count;
+        }
+        else
+        {
+            merged[nmerged++] = cur;
+            so_far += cur.count;
+            q_limit = tdigest_q_limit(so_far / total);
+            cur = next;
+        }
+    }
+
+    merged[nmerged++] = cur;
+
+    memcpy(state->centroids, merged, sizeof(tdigest_centroid) * nmerged);
+    state->ncentroids = nmerged;
+    state->nbuffered = 0;
+}
+
+static void tdigest_add(tdigest_state *state, float8 mean, int64 count)
+{
+    if (state->nbuffered == TDIGEST_BUFFER_SIZE)
+        tdigest_compress(state);
+
+    state->buffer[state->nbuffered].mean = mean;
+    state->buffer[state->nbuffered].count = count;
+    state->nbuffered++;
+    state->count += count;
+}
+
+/*
+ * Estimate the value at the given percentile. Each centroid is treated as
+ * sitting at the middle of the ranks it covers, and the estimate is
+ * interpolated between neighbouring centroids, or between the outer
+ * centroids and the exact min and max.
+ */
+static float8 tdigest_percentile(tdigest_state *state, float8 percentile)
+{
+    tdigest_centroid *c = state->centroids;
+    float8 target;
+    float8 left = 0;
+    float8 center;
+    float8 next_center;
+    int i;
+
+    tdigest_compress(state);
+
+    if (state->ncentroids == 1)
+        return c[0].mean;
+
+    target = percentile * state->count;
+    center = c[0].count / 2.0;
+
+    if (target < center)
+        return state->min + (c[0].mean - state->min) * target / center;
+
+    for (i = 0; i < state->ncentroids - 1; i++)
+    {
+        left += c[i].count;
+        next_center = left + c[i + 1].count / 2.0;
+
+        if (target <= next_center)
+            return c[i].mean + (c[i + 1].mean - c[i].mean) * (target - center) / (next_center - center);
+
+        center = next_center;
+    }
+
+    return c[i].mean + (state->max - c[i].mean) * (target - center) / (state->count - center);
+}
+
+PG_FUNCTION_INFO_V1(gtype_percentile_approx_aggtransfn);
+
+Datum gtype_percentile_approx_aggtransfn(PG_FUNCTION_ARGS)
+{
+    tdigest_state *state;
+    MemoryContext agg_context;
+    float8 value;
+
+    if (!AggCheckCallContext(fcinfo, &agg_context))
+        elog(ERROR, "gtype_percentile_approx_aggtransfn called in non-aggregate context");
+
+    // if this is the first invocation, create the state
+    if (PG_ARGISNULL(0))
+    {
+        float8 percentile;
+
+        // validate the percentile
+        if (PG_ARGISNULL(2))
+            ereport(ERROR, (errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+                errmsg("percentile value NULL is not a valid numeric value")));
+
+        percentile = DatumGetFloat8(DirectFunctionCall1(gtype_to_float8, PG_GETARG_DATUM(2)));
+
+        if (percentile < 0 || percentile > 1 || isnan(percentile))
+            ereport(ERROR, (errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+                            errmsg("percentile value %g is not between 0 and 1", percentile)));
+
+        state = MemoryContextAllocZero(agg_context, sizeof(tdigest_state));
+        state->percentile = percentile;
+    }
+    else
+        state = (tdigest_state *) PG_GETARG_POINTER(0);
+
+    if (PG_ARGISNULL(1))
+        PG_RETURN_POINTER(state);
+
+    value = DatumGetFloat8(DirectFunctionCall1(gtype_to_float8, PG_GETARG_DATUM(1)));
+
+    if (state->count == 0 || float8_lt(value, state->min))
+        state->min = value;
+    if (state->count == 0 || float8_gt(value, state->max))
+        state->max = value;
+
+    tdigest_add(state, value, 1);
+
+    PG_RETURN_POINTER(state);
+}
+
+PG_FUNCTION_INFO_V1(gtype_percentile_approx_aggcombinefn);
+
+Datum gtype_percentile_approx_aggcombinefn(PG_FUNCTION_ARGS)
+{
+    tdigest_state *state1;
+    tdigest_state *state2;
+    MemoryContext agg_context;
+    int i;
+
+    if (!AggCheckCallContext(fcinfo, &agg_context))
+        elog(ERROR, "gtype_percentile_approx_aggcombinefn called in non-aggregate context");
+
+    state1 = PG_ARGISNULL(0) ? NULL : (tdigest_state *) PG_GETARG_POINTER(0);
+    state2 = PG_ARGISNULL(1) ? NULL : (tdigest_state *) PG_GETARG_POINTER(1);
+
+    if (state2 == NULL || state2->count == 0)
+        AGG_RETURN_STATE(state1);
+
+    if (state1 == NULL)
+    {
+        state1 = MemoryContextAlloc(agg_context, sizeof(tdigest_state));
+        memcpy(state1, state2, sizeof(tdigest_state));
+
+        PG_RETURN_POINTER(state1);
+    }
+
+    if (state1->count == 0 || float8_lt(state2->min, state1->min))
+        state1->min = state2->min;
+    if (state1->count == 0 || float8_gt(state2->max, state1->max))
+        state1->max = state2->max;
+
+    for (i = 0; i < state2->ncentroids; i++)
+        tdigest_add(state1, state2->centroids[i].mean, state2->centroids[i].count);
+    for (i = 0; i < state2->nbuffered; i++)
+        tdigest_add(state1, state2->buffer[i].mean, state2->buffer[i].count);
+
+    PG_RETURN_POINTER(state1);
+}
+
+PG_FUNCTION_INFO_V1(gtype_percentile_approx_aggserialize);
+
+Datum gtype_percentile_approx_aggserialize(PG_FUNCTION_ARGS)
+{
+    tdigest_state *state;
+    StringInfoData buf;
+    int i;
+
+    if (!AggCheckCallContext(fcinfo, NULL))
+        elog(ERROR, "gtype_percentile_approx_aggserialize called in non-aggregate context");
+
+    state = (tdigest_state *) PG_GETARG_POINTER(0);
+
+    tdigest_compress(state);
+
+    pq_begintypsend(&buf);
+    pq_sendfloat8(&buf, state->percentile);
+    pq_sendint64(&buf, state->count);
+    pq_sendfloat8(&buf, state->min);
+    pq_sendfloat8(&buf, state->max);
+    pq_sendint32(&buf, state->ncentroids);
+
+    for (i = 0; i < state->ncentroids; i++)
+    {
+        pq_sendfloat8(&buf, state->centroids[i].mean);
+        pq_sendint64(&buf, state->centroids[i].count);
+    }
+
+    PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+PG_FUNCTION_INFO_V1(gtype_percentile_approx_aggdeserialize);
+
+Datum gtype_percentile_approx_aggdeserialize(PG_FUNCTION_ARGS)
+{
+    tdigest_state *state;
+    bytea *sstate;
+    StringInfoData buf;
+    int i;
+
+    if (!AggCheckCallContext(fcinfo, NULL))
+        elog(ERROR, "gtype_percentile_approx_aggdeserialize called in non-aggregate context");
+
+    sstate = PG_GETARG_BYTEA_PP(0);
+
+    initStringInfo(&buf);
+    appendBinaryStringInfo(&buf, VARDATA_ANY(sstate), VARSIZE_ANY_EXHDR(sstate));
+
+    state = palloc0(sizeof(tdigest_state));
+    state->percentile = pq_getmsgfloat8(&buf);
+    state->count = pq_getmsgint64(&buf);
+    state->min = pq_getmsgfloat8(&buf);
+    state->max = pq_getmsgfloat8(&buf);
+    state->ncentroids = pq_getmsgint(&buf, 4);
+
+    if (state->ncentroids < 0 || state->ncentroids > TDIGEST_MAX_CENTROIDS)
+        elog(ERROR, "invalid number of t-digest centroids: %d", state->ncentroids);
+
+    for (i = 0; i < state->ncentroids; i++)
+    {
+        state->centroids[i].mean = pq_getmsgfloat8(&buf);
+        state->centroids[i].count = pq_getmsgint64(&buf);
+    }
+
+    pq_getmsgend(&buf);
+    pfree(buf.data);
+
+    PG_RETURN_POINTER(state);
+}
+
+PG_FUNCTION_INFO_V1(gtype_percentile_approx_aggfinalfn);
+
+Datum gtype_percentile_approx_aggfinalfn(PG_FUNCTION_ARGS)
+{
+    tdigest_state *state;
+    gtype_value agtv_float;
+
+    // If there were no regular rows, the result is NULL
+    if (PG_ARGISNULL(0))
+        PG_RETURN_NULL();
+
+    state = (tdigest_state *) PG_GETARG_POINTER(0);
+
+    // count could be zero if we only saw NULL input values
+    if (state->count == 0)
+        PG_RETURN_NULL();
+
+    agtv_float.type = AGTV_FLOAT;
+    agtv_float.val.float_value = tdigest_percentile(state, state->percentile);
+
+    PG_RETURN_POINTER(gtype_value_to_gtype(&agtv_float));
+}
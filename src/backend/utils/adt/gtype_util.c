@@ -59,7 +59,6 @@
 static void fill_gtype_value(gtype_container *container, int index,
                               char *base_addr, uint32 offset,
                               gtype_value *result);
-static bool equals_gtype_scalar_value(const gtype_value *a, const gtype_value *b);
 static gtype *convert_to_gtype(gtype_value *val);
 static void convert_gtype_value(StringInfo buffer, gtentry *header, gtype_value *val, int level);
 static void convert_gtype_array(StringInfo buffer, gtentry *pheader, gtype_value *val, int level);
@@ -515,6 +514,94 @@ gtype_value *find_gtype_value_from_container(gtype_container *container,
     return NULL;
 }
 
+/*
+ * Allocation free variant of find_gtype_value_from_container for object
+ * keys. Binary searches the object's keys in place and, if the key is
+ * found, sets *entry to the value's gtentry and *data and *len to its
+ * variable-length data, still inside the container. Alignment padding in
+ * front of numerics, extended types and containers is skipped, so *data
+ * can be copied to any int aligned position as is.
+ */
+bool find_gtype_slice_from_object(gtype_container *container, const char *key, int key_len,
+                                  gtentry *entry, char **data, uint32 *len)
+{
+    gtentry *children = container->children;
+    int count = GTYPE_CONTAINER_SIZE(container);
+    char *base_addr = (char *)(children + count * 2);
+    const gtype_value key_value = { .type = AGTV_STRING, .val.string = { key_len, (char *)key } };
+    uint32 stop_low = 0;
+    uint32 stop_high = count;
+
+    if (!GTYPE_CONTAINER_IS_OBJECT(container))
+        return false;
+
+    // Binary search on object/pair keys *only* 
+    while (stop_low < stop_high)
+    {
+        uint32 stop_middle = stop_low + (stop_high - stop_low) / 2;
+        gtype_value candidate;
+        int difference;
+
+        candidate.type = AGTV_STRING;
+        candidate.val.string.val = base_addr + get_gtype_offset(container, stop_middle);
+        candidate.val.string.len = get_gtype_length(container, stop_middle);
+
+        difference = length_compare_gtype_string_value(&candidate, &key_value);
+
+        if (difference == 0)
+        {
+            int index = stop_middle + count;
+            uint32 offset = get_gtype_offset(container, index);
+            uint32 end = offset + get_gtype_length(container, index);
+
+            *entry = children[index];
+
+            if (GTE_IS_NUMERIC(*entry) || GTE_IS_GTYPE(*entry) || GTE_IS_CONTAINER(*entry))
+                offset = INTALIGN(offset);
+
+            *data = base_addr + offset;
+            *len = end - offset;
+
+            return true;
+        }
+        else if (difference < 0)
+            stop_low = stop_middle + 1;
+        else
+            stop_high = stop_middle;
+    }
+
+    return false;
+}
+
+/*
+ * Build a gtype from a value found by find_gtype_slice_from_object with a
+ * single palloc and memcpy. Containers become the root of the new gtype;
+ * scalars are wrapped in the usual one element raw scalar array.
+ */
+gtype *gtype_slice_to_gtype(gtentry entry, char *data, uint32 len)
+{
+    gtype *out;
+
+    if (GTE_IS_CONTAINER(entry))
+    {
+        out = palloc(VARHDRSZ + len);
+        SET_VARSIZE(out, VARHDRSZ + len);
+        memcpy(VARDATA(out), data, len);
+
+        return out;
+    }
+
+    out = palloc(VARHDRSZ + sizeof(uint32) + sizeof(gtentry) + len);
+    SET_VARSIZE(out, VARHDRSZ + sizeof(uint32) + sizeof(gtentry) + len);
+
+    out->root.header = 1 | GT_FARRAY | GT_FSCALAR;
+    // the first gtentry of a container always stores an offset
+    out->root.children[0] = (entry & GTENTRY_TYPEMASK) | GTENTRY_HAS_OFF | len;
+    memcpy(&out->root.children[1], data, len);
+
+    return out;
+}
+
 /*
  * Get i-th value of an gtype array.
  *
@@ -1575,7 +1662,7 @@ static int compare_two_floats_orderability(float8 lhs, float8 rhs)
 /*
  * Are two scalar gtype_values of the same type a and b equal?
  */
-static bool equals_gtype_scalar_value(const gtype_value *a, const gtype_value *b)
+bool equals_gtype_scalar_value(const gtype_value *a, const gtype_value *b)
 {
     // if the values are of the same type 
     if (a->type == b->type)
@@ -100,7 +100,7 @@ build_traversal(PG_FUNCTION_ARGS) {
                 append_to_buffer(&buffer, DATUM_GET_EDGE(args[i]), VARSIZE_ANY(args[i]));
 	        cnt++;
 	    } else {
-		VariableEdge *v = DATUM_GET_VARIABLE_EDGE(args[i]);
+		VariableEdge *v = materialize_variable_edge(DATUM_GET_VARIABLE_EDGE(args[i]));
                 char *ptr = &v->children[1];
                 for (int i = 0; i < v->children[0]; i++, ptr = ptr + VARSIZE(ptr)) {
                      append_to_buffer(&buffer, DATUM_GET_EDGE(ptr), VARSIZE_ANY(ptr));
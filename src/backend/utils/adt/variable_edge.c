@@ -21,11 +21,15 @@
 #include "utils/varlena.h"
 
 #include "utils/edge.h"
+#include "utils/global_graph.h"
 #include "utils/variable_edge.h"
 #include "utils/vertex.h"
 
 static void append_to_buffer(StringInfo buffer, const char *data, int len);
 static int variable_edge_btree_fast_cmp(Datum x, Datum y, SortSupport ssup);
+static Datum materialize_vertex(graph_context *ggctx, Oid graph_oid, graphid id);
+static Datum materialize_edge(graph_context *ggctx, Oid graph_oid, graphid id);
+static void get_variable_edge_endpoints(VariableEdge *ve, int index, graphid *start_id, graphid *end_id);
 
 /*
  * I/O routines for vertex type
@@ -39,7 +43,7 @@ Datum variable_edge_in(PG_FUNCTION_ARGS) {
 
 PG_FUNCTION_INFO_V1(variable_edge_out);
 Datum variable_edge_out(PG_FUNCTION_ARGS) {
-    VariableEdge *v = AG_GET_ARG_VARIABLE_EDGE(0);
+    VariableEdge *v = materialize_variable_edge(AG_GET_ARG_VARIABLE_EDGE(0));
     StringInfo str = makeStringInfo();
 
     appendStringInfoString(str, "[");
@@ -104,40 +108,163 @@ build_variable_edge(PG_FUNCTION_ARGS) {
 }
 
 /*
- * Comparison Operators
+ * Compact variable_edges
  */
-static int32 compare_variable_edge_orderability(VariableEdge *lhs, VariableEdge *rhs) {
+VariableEdge *create_compact_variable_edge(Oid graph_oid, graphid *graphid_array, int graphid_array_size) {
+    int size = offsetof(VariableEdge, children) + (sizeof(prentry) * 2) + (sizeof(graphid) * graphid_array_size);
+    VariableEdge *ve;
 
-    char *lhs_ptr = &lhs->children[1];
-    char *rhs_ptr = &rhs->children[1];
+    // at least a start vertex, an edge and an end vertex
+    Assert(graphid_array_size >= 3);
 
-    for (int i = 0; i < lhs->children[0] && i < rhs->children[0]; i++) {
+    ve = palloc(size);
+    SET_VARSIZE(ve, size);
 
-        if (i % 2 == 0) {
-            graphid left_id = EXTRACT_EDGE_ID(lhs_ptr);
-            graphid right_id = EXTRACT_EDGE_ID(rhs_ptr);
+    // the start and end vertices are not part of the variable_edge
+    ve->children[0] = (graphid_array_size - 2) | VARIABLE_EDGE_COMPACT;
+    ve->children[1] = graph_oid;
+    memcpy(EXTRACT_COMPACT_VARIABLE_EDGE_PATH(ve), graphid_array, sizeof(graphid) * graphid_array_size);
 
-            if (left_id > right_id)
-                return 1;
-             else if (left_id < right_id)
-                return -1;
-        } else {
-            graphid left_id = EXTRACT_VERTEX_ID(lhs_ptr);
-            graphid right_id = EXTRACT_VERTEX_ID(rhs_ptr);
+    return ve;
+}
+
+/*
+ * Build the edges and vertices of a compact variable_edge. They come from the
+ * graph's cached image when it is loaded and up to date, or from the label
+ * tables otherwise. A variable_edge that isn't compact is returned as is.
+ */
+VariableEdge *materialize_variable_edge(VariableEdge *ve) {
+    StringInfoData buffer;
+    graph_context *ggctx;
+    graphid *ids;
+    prentry size;
+    Oid graph_oid;
+
+    if (!IS_COMPACT_VARIABLE_EDGE(ve))
+        return ve;
+
+    graph_oid = EXTRACT_COMPACT_VARIABLE_EDGE_GRAPH_OID(ve);
+    ggctx = find_current_graph_context(graph_oid);
+    ids = extract_variable_edge_ids(ve);
+    size = VARIABLE_EDGE_SIZE(ve);
+
+    initStringInfo(&buffer);
+    reserve_from_buffer(&buffer, VARHDRSZ);
+    append_to_buffer(&buffer, (char *)&size, sizeof(prentry));
+
+    for (int i = 0; i < size; i++) {
+        Datum d;
+
+        if (i % 2 == 1)
+            d = materialize_vertex(ggctx, graph_oid, ids[i]);
+        else
+            d = materialize_edge(ggctx, graph_oid, ids[i]);
+
+        append_to_buffer(&buffer, DatumGetPointer(d), VARSIZE(d));
+    }
+
+    VariableEdge *p = (VariableEdge *)buffer.data;
+
+    SET_VARSIZE(p, buffer.len);
+
+    return p;
+}
+
+static Datum materialize_vertex(graph_context *ggctx, Oid graph_oid, graphid id) {
+    int64 vertex_index = (ggctx != NULL) ? get_vertex_index(ggctx, id) : -1;
+
+    if (vertex_index < 0)
+        return get_vertex(graph_oid, id);
+
+    return VERTEX_GET_DATUM(create_vertex(id, graph_oid, DATUM_GET_GTYPE_P(get_vertex_properties(ggctx, vertex_index))));
+}
+
+static Datum materialize_edge(graph_context *ggctx, Oid graph_oid, graphid id) {
+    int64 edge_index = (ggctx != NULL) ? get_edge_index(ggctx, id) : -1;
+
+    if (edge_index < 0)
+        return get_edge(graph_oid, id);
 
-            if (left_id > right_id)
-                return 1;
-             else if (left_id < right_id)
-                return -1;
+    return EDGE_GET_DATUM(create_edge(id, get_start_id(ggctx, edge_index), get_end_id(ggctx, edge_index), graph_oid,
+                                      DATUM_GET_GTYPE_P(get_edge_properties(ggctx, edge_index))));
+}
+
+/*
+ * Get the graphids of the edges and vertices of the variable_edge, in path
+ * order. A compact variable_edge's are read in place.
+ */
+graphid *extract_variable_edge_ids(VariableEdge *ve) {
+    graphid *ids;
+    char *ptr;
+
+    if (IS_COMPACT_VARIABLE_EDGE(ve))
+        return EXTRACT_COMPACT_VARIABLE_EDGE_PATH(ve) + 1;
+
+    ids = palloc(sizeof(graphid) * Max(ve->children[0], 1));
+
+    ptr = (char *)&ve->children[1];
+    for (int i = 0; i < ve->children[0]; i++, ptr = ptr + VARSIZE(ptr)) {
+        if (i % 2 == 1)
+            ids[i] = EXTRACT_VERTEX_ID(ptr);
+        else
+            ids[i] = EXTRACT_EDGE_ID(ptr);
+    }
+
+    return ids;
+}
+
+/*
+ * Get the start and end ids of the edge at the index. A compact variable_edge
+ * doesn't hold them, they are looked up in the graph's cached image, and only
+ * read from the label table when the graph isn't loaded.
+ */
+static void get_variable_edge_endpoints(VariableEdge *ve, int index, graphid *start_id, graphid *end_id) {
+    edge *e;
+
+    if (IS_COMPACT_VARIABLE_EDGE(ve)) {
+        Oid graph_oid = EXTRACT_COMPACT_VARIABLE_EDGE_GRAPH_OID(ve);
+        graph_context *ggctx = find_current_graph_context(graph_oid);
+        graphid id = extract_variable_edge_ids(ve)[index];
+        int64 edge_index = (ggctx != NULL) ? get_edge_index(ggctx, id) : -1;
+
+        if (edge_index >= 0) {
+            *start_id = get_start_id(ggctx, edge_index);
+            *end_id = get_end_id(ggctx, edge_index);
+            return;
         }
 
-        lhs_ptr = lhs_ptr + VARSIZE(lhs_ptr);
-        rhs_ptr = rhs_ptr + VARSIZE(rhs_ptr);
+        e = DATUM_GET_EDGE(get_edge(graph_oid, id));
+    } else {
+        char *ptr = (char *)&ve->children[1];
+
+        for (int i = 0; i < index; i++, ptr = ptr + VARSIZE(ptr));
+
+        e = (edge *)ptr;
     }
 
-    if (lhs->children[0] > rhs->children[0])
+    *start_id = EXTRACT_EDGE_STARTID(e);
+    *end_id = EXTRACT_EDGE_ENDID(e);
+}
+
+/*
+ * Comparison Operators
+ */
+static int32 compare_variable_edge_orderability(VariableEdge *lhs, VariableEdge *rhs) {
+    graphid *lhs_ids = extract_variable_edge_ids(lhs);
+    graphid *rhs_ids = extract_variable_edge_ids(rhs);
+    prentry lhs_size = VARIABLE_EDGE_SIZE(lhs);
+    prentry rhs_size = VARIABLE_EDGE_SIZE(rhs);
+
+    for (int i = 0; i < lhs_size && i < rhs_size; i++) {
+        if (lhs_ids[i] > rhs_ids[i])
+            return 1;
+        else if (lhs_ids[i] < rhs_ids[i])
+            return -1;
+    }
+
+    if (lhs_size > rhs_size)
         return 1;
-    else if (lhs->children[0] == rhs->children[0])
+    else if (lhs_size == rhs_size)
         return 0;
     return -1;
 }
@@ -149,7 +276,7 @@ Datum variable_edge_eq(PG_FUNCTION_ARGS) {
     VariableEdge *lhs = AG_GET_ARG_VARIABLE_EDGE(0);
     VariableEdge *rhs = AG_GET_ARG_VARIABLE_EDGE(1);
 
-    if (rhs->children[0] != lhs->children[0])
+    if (VARIABLE_EDGE_SIZE(rhs) != VARIABLE_EDGE_SIZE(lhs))
          PG_RETURN_BOOL(false);
 
     PG_RETURN_BOOL(compare_variable_edge_orderability(lhs, rhs) == 0);
@@ -160,7 +287,7 @@ Datum variable_edge_ne(PG_FUNCTION_ARGS) {
     VariableEdge *lhs = AG_GET_ARG_VARIABLE_EDGE(0);
     VariableEdge *rhs = AG_GET_ARG_VARIABLE_EDGE(1);
 
-    if (rhs->children[0] != lhs->children[0])
+    if (VARIABLE_EDGE_SIZE(rhs) != VARIABLE_EDGE_SIZE(lhs))
          PG_RETURN_BOOL(true);
 
     PG_RETURN_BOOL(compare_variable_edge_orderability(lhs, rhs) != 0);
@@ -231,14 +358,10 @@ Datum edge_contained_in_variable_edge(PG_FUNCTION_ARGS) {
 
     graphid left_id = EXTRACT_EDGE_ID(e);
 
-    char *ptr = &variable_edge->children[1];
-    for (int i = 0; i < variable_edge->children[0] - 1; i++, ptr = ptr + VARSIZE(ptr)) {
-	 if (i % 2 == 0) {
-             edge *right_edge = (edge *)ptr;
-	     graphid right_id = EXTRACT_EDGE_ID(right_edge);
-	     if (left_id == right_id)
-                 PG_RETURN_BOOL(true);
-	 }
+    graphid *ids = extract_variable_edge_ids(variable_edge);
+    for (int i = 0; i < (int)VARIABLE_EDGE_SIZE(variable_edge) - 1; i += 2) {
+        if (left_id == ids[i])
+            PG_RETURN_BOOL(true);
     }
 
     PG_RETURN_BOOL(false);
@@ -251,14 +374,10 @@ Datum variable_edge_contains_edge(PG_FUNCTION_ARGS) {
 
     graphid left_id = EXTRACT_EDGE_ID(e);
 
-    char *ptr = &variable_edge->children[1];
-    for (int i = 0; i < variable_edge->children[0] - 1; i++, ptr = ptr + VARSIZE(ptr)) {
-         if (i % 2 == 0) {
-             edge *right_edge = (edge *)ptr;
-             graphid right_id = EXTRACT_EDGE_ID(right_edge);
-             if (left_id == right_id)
-                 PG_RETURN_BOOL(true);
-         }
+    graphid *ids = extract_variable_edge_ids(variable_edge);
+    for (int i = 0; i < (int)VARIABLE_EDGE_SIZE(variable_edge) - 1; i += 2) {
+        if (left_id == ids[i])
+            PG_RETURN_BOOL(true);
     }
 
     PG_RETURN_BOOL(false);
@@ -271,17 +390,11 @@ Datum match_vles(PG_FUNCTION_ARGS) {
     VariableEdge *lhs = AG_GET_ARG_VARIABLE_EDGE(0);
     VariableEdge *rhs = AG_GET_ARG_VARIABLE_EDGE(1);
 
-    edge *left_edge = (edge *)&lhs->children[1];
+    graphid left_start, left_end, right_start, right_end;
 
-    char *ptr = &rhs->children[1];
-    for (int i = 0; i < rhs->children[0] - 1; i++, ptr = ptr + VARSIZE(ptr));
-    edge *right_edge = (edge *)ptr;
-
-    graphid left_start =  *((int64 *)(&left_edge->children[2]));
-    graphid left_end =  *((int64 *)(&left_edge->children[4]));
-
-    graphid right_start =  *((int64 *)(&right_edge->children[2]));
-    graphid right_end =  *((int64 *)(&right_edge->children[4]));
+    // the first edge of the left and the last edge of the right
+    get_variable_edge_endpoints(lhs, 0, &left_start, &left_end);
+    get_variable_edge_endpoints(rhs, VARIABLE_EDGE_SIZE(rhs) - 1, &right_start, &right_end);
 
 PG_RETURN_BOOL(left_start == right_start || left_end == right_start ||
 		left_start == right_end || left_end == right_end);
@@ -292,19 +405,14 @@ Datum variable_edge_edges_overlap(PG_FUNCTION_ARGS) {
     VariableEdge *lhs = AG_GET_ARG_VARIABLE_EDGE(0);
     VariableEdge *rhs = AG_GET_ARG_VARIABLE_EDGE(1);
 
-    char *rhs_ptr = &rhs->children[1];
-    for (int i = 0; i < rhs->children[0] - 1; i++, rhs_ptr = rhs_ptr + VARSIZE(rhs_ptr)) {
-        if (i % 2 == 0) {
-	    char *lhs_ptr = &lhs->children[1];
-	    edge *right_edge = (edge *)rhs_ptr;
-            for (int j = 0; j < lhs->children[0]; j++, lhs_ptr = lhs_ptr + VARSIZE(lhs_ptr)) {
-                  if (j % 2 == 0) {
-                      edge *left_edge = (edge *)lhs_ptr;
-		      if (EXTRACT_EDGE_ID(left_edge) == EXTRACT_EDGE_ID(right_edge))
-                           PG_RETURN_BOOL(true);
-		  }
-	    }
-	}
+    graphid *lhs_ids = extract_variable_edge_ids(lhs);
+    graphid *rhs_ids = extract_variable_edge_ids(rhs);
+
+    for (int i = 0; i < (int)VARIABLE_EDGE_SIZE(rhs) - 1; i += 2) {
+        for (int j = 0; j < (int)VARIABLE_EDGE_SIZE(lhs); j += 2) {
+            if (lhs_ids[j] == rhs_ids[i])
+                PG_RETURN_BOOL(true);
+        }
     }
 
     PG_RETURN_BOOL(false);
@@ -315,7 +423,7 @@ Datum variable_edge_edges_overlap(PG_FUNCTION_ARGS) {
  */
 PG_FUNCTION_INFO_V1(variable_edge_edges);
 Datum variable_edge_edges(PG_FUNCTION_ARGS) {
-    VariableEdge *v = AG_GET_ARG_VARIABLE_EDGE(0);
+    VariableEdge *v = materialize_variable_edge(AG_GET_ARG_VARIABLE_EDGE(0));
 
     int size = (v->children[0] + 1) / 2;
     Datum *array_value = (Datum *) palloc(sizeof(Datum) * size);
@@ -335,7 +443,7 @@ Datum variable_edge_edges(PG_FUNCTION_ARGS) {
 
 PG_FUNCTION_INFO_V1(variable_edge_nodes);
 Datum variable_edge_nodes(PG_FUNCTION_ARGS) {
-    VariableEdge *v = AG_GET_ARG_VARIABLE_EDGE(0);
+    VariableEdge *v = materialize_variable_edge(AG_GET_ARG_VARIABLE_EDGE(0));
 
     int size = (v->children[0] - 1) / 2;
     Datum *array_value = (Datum *) palloc(sizeof(Datum) * size);
@@ -356,7 +464,7 @@ PG_FUNCTION_INFO_V1(variable_edge_length);
 Datum variable_edge_length(PG_FUNCTION_ARGS) {
     VariableEdge *v = AG_GET_ARG_VARIABLE_EDGE(0);
 
-    gtype_value gtv = { .type = AGTV_INTEGER, .val = { .int_value = (v->children[0] + 1) / 2 } };
+    gtype_value gtv = { .type = AGTV_INTEGER, .val = { .int_value = (VARIABLE_EDGE_SIZE(v) + 1) / 2 } };
 
     AG_RETURN_GTYPE_P(gtype_value_to_gtype(&gtv));
 }
@@ -24,6 +24,7 @@
 
 #include "miscadmin.h"
 #include "funcapi.h"
+#include "libpq/pqformat.h"
 #include "nodes/execnodes.h"
 #include "utils/array.h"
 #include "utils/fmgrprotos.h"
@@ -230,22 +231,8 @@ PG_FUNCTION_INFO_V1(vertex_property_access_gtype);
 Datum
 vertex_property_access_gtype(PG_FUNCTION_ARGS) {
     vertex *v = AG_GET_ARG_VERTEX(0);
-    gtype *agt = extract_vertex_properties(v);
-    gtype *key = AG_GET_ARG_GTYPE_P(1);
-    gtype_value *key_value;
 
-    if (!AGT_ROOT_IS_SCALAR(key))
-        PG_RETURN_NULL();
-    
-    key_value = get_ith_gtype_value_from_container(&key->root, 0);
-    
-    if (key_value->type == AGTV_INTEGER)
-        AG_RETURN_GTYPE_P(gtype_array_element_impl(fcinfo, agt, key_value->val.int_value, false));
-    else if (key_value->type == AGTV_STRING)
-        AG_RETURN_GTYPE_P(gtype_object_field_impl(fcinfo, agt, key_value->val.string.val, 
-                                                    key_value->val.string.len, false));
-
-    PG_RETURN_NULL();
+    return gtype_field_access_impl(fcinfo, extract_vertex_properties(v), AG_GET_ARG_GTYPE_P(1));
 }
 
 
@@ -629,6 +616,121 @@ vertex_collect_finalfn(PG_FUNCTION_ARGS)
         PG_RETURN_DATUM(result);
 }
 
+/*
+ * Combine, serialize and deserialize functions shared by collect(vertex)
+ * and collect(edge). The serialized form records the element type, so the
+ * same functions rebuild either kind of ArrayBuildState.
+ */
+PG_FUNCTION_INFO_V1(entity_collect_combinefn);
+Datum
+entity_collect_combinefn(PG_FUNCTION_ARGS)
+{
+    MemoryContext aggcontext;
+    ArrayBuildState *state1;
+    ArrayBuildState *state2;
+    int i;
+
+    if (!AggCheckCallContext(fcinfo, &aggcontext))
+        elog(ERROR, "entity_collect_combinefn called in non-aggregate context");
+
+    state1 = PG_ARGISNULL(0) ? NULL : (ArrayBuildState *) PG_GETARG_POINTER(0);
+    state2 = PG_ARGISNULL(1) ? NULL : (ArrayBuildState *) PG_GETARG_POINTER(1);
+
+    if (state2 == NULL)
+        AGG_RETURN_STATE(state1);
+
+    if (state1 == NULL)
+        state1 = initArrayResult(state2->element_type, aggcontext, false);
+
+    for (i = 0; i < state2->nelems; i++)
+        state1 = accumArrayResult(state1, state2->dvalues[i], state2->dnulls[i], state2->element_type, aggcontext);
+
+    PG_RETURN_POINTER(state1);
+}
+
+PG_FUNCTION_INFO_V1(entity_collect_serialize);
+Datum
+entity_collect_serialize(PG_FUNCTION_ARGS)
+{
+    ArrayBuildState *state;
+    StringInfoData buf;
+    int i;
+
+    if (!AggCheckCallContext(fcinfo, NULL))
+        elog(ERROR, "entity_collect_serialize called in non-aggregate context");
+
+    state = (ArrayBuildState *) PG_GETARG_POINTER(0);
+
+    pq_begintypsend(&buf);
+    pq_sendint32(&buf, state->element_type);
+    pq_sendint32(&buf, state->nelems);
+
+    for (i = 0; i < state->nelems; i++)
+    {
+        struct varlena *elem;
+
+        pq_sendbyte(&buf, state->dnulls[i]);
+        if (state->dnulls[i])
+            continue;
+
+        elem = PG_DETOAST_DATUM(state->dvalues[i]);
+        pq_sendint32(&buf, VARSIZE(elem));
+        pq_sendbytes(&buf, (char *) elem, VARSIZE(elem));
+    }
+
+    PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+PG_FUNCTION_INFO_V1(entity_collect_deserialize);
+Datum
+entity_collect_deserialize(PG_FUNCTION_ARGS)
+{
+    ArrayBuildState *state;
+    bytea *sstate;
+    StringInfoData buf;
+    Oid element_type;
+    int nelems;
+    int i;
+
+    if (!AggCheckCallContext(fcinfo, NULL))
+        elog(ERROR, "entity_collect_deserialize called in non-aggregate context");
+
+    sstate = PG_GETARG_BYTEA_PP(0);
+
+    initStringInfo(&buf);
+    appendBinaryStringInfo(&buf, VARDATA_ANY(sstate), VARSIZE_ANY_EXHDR(sstate));
+
+    element_type = pq_getmsgint(&buf, 4);
+    nelems = pq_getmsgint(&buf, 4);
+
+    state = initArrayResult(element_type, CurrentMemoryContext, false);
+
+    for (i = 0; i < nelems; i++)
+    {
+        struct varlena *elem;
+        int len;
+
+        if (pq_getmsgbyte(&buf))
+        {
+            state = accumArrayResult(state, (Datum) 0, true, element_type, CurrentMemoryContext);
+            continue;
+        }
+
+        // copy out of the message so the varlena header is aligned
+        len = pq_getmsgint(&buf, 4);
+        elem = palloc(len);
+        pq_copymsgbytes(&buf, (char *) elem, len);
+
+        state = accumArrayResult(state, PointerGetDatum(elem), false, element_type, CurrentMemoryContext);
+        pfree(elem);
+    }
+
+    pq_getmsgend(&buf);
+    pfree(buf.data);
+
+    PG_RETURN_POINTER(state);
+}
+
 
 static void
 append_to_buffer(StringInfo buffer, const char *data, int len) {
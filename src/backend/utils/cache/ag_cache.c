@@ -459,9 +459,13 @@ static void fill_graph_cache_data(graph_cache_data *cache_data,
     Assert(!is_null);
     cache_data->namespace = DatumGetObjectId(value);
     // ag_graph.directed
-    value = heap_getattr(tuple, 3, tuple_desc, &is_null);
+    value = heap_getattr(tuple, Anum_ag_graph_directed, tuple_desc, &is_null);
     Assert(!is_null);
     cache_data->directed = DatumGetBool(value);
+    // ag_graph.edge_endpoint_indexes
+    value = heap_getattr(tuple, Anum_ag_graph_edge_endpoint_indexes, tuple_desc, &is_null);
+    Assert(!is_null);
+    cache_data->edge_endpoint_indexes = DatumGetBool(value);
 
 }
 
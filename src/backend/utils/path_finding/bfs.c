@@ -0,0 +1,609 @@
+/*
+ * Copyright (C) 2023 PostGraphDB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "postgres.h"
+
+#include "funcapi.h"
+#include "utils/memutils.h"
+
+#include "catalog/ag_graph.h"
+#include "nodes/cypher_nodes.h"
+#include "utils/graphid.h"
+#include "utils/path_finding.h"
+#include "utils/queue.h"
+#include "utils/vertex.h"
+
+// defines
+#define BFS_INITIAL_POOL_SIZE 1024
+#define MAXIMUM_NUMBER_OF_FREE_VERTEX_MARKS 4
+
+/*
+ * The vertices one side of a search reached, as one mark per vertex index. A
+ * vertex is reached when its mark equals the generation, its depth and parent
+ * are only set then. Moving to the next generation unmarks every vertex in
+ * O(1), so the arrays are kept for the next searches, as the VLE does with its
+ * edge visit marks.
+ */
+typedef struct bfs_vertex_marks
+{
+    uint32 *marks;                 // per vertex index
+    int32 *depths;                 // per vertex index, valid when marked
+    int64 *parents;                // per vertex index, first pool entry or -1
+    int64 capacity;                // number of marks allocated
+    uint32 generation;             // mark of the vertices reached
+    struct bfs_vertex_marks *next; // next unused marks
+} bfs_vertex_marks;
+
+// vertex marks not used by any search
+static bfs_vertex_marks *free_vertex_marks = NULL;
+static int free_vertex_marks_cnt = 0;
+
+/*
+ * One side of a bidirectional breadth first search. Every vertex reached gets
+ * its depth and the list of adjacency entries it was reached through, as
+ * entries of the parent pool chained together by next.
+ */
+typedef struct bfs_side
+{
+    bfs_vertex_marks *reached;     // vertices reached, with depth and parents
+    graphid_stack *frontier;       // vertices reached at the current depth
+    graphid_stack *next;           // vertices reached at the next depth
+    int32 depth;                   // depth of the frontier
+    bool forward;                  // follows the edges from the start vertex
+} bfs_side;
+
+/*
+ * A path from a meeting vertex back to where one side started. The vertex at
+ * position len is the meeting vertex and the one at position 0 is the start
+ * or end vertex. edges[k] joins vertices[k - 1] and vertices[k].
+ */
+typedef struct bfs_chain
+{
+    int32 len;
+    int64 *vertices;
+    int64 *edges;
+    int64 *cursors;                // parent pool entry chosen at each position
+} bfs_chain;
+
+typedef struct shortest_path_context
+{
+    graph_context *ggctx;          // global graph context
+    Oid graph_oid;                 // graph oid for building the paths
+    int64 vsidx;                   // starting vertex index
+    int64 veidx;                   // ending vertex index
+    int64 uidx;                    // upper bound of the path length
+    bool uidx_infinite;            // flag if the upper bound is omitted
+    cypher_rel_dir edge_direction; // the direction of the edges
+    label_filter edge_labels;      // edge label tables for match
+    property_filter properties;    // edge property constraint, compiled
+    bool all_paths;                // return all shortest paths, or only one
+    bfs_side sides[2];             // forward and backward searches
+    // parent pool, shared by both sides
+    int64 *pool_edges;
+    int64 *pool_vertices;
+    int64 *pool_next;
+    int64 pool_cnt;
+    int64 pool_cap;
+    // meeting vertices of the shortest paths
+    int64 *meets;
+    int64 meet_cnt;
+    // the path being returned
+    int64 meet;                    // meeting vertex of the current path
+    bfs_chain chains[2];
+    bool done;
+} shortest_path_context;
+
+static shortest_path_context *build_shortest_path_context(FunctionCallInfo fcinfo, FuncCallContext *funcctx, bool all_paths);
+static bfs_vertex_marks *acquire_vertex_marks(MemoryContext mcxt, int64 vertex_count);
+static void release_vertex_marks(void *arg);
+static void free_vertex_marks_entry(bfs_vertex_marks *marks);
+static void init_bfs_side(MemoryContext mcxt, bfs_side *side, int64 vertex_count, int64 vertex_index, bool forward);
+static void add_parent(shortest_path_context *sp_ctx, bfs_side *side, int64 vertex_index, int64 edge_index, int64 parent_index);
+static bool expand_bfs_side(shortest_path_context *sp_ctx, bfs_side *side, bfs_side *other);
+static void find_shortest_paths(shortest_path_context *sp_ctx);
+static void first_chain(shortest_path_context *sp_ctx, bfs_chain *chain, bfs_side *side, int64 vertex_index, int32 from);
+static bool next_chain(shortest_path_context *sp_ctx, bfs_chain *chain, bfs_side *side);
+static bool next_shortest_path(shortest_path_context *sp_ctx);
+static VariableEdge *build_shortest_path(shortest_path_context *sp_ctx);
+static Datum shortest_path_srf(FunctionCallInfo fcinfo, bool all_paths);
+
+/*
+ * Build the shortest path context. The arguments are the ones of the vle
+ * function, so that the MATCH transform can build both the same way.
+ */
+static shortest_path_context *build_shortest_path_context(FunctionCallInfo fcinfo, FuncCallContext *funcctx, bool all_paths) {
+    MemoryContext oldctx = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+    shortest_path_context *sp_ctx = palloc0(sizeof(shortest_path_context));
+    gtype_value *agtv_temp;
+    char *graph_name;
+    vertex *v;
+    graphid vsid;
+    graphid veid;
+    int64 lidx;
+    int64 vertex_count;
+
+    // get the graph name - this is a required argument
+    agtv_temp = get_gtype_value("shortestPath", AG_GET_ARG_GTYPE_P(0), AGTV_STRING, true);
+    graph_name = pnstrdup(agtv_temp->val.string.val, agtv_temp->val.string.len);
+    sp_ctx->graph_oid = get_graph_oid(graph_name);
+
+    /*
+     * Create or retrieve the GRAPH global context for this graph. This function
+     * will also purge off invalidated contexts.
+     */
+    sp_ctx->ggctx = manage_graph_contexts(graph_name, sp_ctx->graph_oid);
+    sp_ctx->all_paths = all_paths;
+
+    // start and end ids
+    v = AG_GET_ARG_VERTEX(1);
+    vsid = *((int64 *)(&v->children[0]));
+    v = AG_GET_ARG_VERTEX(2);
+    veid = *((int64 *)(&v->children[0]));
+
+    // get the left range index, a shortest path can't be made longer
+    if (PG_ARGISNULL(3) || is_gtype_null(AG_GET_ARG_GTYPE_P(3))) {
+        lidx = 1;
+    } else {
+        agtv_temp = get_gtype_value("shortestPath", AG_GET_ARG_GTYPE_P(3), AGTV_INTEGER, true);
+        lidx = agtv_temp->val.int_value;
+    }
+
+    if (lidx < 0 || lidx > 1)
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                        errmsg("shortestPath does not support a minimal length different from 0 or 1")));
+
+    // get the right range index. NULL means infinite
+    if (PG_ARGISNULL(4) || is_gtype_null(AG_GET_ARG_GTYPE_P(4))) {
+        sp_ctx->uidx_infinite = true;
+        sp_ctx->uidx = -1;
+    } else {
+        agtv_temp = get_gtype_value("shortestPath", AG_GET_ARG_GTYPE_P(4), AGTV_INTEGER, true);
+        sp_ctx->uidx = agtv_temp->val.int_value;
+        sp_ctx->uidx_infinite = false;
+    }
+
+    // get edge direction
+    agtv_temp = get_gtype_value("shortestPath", AG_GET_ARG_GTYPE_P(5), AGTV_INTEGER, true);
+    sp_ctx->edge_direction = agtv_temp->val.int_value;
+
+    // label name
+    if (PG_ARGISNULL(6) || is_gtype_null(AG_GET_ARG_GTYPE_P(6))) {
+        build_label_filter(&sp_ctx->edge_labels, sp_ctx->graph_oid, NULL);
+    } else {
+        agtv_temp = get_gtype_value("shortestPath", AG_GET_ARG_GTYPE_P(6), AGTV_STRING, true);
+        build_label_filter(&sp_ctx->edge_labels, sp_ctx->graph_oid,
+                           pnstrdup(agtv_temp->val.string.val, agtv_temp->val.string.len));
+    }
+
+    if (PG_ARGISNULL(7) || is_gtype_null(AG_GET_ARG_GTYPE_P(7)))
+        build_property_filter(&sp_ctx->properties, NULL);
+    else
+        build_property_filter(&sp_ctx->properties, AG_GET_ARG_GTYPE_P(7));
+
+    sp_ctx->vsidx = get_vertex_index(sp_ctx->ggctx, vsid);
+    sp_ctx->veidx = get_vertex_index(sp_ctx->ggctx, veid);
+
+    // nothing to find if either vertex is missing, or there is no path to take
+    if (sp_ctx->vsidx < 0 || sp_ctx->veidx < 0 || sp_ctx->vsidx == sp_ctx->veidx ||
+        (!sp_ctx->uidx_infinite && sp_ctx->uidx < 1)) {
+        sp_ctx->done = true;
+        MemoryContextSwitchTo(oldctx);
+        return sp_ctx;
+    }
+
+    vertex_count = get_graph_vertex_count(sp_ctx->ggctx);
+
+    sp_ctx->pool_cap = BFS_INITIAL_POOL_SIZE;
+    sp_ctx->pool_edges = palloc(sizeof(int64) * sp_ctx->pool_cap);
+    sp_ctx->pool_vertices = palloc(sizeof(int64) * sp_ctx->pool_cap);
+    sp_ctx->pool_next = palloc(sizeof(int64) * sp_ctx->pool_cap);
+
+    init_bfs_side(funcctx->multi_call_memory_ctx, &sp_ctx->sides[0], vertex_count, sp_ctx->vsidx, true);
+    init_bfs_side(funcctx->multi_call_memory_ctx, &sp_ctx->sides[1], vertex_count, sp_ctx->veidx, false);
+
+    find_shortest_paths(sp_ctx);
+
+    MemoryContextSwitchTo(oldctx);
+
+    return sp_ctx;
+}
+
+/*
+ * Get vertex marks for a search, with no vertex reached. They are released
+ * when the memory context of the search goes away.
+ */
+static bfs_vertex_marks *acquire_vertex_marks(MemoryContext mcxt, int64 vertex_count) {
+    bfs_vertex_marks *marks = free_vertex_marks;
+    MemoryContextCallback *callback;
+
+    vertex_count = Max(vertex_count, 1);
+
+    if (marks != NULL) {
+        free_vertex_marks = marks->next;
+        free_vertex_marks_cnt--;
+
+        // too small for this graph, or left over from a much larger one
+        if (marks->capacity < vertex_count || marks->capacity > 4 * Max(vertex_count, 1024)) {
+            free_vertex_marks_entry(marks);
+            marks = NULL;
+        }
+    }
+
+    if (marks == NULL) {
+        marks = MemoryContextAllocZero(TopMemoryContext, sizeof(bfs_vertex_marks));
+        marks->marks = MemoryContextAllocHuge(TopMemoryContext, sizeof(uint32) * vertex_count);
+        marks->depths = MemoryContextAllocHuge(TopMemoryContext, sizeof(int32) * vertex_count);
+        marks->parents = MemoryContextAllocHuge(TopMemoryContext, sizeof(int64) * vertex_count);
+        marks->capacity = vertex_count;
+        memset(marks->marks, 0, sizeof(uint32) * marks->capacity);
+    }
+
+    // a new generation unmarks every vertex, 0 is never used as one
+    if (++marks->generation == 0) {
+        memset(marks->marks, 0, sizeof(uint32) * marks->capacity);
+        marks->generation = 1;
+    }
+
+    marks->next = NULL;
+
+    callback = MemoryContextAlloc(mcxt, sizeof(MemoryContextCallback));
+    callback->func = release_vertex_marks;
+    callback->arg = marks;
+    MemoryContextRegisterResetCallback(mcxt, callback);
+
+    return marks;
+}
+
+// give the vertex marks back for the next search to use
+static void release_vertex_marks(void *arg) {
+    bfs_vertex_marks *marks = arg;
+
+    if (free_vertex_marks_cnt >= MAXIMUM_NUMBER_OF_FREE_VERTEX_MARKS) {
+        free_vertex_marks_entry(marks);
+        return;
+    }
+
+    marks->next = free_vertex_marks;
+    free_vertex_marks = marks;
+    free_vertex_marks_cnt++;
+}
+
+// free vertex marks that won't be used again
+static void free_vertex_marks_entry(bfs_vertex_marks *marks) {
+    pfree(marks->marks);
+    pfree(marks->depths);
+    pfree(marks->parents);
+    pfree(marks);
+}
+
+// the depth the side reached the vertex at, -1 if not reached
+static inline int32 get_vertex_depth(bfs_side *side, int64 vertex_index) {
+    bfs_vertex_marks *marks = side->reached;
+
+    return marks->marks[vertex_index] == marks->generation ? marks->depths[vertex_index] : -1;
+}
+
+// mark the vertex reached at the depth, with no parents yet
+static inline void reach_vertex(bfs_side *side, int64 vertex_index, int32 depth) {
+    bfs_vertex_marks *marks = side->reached;
+
+    marks->marks[vertex_index] = marks->generation;
+    marks->depths[vertex_index] = depth;
+    marks->parents[vertex_index] = -1;
+}
+
+// set up one side of the search, starting at the passed vertex
+static void init_bfs_side(MemoryContext mcxt, bfs_side *side, int64 vertex_count, int64 vertex_index, bool forward) {
+    side->reached = acquire_vertex_marks(mcxt, vertex_count);
+
+    side->frontier = new_graphid_stack();
+    side->next = new_graphid_stack();
+    push_graphid_stack(side->frontier, vertex_index);
+    side->depth = 0;
+    side->forward = forward;
+
+    reach_vertex(side, vertex_index, 0);
+}
+
+// record that a vertex was reached through an edge from the parent vertex
+static void add_parent(shortest_path_context *sp_ctx, bfs_side *side, int64 vertex_index, int64 edge_index, int64 parent_index) {
+    if (sp_ctx->pool_cnt == sp_ctx->pool_cap) {
+        sp_ctx->pool_cap *= 2;
+        sp_ctx->pool_edges = repalloc_huge(sp_ctx->pool_edges, sizeof(int64) * sp_ctx->pool_cap);
+        sp_ctx->pool_vertices = repalloc_huge(sp_ctx->pool_vertices, sizeof(int64) * sp_ctx->pool_cap);
+        sp_ctx->pool_next = repalloc_huge(sp_ctx->pool_next, sizeof(int64) * sp_ctx->pool_cap);
+    }
+
+    sp_ctx->pool_edges[sp_ctx->pool_cnt] = edge_index;
+    sp_ctx->pool_vertices[sp_ctx->pool_cnt] = parent_index;
+    sp_ctx->pool_next[sp_ctx->pool_cnt] = side->reached->parents[vertex_index];
+    side->reached->parents[vertex_index] = sp_ctx->pool_cnt++;
+}
+
+/*
+ * Expand one side of the search by a whole level. Returns true if any vertex
+ * reached was already reached by the other side. In that case, the meeting
+ * vertices of the shortest paths are collected.
+ */
+static bool expand_bfs_side(shortest_path_context *sp_ctx, bfs_side *side, bfs_side *other) {
+    graph_context *ggctx = sp_ctx->ggctx;
+    graphid_stack *next = side->next;
+    int32 best = -1;
+    bool use_out;
+    bool use_in;
+
+    // which runs lead away from where this side started
+    use_out = (sp_ctx->edge_direction == CYPHER_REL_DIR_NONE ||
+               (sp_ctx->edge_direction == CYPHER_REL_DIR_RIGHT) == side->forward);
+    use_in = (sp_ctx->edge_direction == CYPHER_REL_DIR_NONE ||
+              (sp_ctx->edge_direction == CYPHER_REL_DIR_LEFT) == side->forward);
+
+    sp_ctx->meet_cnt = 0;
+    reset_graphid_stack(next);
+
+    for (int64 i = 0; i < graphid_stack_size(side->frontier); i++) {
+        int64 vertex_index = side->frontier->ids[i];
+        vertex_adjacency adj;
+        int64 start;
+        int64 end;
+
+        get_vertex_adjacency(ggctx, vertex_index, &adj);
+
+        // self loops never shorten a path, so they are skipped
+        start = use_out ? 0 : adj.out_cnt;
+        end = use_in ? adj.out_cnt + adj.in_cnt : adj.out_cnt;
+
+        for (int64 j = start; j < end; j++) {
+            int64 next_index = adj.vertices[j];
+            int32 depth = get_vertex_depth(side, next_index);
+
+            // only the first way there is needed, unless all paths are wanted
+            if (depth != -1 && (depth != side->depth + 1 || !sp_ctx->all_paths))
+                continue;
+
+            if (!check_edge_constraints(ggctx, adj.edges[j], adj.labels[j], &sp_ctx->edge_labels, &sp_ctx->properties))
+                continue;
+
+            if (depth == -1) {
+                reach_vertex(side, next_index, side->depth + 1);
+                push_graphid_stack(next, next_index);
+            }
+
+            add_parent(sp_ctx, side, next_index, adj.edges[j], vertex_index);
+        }
+    }
+
+    // the next level becomes the frontier, the old one is reused after it
+    side->next = side->frontier;
+    side->frontier = next;
+    side->depth++;
+
+    /*
+     * The shortest paths go through the new vertices the other side reached
+     * in the fewest steps. Each path goes through exactly one of them.
+     */
+    for (int64 i = 0; i < graphid_stack_size(next); i++) {
+        int32 depth = get_vertex_depth(other, next->ids[i]);
+
+        if (depth != -1 && (best == -1 || depth < best))
+            best = depth;
+    }
+
+    if (best == -1)
+        return false;
+
+    // the paths must not be longer than the upper bound
+    if (!sp_ctx->uidx_infinite && side->depth + best > sp_ctx->uidx)
+        return false;
+
+    sp_ctx->meets = palloc(sizeof(int64) * graphid_stack_size(next));
+    for (int64 i = 0; i < graphid_stack_size(next); i++) {
+        if (get_vertex_depth(other, next->ids[i]) == best)
+            sp_ctx->meets[sp_ctx->meet_cnt++] = next->ids[i];
+    }
+
+    return true;
+}
+
+/*
+ * Run the bidirectional search, always expanding the side with the smaller
+ * frontier, until the sides meet or one of them runs out of vertices.
+ */
+static void find_shortest_paths(shortest_path_context *sp_ctx) {
+    bfs_side *forward = &sp_ctx->sides[0];
+    bfs_side *backward = &sp_ctx->sides[1];
+
+    for (;;) {
+        bfs_side *side;
+        bfs_side *other;
+
+        CHECK_FOR_INTERRUPTS();
+
+        if (IS_GRAPHID_STACK_EMPTY(forward->frontier) || IS_GRAPHID_STACK_EMPTY(backward->frontier))
+            break;
+
+        // the next level can only add paths longer than the upper bound
+        if (!sp_ctx->uidx_infinite && forward->depth + backward->depth + 1 > sp_ctx->uidx)
+            break;
+
+        side = (graphid_stack_size(forward->frontier) <= graphid_stack_size(backward->frontier)) ? forward : backward;
+        other = (side == forward) ? backward : forward;
+
+        if (expand_bfs_side(sp_ctx, side, other)) {
+            sp_ctx->meet = 0;
+            first_chain(sp_ctx, &sp_ctx->chains[0], forward, sp_ctx->meets[0], 0);
+            first_chain(sp_ctx, &sp_ctx->chains[1], backward, sp_ctx->meets[0], 0);
+            return;
+        }
+    }
+
+    sp_ctx->done = true;
+}
+
+/*
+ * Set the chain to the first path from the vertex back to where the side
+ * started, keeping the positions above from.
+ */
+static void first_chain(shortest_path_context *sp_ctx, bfs_chain *chain, bfs_side *side, int64 vertex_index, int32 from) {
+    if (from == 0) {
+        chain->len = get_vertex_depth(side, vertex_index);
+        chain->vertices = palloc(sizeof(int64) * (chain->len + 1));
+        chain->edges = palloc(sizeof(int64) * (chain->len + 1));
+        chain->cursors = palloc(sizeof(int64) * (chain->len + 1));
+        chain->vertices[chain->len] = vertex_index;
+        from = chain->len;
+    }
+
+    for (int32 k = from; k > 0; k--) {
+        int64 entry = side->reached->parents[chain->vertices[k]];
+
+        Assert(entry >= 0);
+
+        chain->cursors[k] = entry;
+        chain->edges[k] = sp_ctx->pool_edges[entry];
+        chain->vertices[k - 1] = sp_ctx->pool_vertices[entry];
+    }
+}
+
+/*
+ * Move the chain to its next path, changing the choice closest to where the
+ * side started first. Returns false when there are no more.
+ */
+static bool next_chain(shortest_path_context *sp_ctx, bfs_chain *chain, bfs_side *side) {
+    for (int32 k = 1; k <= chain->len; k++) {
+        int64 entry = sp_ctx->pool_next[chain->cursors[k]];
+
+        if (entry < 0)
+            continue;
+
+        chain->cursors[k] = entry;
+        chain->edges[k] = sp_ctx->pool_edges[entry];
+        chain->vertices[k - 1] = sp_ctx->pool_vertices[entry];
+
+        first_chain(sp_ctx, chain, side, chain->vertices[k - 1], k - 1);
+
+        return true;
+    }
+
+    return false;
+}
+
+// move to the next shortest path, returns false when there are no more
+static bool next_shortest_path(shortest_path_context *sp_ctx) {
+    bfs_side *forward = &sp_ctx->sides[0];
+    bfs_side *backward = &sp_ctx->sides[1];
+
+    if (!sp_ctx->all_paths)
+        return false;
+
+    if (next_chain(sp_ctx, &sp_ctx->chains[1], backward))
+        return true;
+
+    if (next_chain(sp_ctx, &sp_ctx->chains[0], forward)) {
+        first_chain(sp_ctx, &sp_ctx->chains[1], backward, sp_ctx->meets[sp_ctx->meet], 0);
+        return true;
+    }
+
+    if (++sp_ctx->meet == sp_ctx->meet_cnt)
+        return false;
+
+    first_chain(sp_ctx, &sp_ctx->chains[0], forward, sp_ctx->meets[sp_ctx->meet], 0);
+    first_chain(sp_ctx, &sp_ctx->chains[1], backward, sp_ctx->meets[sp_ctx->meet], 0);
+
+    return true;
+}
+
+// build the variable_edge of the current path, start vertex to end vertex
+static VariableEdge *build_shortest_path(shortest_path_context *sp_ctx) {
+    graph_context *ggctx = sp_ctx->ggctx;
+    bfs_chain *forward = &sp_ctx->chains[0];
+    bfs_chain *backward = &sp_ctx->chains[1];
+    int graphid_array_size = (forward->len + backward->len) * 2 + 1;
+    graphid *graphid_array = palloc(sizeof(graphid) * graphid_array_size);
+    int index = 0;
+
+    graphid_array[index++] = get_vertex_id(ggctx, forward->vertices[0]);
+
+    for (int32 k = 1; k <= forward->len; k++) {
+        graphid_array[index++] = get_edge_id(ggctx, forward->edges[k]);
+        graphid_array[index++] = get_vertex_id(ggctx, forward->vertices[k]);
+    }
+
+    for (int32 k = backward->len; k > 0; k--) {
+        graphid_array[index++] = get_edge_id(ggctx, backward->edges[k]);
+        graphid_array[index++] = get_vertex_id(ggctx, backward->vertices[k - 1]);
+    }
+
+    return create_compact_variable_edge(sp_ctx->graph_oid, graphid_array, graphid_array_size);
+}
+
+/*
+ *     0 - gtype REQUIRED (graph name as string)
+ *     1 - vertex REQUIRED (start vertex)
+ *     2 - vertex REQUIRED (end vertex)
+ *     3 - gtype OPTIONAL lidx (lower range index, 0 or 1)
+ *     4 - gtype OPTIONAL uidx (upper range index)
+ *     5 - gtype REQUIRED edge direction (enum) as an integer
+ *     6 - gtype OPTIONAL edge label name
+ *     7 - gtype OPTIONAL edge property constraints
+ */
+static Datum shortest_path_srf(FunctionCallInfo fcinfo, bool all_paths) {
+    FuncCallContext *funcctx;
+    shortest_path_context *sp_ctx;
+    bool found_a_path;
+
+    // Initialization for the first call to the SRF
+    if (SRF_IS_FIRSTCALL()) {
+        // all of these arguments need to be non NULL
+        if (PG_ARGISNULL(0) || PG_ARGISNULL(1) || PG_ARGISNULL(2) || PG_ARGISNULL(5))
+             ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("shortestPath: invalid NULL argument passed")));
+
+        funcctx = SRF_FIRSTCALL_INIT();
+
+        funcctx->user_fctx = build_shortest_path_context(fcinfo, funcctx, all_paths);
+        sp_ctx = funcctx->user_fctx;
+
+        found_a_path = !sp_ctx->done;
+    } else {
+        MemoryContext oldctx;
+
+        funcctx = SRF_PERCALL_SETUP();
+        sp_ctx = funcctx->user_fctx;
+
+        // the chains live as long as the search does
+        oldctx = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+        found_a_path = !sp_ctx->done && next_shortest_path(sp_ctx);
+        MemoryContextSwitchTo(oldctx);
+    }
+
+    if (found_a_path)
+        SRF_RETURN_NEXT(funcctx, PointerGetDatum(build_shortest_path(sp_ctx)));
+
+    sp_ctx->done = true;
+    SRF_RETURN_DONE(funcctx);
+}
+
+PG_FUNCTION_INFO_V1(gtype_shortest_path);
+Datum gtype_shortest_path(PG_FUNCTION_ARGS) {
+    return shortest_path_srf(fcinfo, false);
+}
+
+PG_FUNCTION_INFO_V1(gtype_all_shortest_paths);
+Datum gtype_all_shortest_paths(PG_FUNCTION_ARGS) {
+    return shortest_path_srf(fcinfo, true);
+}
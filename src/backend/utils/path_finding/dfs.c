@@ -20,14 +20,21 @@
 #include "postgres.h"
 
 #include "access/heapam.h"
+#include "access/htup_details.h"
 #include "catalog/namespace.h"
+#include "catalog/pg_inherits.h"
 #include "catalog/pg_type.h"
 #include "common/hashfn.h"
 #include "funcapi.h"
+#include "miscadmin.h"
+#include "utils/builtins.h"
+#include "utils/datum.h"
 #include "utils/lsyscache.h"
+#include "utils/snapmgr.h"
 
 #include "utils/path_finding.h"
 #include "catalog/ag_graph.h"
+#include "catalog/ag_label.h"
 #include "utils/graphid.h"
 #include "utils/queue.h"
 #include "nodes/cypher_nodes.h"
@@ -38,18 +45,67 @@
 // defines 
 #define GET_GRAPHID_ARRAY_FROM_CONTAINER(vpc) \
             (graphid *) (&vpc->graphid_array_data)
-#define EDGE_STATE_HTAB_NAME "Edge state "
-#define EDGE_STATE_HTAB_INITIAL_SIZE 100000
-#define EXISTS_HTAB_NAME "known edges"
-#define EXISTS_HTAB_NAME_INITIAL_SIZE 1000
+#define SMALL_EDGE_ID_COUNT 16
+#define EDGE_ID_ARG_OTHER 0
+#define EDGE_ID_ARG_GRAPHID 1
+#define EDGE_ID_ARG_VARIABLE_EDGE 2
 #define MAXIMUM_NUMBER_OF_CACHED_LOCAL_CONTEXTS 5
+#define MAXIMUM_NUMBER_OF_FREE_VISIT_MARKS 4
 
-// edge state entry for the edge_state_hashtable 
-typedef struct edge_state_entry
+/*
+ * The edges in the path being searched, as one mark per edge index. An edge
+ * is marked when its mark equals the generation, so the marks of a search are
+ * all cleared in O(1) by moving to the next generation. The arrays are kept
+ * for the next searches once a search is done, so a VLE run for every row of
+ * a lateral join doesn't allocate them again. Only a few are kept, and marks
+ * much larger than the graph searched need are freed rather than reused.
+ */
+typedef struct edge_visit_marks
+{
+    uint32 *marks;                 // per edge index
+    int64 capacity;                // number of marks allocated
+    uint32 generation;             // mark of the edges in the path
+    struct edge_visit_marks *next; // next unused marks
+} edge_visit_marks;
+
+// edge visit marks not used by any search
+static edge_visit_marks *free_visit_marks = NULL;
+static int free_visit_marks_cnt = 0;
+
+/*
+ * The results of a VLE call, for one start and end vertex, kept for the rest
+ * of the query. In a lateral join the VLE is often run again for the same
+ * vertices, the results are then returned from the memo rather than searched
+ * for again.
+ */
+typedef struct vle_memo_key
+{
+    graphid vsid;                  // starting vertex id 
+    graphid veid;                  // ending vertex id, 0 without one 
+} vle_memo_key;
+
+typedef struct vle_memo_entry
+{
+    vle_memo_key key;
+    List *results;                 // the rows returned, as datums 
+} vle_memo_entry;
+
+typedef struct vle_memo
 {
-    graphid edge_id;               // edge id, it is also the hash key 
-    bool visited;             // like visited but more descriptive 
-} edge_state_entry;
+    FmgrInfo *flinfo;              // the VLE call the memo is for 
+    MemoryContext query_ctx;       // per query memory of the call 
+    MemoryContext mcxt;            // memory of the entries 
+    HTAB *entries;                 // the results by start and end vertex 
+    int nargs;                     // the arguments besides the vertices 
+    Datum *args;
+    bool *nulls;
+    CommandId curcid;              // command the results were found for 
+    Size size;                     // bytes used by the results 
+    struct vle_memo *next;
+} vle_memo;
+
+// the memos of the VLE calls in the running queries 
+static vle_memo *vle_memos = NULL;
 
 typedef struct path_finding_context
 {
@@ -58,18 +114,27 @@ typedef struct path_finding_context
     graph_context *ggctx;   // global graph context pointer 
     graphid vsid;                  // starting vertex id 
     graphid veid;                  // ending vertex id 
-    char *label_name;         // edge label name for match 
-    gtype *properties; // edge property constraint as gtype 
+    int64 vsidx;                   // starting vertex index 
+    int64 veidx;                   // ending vertex index 
+    bool single_source;            // flag if every vertex reached is an end 
+    int64 last_vertex_index;       // end vertex of the path found 
+    label_filter edge_labels;      // edge label tables for match 
+    property_filter properties;    // edge property constraint, compiled 
     int64 lidx;                    // lower (start) bound index 
     int64 uidx;                    // upper (end) bound index 
     bool uidx_infinite;            // flag if the upper bound is omitted 
     cypher_rel_dir edge_direction; // the direction of the edge 
-    HTAB *edge_state_hashtable;    // local state hashtable for our edges 
-    HTAB *exists_hash;
-    Queue *dfs_vertex_queue; // dfs queue for vertices 
-    Queue *dfs_edge_queue;   // dfs queue for edges 
-    Queue *dfs_path_queue;   // dfs queue containing the path 
-    QueueNode *next_vertex;      // for VLE_FUNCTION_PATHS_TO 
+    edge_visit_marks *visit_marks; // edges in the current path 
+    graphid_stack *dfs_vertex_stack; // dfs stack for vertices, as vertex indexes 
+    graphid_stack *dfs_edge_stack;   // dfs stack for edges, as edge indexes 
+    graphid_stack *dfs_path_stack;   // dfs stack containing the path, as edge indexes 
+    vle_memo *memo;                // memo of the call, NULL if not kept 
+    vle_memo_key memo_key;         // the vertices searched 
+    MemoryContext memo_ctx;        // holds memo_results, until memoized 
+    List *memo_results;            // rows returned so far, to memoize 
+    Size memo_size;                // bytes used by memo_results 
+    vle_memo_entry *memo_entry;    // the memoized rows being returned 
+    ListCell *memo_next;           // the next memoized row to return 
     struct path_finding_context *next;  // the next chained path_finding_context 
 } path_finding_context;
 
@@ -89,105 +154,467 @@ typedef struct path_container
     graphid graphid_array_data;
 } path_container;
 
-// gtype functions 
-static bool check_edge_constraints(path_finding_context *path_ctx, edge_entry *ee);
 // VLE local context functions 
-static path_finding_context *build_vle_context(FunctionCallInfo fcinfo, FuncCallContext *funcctx);
-static void create_hashtable(path_finding_context *path_ctx);
+static path_finding_context *build_vle_context(FunctionCallInfo fcinfo, FuncCallContext *funcctx, bool single_source);
+static edge_visit_marks *acquire_visit_marks(MemoryContext mcxt, int64 edge_count);
+static void release_visit_marks(void *arg);
+static void grow_visit_marks(edge_visit_marks *marks, int64 edge_count);
+static void free_visit_marks_entry(edge_visit_marks *marks);
+// VLE memo functions 
+static path_finding_context *start_vle_call(FunctionCallInfo fcinfo, FuncCallContext *funcctx, bool single_source);
+static vle_memo *get_vle_memo(FunctionCallInfo fcinfo, int first_arg);
+static void reset_vle_memo(vle_memo *memo);
+static void remove_vle_memo(void *arg);
+static void record_vle_result(path_finding_context *path_ctx, MemoryContext mcxt, Datum result);
+static void finish_vle_memo_entry(path_finding_context *path_ctx);
 // VLE graph traversal functions 
-static edge_state_entry *get_edge_state(path_finding_context *path_ctx, graphid edge_id);
 // graphid data structures 
-static void load_initial_dfs_queues(path_finding_context *path_ctx);
+static void load_initial_dfs_stacks(path_finding_context *path_ctx);
 static bool dfs_find_a_path_between(path_finding_context *path_ctx);
 static bool do_vsid_and_veid_exist(path_finding_context *path_ctx);
-static void add_edges(path_finding_context *path_ctx, graphid vertex_id);
-static graphid get_next_vertex(path_finding_context *path_ctx, edge_entry *ee);
+static void add_edges(path_finding_context *path_ctx, int64 vertex_index);
+static int64 get_next_vertex(path_finding_context *path_ctx, int64 edge_index);
 // VLE path and edge building functions 
 static path_container *create_path_container(int64 path_size);
 static path_container *build_path_container(path_finding_context *path_ctx);
 VariableEdge *create_variable_edge(path_container *vpc);
 
-static void 
-append_to_buffer(StringInfo buffer, const char *data, int len) {
-    int offset = reserve_from_buffer(buffer, len);
-    memcpy(buffer->data + offset, data, len);
+/*
+ * Get edge visit marks for a search, with every edge unmarked. They are
+ * released when the memory context of the search goes away, whether or not
+ * the search ran to its end.
+ */
+static edge_visit_marks *acquire_visit_marks(MemoryContext mcxt, int64 edge_count) {
+    edge_visit_marks *marks = free_visit_marks;
+    MemoryContextCallback *callback;
+
+    if (marks != NULL) {
+        free_visit_marks = marks->next;
+        free_visit_marks_cnt--;
+
+        // left over from a much larger graph, small arrays are just reused
+        if (marks->capacity > 4 * Max(edge_count, 1024)) {
+            free_visit_marks_entry(marks);
+            marks = NULL;
+        }
+    }
+
+    if (marks == NULL) {
+        marks = MemoryContextAllocZero(TopMemoryContext, sizeof(edge_visit_marks));
+        marks->marks = MemoryContextAllocHuge(TopMemoryContext, sizeof(uint32) * Max(edge_count, 1));
+        marks->capacity = Max(edge_count, 1);
+        memset(marks->marks, 0, sizeof(uint32) * marks->capacity);
+    }
+
+    grow_visit_marks(marks, edge_count);
+
+    // a new generation unmarks every edge, 0 is never used as one
+    if (++marks->generation == 0) {
+        memset(marks->marks, 0, sizeof(uint32) * marks->capacity);
+        marks->generation = 1;
+    }
+
+    marks->next = NULL;
+
+    callback = MemoryContextAlloc(mcxt, sizeof(MemoryContextCallback));
+    callback->func = release_visit_marks;
+    callback->arg = marks;
+    MemoryContextRegisterResetCallback(mcxt, callback);
+
+    return marks;
+}
+
+// give the edge visit marks back for the next search to use
+static void release_visit_marks(void *arg) {
+    edge_visit_marks *marks = arg;
+
+    if (free_visit_marks_cnt >= MAXIMUM_NUMBER_OF_FREE_VISIT_MARKS) {
+        free_visit_marks_entry(marks);
+        return;
+    }
+
+    marks->next = free_visit_marks;
+    free_visit_marks = marks;
+    free_visit_marks_cnt++;
+}
+
+// free edge visit marks that won't be used again
+static void free_visit_marks_entry(edge_visit_marks *marks) {
+    pfree(marks->marks);
+    pfree(marks);
+}
+
+// make room for the marks of edges created since the marks were allocated
+static void grow_visit_marks(edge_visit_marks *marks, int64 edge_count) {
+    int64 capacity = marks->capacity;
+
+    if (edge_count <= capacity)
+        return;
+
+    while (capacity < edge_count)
+        capacity *= 2;
+
+    marks->marks = repalloc_huge(marks->marks, sizeof(uint32) * capacity);
+    memset(marks->marks + marks->capacity, 0, sizeof(uint32) * (capacity - marks->capacity));
+    marks->capacity = capacity;
+}
+
+// is the edge in the path being searched
+static inline bool is_edge_visited(path_finding_context *path_ctx, int64 edge_index) {
+    edge_visit_marks *marks = path_ctx->visit_marks;
+
+    return edge_index < marks->capacity && marks->marks[edge_index] == marks->generation;
+}
+
+// add the edge to, or remove it from, the path being searched
+static inline void set_edge_visited(path_finding_context *path_ctx, int64 edge_index, bool visited) {
+    edge_visit_marks *marks = path_ctx->visit_marks;
+
+    if (edge_index >= marks->capacity)
+        grow_visit_marks(marks, edge_index + 1);
+
+    marks->marks[edge_index] = visited ? marks->generation : 0;
+}
+
+/*
+ * Get the memo of the VLE call, creating it the first time. The memo is for
+ * the arguments other than the vertices and for one command, it is emptied
+ * when they change.
+ */
+static vle_memo *get_vle_memo(FunctionCallInfo fcinfo, int first_arg) {
+    ReturnSetInfo *rsi = (ReturnSetInfo *)fcinfo->resultinfo;
+    EState *estate;
+    CommandId curcid;
+    vle_memo *memo;
+    bool changed = false;
+    int nargs;
+
+    if (work_mem <= 0 || rsi == NULL || !IsA(rsi, ReturnSetInfo) || rsi->econtext == NULL)
+        return NULL;
+
+    // the cypher executors advance the command id of the query's own snapshot
+    estate = rsi->econtext->ecxt_estate;
+    if (estate != NULL && estate->es_snapshot != NULL)
+        curcid = estate->es_snapshot->curcid;
+    else if (ActiveSnapshotSet())
+        curcid = GetActiveSnapshot()->curcid;
+    else
+        return NULL;
+    nargs = 1 + fcinfo->nargs - first_arg;
+
+    for (memo = vle_memos; memo != NULL; memo = memo->next) {
+        if (memo->flinfo == fcinfo->flinfo)
+            break;
+    }
+
+    if (memo == NULL) {
+        MemoryContext query_ctx = rsi->econtext->ecxt_per_query_memory;
+        MemoryContextCallback *callback;
+
+        memo = MemoryContextAllocZero(query_ctx, sizeof(vle_memo));
+        memo->flinfo = fcinfo->flinfo;
+        memo->query_ctx = query_ctx;
+        memo->mcxt = AllocSetContextCreate(query_ctx, "VLE memo", ALLOCSET_DEFAULT_SIZES);
+        memo->nargs = nargs;
+        memo->args = MemoryContextAllocZero(query_ctx, sizeof(Datum) * nargs);
+        memo->nulls = MemoryContextAllocZero(query_ctx, sizeof(bool) * nargs);
+        memo->curcid = curcid;
+
+        callback = MemoryContextAlloc(query_ctx, sizeof(MemoryContextCallback));
+        callback->func = remove_vle_memo;
+        callback->arg = memo;
+        MemoryContextRegisterResetCallback(query_ctx, callback);
+
+        memo->next = vle_memos;
+        vle_memos = memo;
+
+        changed = true;
+    }
+
+    // the graph name, then the arguments after the vertices 
+    for (int i = 0; i < nargs && !changed; i++) {
+        int arg = (i == 0) ? 0 : first_arg + i - 1;
+
+        if (PG_ARGISNULL(arg) != memo->nulls[i] ||
+            (!memo->nulls[i] && !datumIsEqual(PG_GETARG_DATUM(arg), memo->args[i], false, -1)))
+            changed = true;
+    }
+
+    if (changed || memo->curcid != curcid) {
+        MemoryContext oldctx = MemoryContextSwitchTo(memo->query_ctx);
+
+        reset_vle_memo(memo);
+
+        for (int i = 0; i < nargs; i++) {
+            int arg = (i == 0) ? 0 : first_arg + i - 1;
+
+            if (!memo->nulls[i] && memo->args[i] != (Datum)0)
+                pfree(DatumGetPointer(memo->args[i]));
+
+            memo->nulls[i] = PG_ARGISNULL(arg);
+            memo->args[i] = memo->nulls[i] ? (Datum)0 : datumCopy(PG_GETARG_DATUM(arg), false, -1);
+        }
+
+        memo->curcid = curcid;
+
+        MemoryContextSwitchTo(oldctx);
+    }
+
+    return memo;
 }
 
+// empty the memo 
+static void reset_vle_memo(vle_memo *memo) {
+    HASHCTL ctl;
+
+    MemoryContextReset(memo->mcxt);
 
-// helper function to create the local VLE edge state hashtable. 
-static void create_hashtable(path_finding_context *path_ctx) {
-    HASHCTL edge_state_ctl;
-    char *graph_name = NULL;
-    char *eshn = NULL;
-    int glen;
-    int elen;
+    MemSet(&ctl, 0, sizeof(ctl));
+    ctl.keysize = sizeof(vle_memo_key);
+    ctl.entrysize = sizeof(vle_memo_entry);
+    ctl.hcxt = memo->mcxt;
 
-    // get the graph name and length 
-    graph_name = path_ctx->graph_name;
+    memo->entries = hash_create("VLE memo entries", 64, &ctl, HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+    memo->size = 0;
+}
+
+// the query is done, forget its memo 
+static void remove_vle_memo(void *arg) {
+    vle_memo **prev = &vle_memos;
 
-    // initialize the edge state hashtable 
-    MemSet(&edge_state_ctl, 0, sizeof(edge_state_ctl));
-    edge_state_ctl.keysize = sizeof(int64);
-    edge_state_ctl.entrysize = sizeof(edge_state_entry);
-    edge_state_ctl.hash = tag_hash;
-    path_ctx->edge_state_hashtable = hash_create(EDGE_STATE_HTAB_NAME, EDGE_STATE_HTAB_INITIAL_SIZE, &edge_state_ctl,
-		                                 HASH_ELEM | HASH_FUNCTION);
+    while (*prev != NULL) {
+        if (*prev == arg) {
+            *prev = (*prev)->next;
+            break;
+        }
+        prev = &(*prev)->next;
+    }
+}
+
+/*
+ * Return the memoized rows of the vertices, if there are any, or start the
+ * search for them. The rows are only memoized once the search is done, an
+ * SRF that isn't run to its end leaves the memo as it was.
+ */
+static path_finding_context *start_vle_call(FunctionCallInfo fcinfo, FuncCallContext *funcctx, bool single_source) {
+    vle_memo *memo = get_vle_memo(fcinfo, single_source ? 2 : 3);
+    vle_memo_key key;
+    path_finding_context *path_ctx;
 
+    MemSet(&key, 0, sizeof(key));
+    key.vsid = *((int64 *)(&AG_GET_ARG_VERTEX(1)->children[0]));
+    if (!single_source)
+        key.veid = *((int64 *)(&AG_GET_ARG_VERTEX(2)->children[0]));
 
-    MemSet(&edge_state_ctl, 0, sizeof(edge_state_ctl));
-    edge_state_ctl.keysize = sizeof(int64);
-    edge_state_ctl.entrysize = sizeof(edge_state_entry);
-    edge_state_ctl.hash = tag_hash;
+    if (memo != NULL) {
+        vle_memo_entry *entry = hash_search(memo->entries, &key, HASH_FIND, NULL);
 
-    HASHCTL exists_ctl;
-    MemSet(&exists_ctl, 0, sizeof(exists_ctl));
-    exists_ctl.keysize = sizeof(int64);
-    exists_ctl.entrysize = sizeof(int64);
-    exists_ctl.hash = tag_hash;    
-    path_ctx->exists_hash = hash_create(EXISTS_HTAB_NAME, 20, &exists_ctl, HASH_ELEM | HASH_FUNCTION);
+        if (entry != NULL) {
+            path_ctx = MemoryContextAllocZero(funcctx->multi_call_memory_ctx, sizeof(path_finding_context));
+            path_ctx->memo_entry = entry;
+            path_ctx->memo_next = list_head(entry->results);
 
+            return path_ctx;
+        }
+    }
+
+    path_ctx = build_vle_context(fcinfo, funcctx, single_source);
+    path_ctx->memo = memo;
+    path_ctx->memo_key = key;
+
+    return path_ctx;
 }
 
 /*
- * Helper function to compare the edge constraint (properties we are looking
- * for in a matching edge) against an edge entry's property.
+ * Keep a copy of the row returned, until the search is done. The copies are
+ * made in a context of the SRF call, so a search that isn't run to its end
+ * takes them with it.
  */
-static bool check_edge_constraints(path_finding_context *path_ctx, edge_entry *ee)
+static void record_vle_result(path_finding_context *path_ctx, MemoryContext mcxt, Datum result) {
+    vle_memo *memo = path_ctx->memo;
+    MemoryContext oldctx;
+
+    if (memo == NULL)
+        return;
+
+    path_ctx->memo_size += VARSIZE(DatumGetPointer(result)) + sizeof(ListCell);
+
+    // the rows don't fit, don't memoize them 
+    if (memo->size + path_ctx->memo_size > (Size)work_mem * 1024L) {
+        if (path_ctx->memo_ctx != NULL)
+            MemoryContextDelete(path_ctx->memo_ctx);
+
+        path_ctx->memo_ctx = NULL;
+        path_ctx->memo_results = NIL;
+        path_ctx->memo = NULL;
+        return;
+    }
+
+    if (path_ctx->memo_ctx == NULL)
+        path_ctx->memo_ctx = AllocSetContextCreate(mcxt, "VLE memo entry", ALLOCSET_SMALL_SIZES);
+
+    oldctx = MemoryContextSwitchTo(path_ctx->memo_ctx);
+    path_ctx->memo_results = lappend(path_ctx->memo_results, DatumGetPointer(datumCopy(result, false, -1)));
+    MemoryContextSwitchTo(oldctx);
+}
+
+// the search is done, memoize its rows by handing their context to the memo 
+static void finish_vle_memo_entry(path_finding_context *path_ctx) {
+    vle_memo *memo = path_ctx->memo;
+    vle_memo_entry *entry;
+    bool found;
+
+    if (memo == NULL)
+        return;
+
+    entry = hash_search(memo->entries, &path_ctx->memo_key, HASH_ENTER, &found);
+    entry->results = path_ctx->memo_results;
+
+    if (path_ctx->memo_ctx != NULL)
+        MemoryContextSetParent(path_ctx->memo_ctx, memo->mcxt);
+
+    memo->size += path_ctx->memo_size;
+    path_ctx->memo_ctx = NULL;
+    path_ctx->memo_results = NIL;
+    path_ctx->memo = NULL;
+}
+
+/*
+ * Resolve the edge label to match to the label tables of the label and of the
+ * labels inheriting from it. Done once per search, so edges are checked by
+ * comparing Oids rather than by looking up their label's name. A label that
+ * doesn't exist matches no edges.
+ */
+void build_label_filter(label_filter *filter, Oid graph_oid, char *label_name)
+{
+    Oid relid;
+    List *oids;
+    ListCell *lc;
+
+    filter->active = (label_name != NULL);
+    filter->oids = NULL;
+    filter->oid_cnt = 0;
+
+    if (!filter->active)
+        return;
+
+    relid = get_label_relation(label_name, graph_oid);
+    if (!OidIsValid(relid))
+        return;
+
+    oids = find_all_inheritors(relid, NoLock, NULL);
+
+    filter->oids = palloc(sizeof(Oid) * list_length(oids));
+    foreach (lc, oids)
+        filter->oids[filter->oid_cnt++] = lfirst_oid(lc);
+
+    qsort(filter->oids, filter->oid_cnt, sizeof(Oid), oid_cmp);
+
+    list_free(oids);
+}
+
+/*
+ * Compile the edge property constraint into a list of key and scalar value
+ * probes, done once per search. Each probe is then a binary search on the
+ * edge's sorted keys and one comparison. Nested objects and lists are left to
+ * the deep contains check.
+ */
+void build_property_filter(property_filter *filter, gtype *properties)
+{
+    gtype_iterator *it;
+    gtype_iterator_token token;
+    gtype_value key;
+    gtype_value value;
+
+    filter->properties = properties;
+    filter->probes = NULL;
+    filter->probe_cnt = 0;
+    filter->key_cnt = 0;
+    filter->has_containers = false;
+
+    if (properties == NULL)
+        return;
+
+    filter->key_cnt = AGT_ROOT_COUNT(properties);
+    filter->probes = palloc(sizeof(property_probe) * Max(filter->key_cnt, 1));
+
+    it = gtype_iterator_init(&properties->root);
+    while ((token = gtype_iterator_next(&it, &key, true)) != WGT_DONE) {
+        if (token != WGT_KEY)
+            continue;
+
+        token = gtype_iterator_next(&it, &value, true);
+        Assert(token == WGT_VALUE);
+
+        if (IS_A_GTYPE_SCALAR(&value)) {
+            filter->probes[filter->probe_cnt].key = key;
+            filter->probes[filter->probe_cnt].value = value;
+            filter->probe_cnt++;
+        } else {
+            filter->has_containers = true;
+        }
+    }
+}
+
+/*
+ * Helper function to compare the edge constraint (label and properties we are
+ * looking for in a matching edge) against an edge's label and properties.
+ */
+bool check_edge_constraints(graph_context *ggctx, int64 edge_index, Oid label_oid, label_filter *labels, property_filter *properties)
 {
     gtype *edge_property = NULL;
     gtype_container *agtc_edge_property = NULL;
-    gtype_container *agtc_properties = NULL;
     gtype_iterator *constraint_it = NULL;
     gtype_iterator *property_it = NULL;
-    char *label_name = NULL;
-    int num_propertiess = 0;
-    int num_edge_properties = 0;
-    // get the edge label name from the oid 
-    label_name = get_rel_name(get_edge_entry_label_table_oid(ee));
 
-    if (path_ctx->label_name != NULL && strcmp(path_ctx->label_name, label_name) != 0)
-        return false;
+    // check the edge's label table against the ones matched
+    if (labels->active) {
+        int i;
+
+        for (i = 0; i < labels->oid_cnt; i++) {
+            if (labels->oids[i] >= label_oid)
+                break;
+        }
+
+        if (i == labels->oid_cnt || labels->oids[i] != label_oid)
+            return false;
+    }
 
-    if (path_ctx->properties == NULL)
+    if (properties->properties == NULL)
 	    return true;
 
-    label_name = get_rel_name(get_edge_entry_label_table_oid(ee));
-    edge_property = DATUM_GET_GTYPE_P(get_edge_entry_properties(ee));
-    agtc_properties = &path_ctx->properties->root;
+    edge_property = DATUM_GET_GTYPE_P(get_edge_properties(ggctx, edge_index));
     agtc_edge_property = &edge_property->root;
-    // get the number of properties in the edge to be matched 
-    num_edge_properties = GTYPE_CONTAINER_SIZE(agtc_edge_property);
 
     /*
      * Check to see if the edge_properties object has AT LEAST as many pairs
      * to compare as the properties object has pairs. If not, it
      * can't possibly match.
      */
-    if (AGT_ROOT_COUNT(path_ctx->properties) > num_edge_properties)
+    if (properties->key_cnt > GTYPE_CONTAINER_SIZE(agtc_edge_property))
         return false;
 
+    // probe the scalar values first, they settle most edges
+    for (int i = 0; i < properties->probe_cnt; i++) {
+        property_probe *probe = &properties->probes[i];
+        gtype_value *value = find_gtype_value_from_container(agtc_edge_property, GT_FOBJECT, &probe->key);
+        bool match;
+
+        if (value == NULL)
+            return false;
+
+        match = (value->type == probe->value.type && equals_gtype_scalar_value(value, &probe->value));
+        pfree(value);
+
+        if (!match)
+            return false;
+    }
+
+    if (!properties->has_containers)
+        return true;
+
     // get the iterators 
-    constraint_it = gtype_iterator_init(agtc_properties);
+    constraint_it = gtype_iterator_init(&properties->properties->root);
     property_it = gtype_iterator_init(agtc_edge_property);
 
     // return the value of deep contains 
@@ -197,24 +624,35 @@ static bool check_edge_constraints(path_finding_context *path_ctx, edge_entry *e
 // helper function to check if our start and end vertices exist 
 static bool do_vsid_and_veid_exist(path_finding_context *path_ctx)
 {
+    path_ctx->vsidx = get_vertex_index(path_ctx->ggctx, path_ctx->vsid);
+
+    // there is no end vertex to look for when every vertex reached is an end
+    if (path_ctx->single_source) {
+        path_ctx->veidx = -1;
+        return (path_ctx->vsidx >= 0);
+    }
+
+    path_ctx->veidx = get_vertex_index(path_ctx->ggctx, path_ctx->veid);
+
     // if we are using both start and end 
-    return ((get_vertex_entry(path_ctx->ggctx, path_ctx->vsid) != NULL) && (get_vertex_entry(path_ctx->ggctx, path_ctx->veid) != NULL));
+    return (path_ctx->vsidx >= 0 && path_ctx->veidx >= 0);
 }
 
-// load the initial edges into the dfs_edge_queue 
-static void load_initial_dfs_queues(path_finding_context *path_ctx)
+// load the initial edges into the dfs_edge_stack 
+static void load_initial_dfs_stacks(path_finding_context *path_ctx)
 {
     if (!do_vsid_and_veid_exist(path_ctx))
         return;
 
     // add in the edges for the start vertex 
-    add_edges(path_ctx, path_ctx->vsid);
+    add_edges(path_ctx, path_ctx->vsidx);
 }
 
 /*
- * build the local VLE context.
+ * build the local VLE context. Without an end vertex, the arguments after the
+ * start vertex move down by one.
  */
-static path_finding_context *build_vle_context(FunctionCallInfo fcinfo, FuncCallContext *funcctx) {
+static path_finding_context *build_vle_context(FunctionCallInfo fcinfo, FuncCallContext *funcctx, bool single_source) {
     MemoryContext oldctx = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
 
     // get the graph name - this is a required argument 
@@ -238,63 +676,65 @@ static path_finding_context *build_vle_context(FunctionCallInfo fcinfo, FuncCall
     // set the global context referenced by this local VLE context 
     path_ctx->ggctx = ggctx;
 
-    // initialize the next vertex, in this case the first 
-    path_ctx->next_vertex = peek_queue_head(get_graph_vertices(ggctx));
-    Assert(path_ctx->next_vertex);
-    
     // start id
     vertex *v = AG_GET_ARG_VERTEX(1);
     path_ctx->vsid = *((int64 *)(&v->children[0]));
 
     // end id - determines which path function is used.
-    v = AG_GET_ARG_VERTEX(2);
-    path_ctx->veid = *((int64 *)(&v->children[0]));
+    path_ctx->single_source = single_source;
+    if (!single_source) {
+        v = AG_GET_ARG_VERTEX(2);
+        path_ctx->veid = *((int64 *)(&v->children[0]));
+    }
+
+    // the index of the lower bound argument 
+    int arg = single_source ? 2 : 3;
     
     // get the left range index 
-    if (PG_ARGISNULL(3) || is_gtype_null(AG_GET_ARG_GTYPE_P(3))) {
+    if (PG_ARGISNULL(arg) || is_gtype_null(AG_GET_ARG_GTYPE_P(arg))) {
         path_ctx->lidx = 1;
     } else {
-        agtv_temp = get_gtype_value("age_vle", AG_GET_ARG_GTYPE_P(3), AGTV_INTEGER, true);
+        agtv_temp = get_gtype_value("age_vle", AG_GET_ARG_GTYPE_P(arg), AGTV_INTEGER, true);
         path_ctx->lidx = agtv_temp->val.int_value;
     }
 
     // get the right range index. NULL means infinite 
-    if (PG_ARGISNULL(4) || is_gtype_null(AG_GET_ARG_GTYPE_P(4))) {
+    if (PG_ARGISNULL(arg + 1) || is_gtype_null(AG_GET_ARG_GTYPE_P(arg + 1))) {
         path_ctx->uidx_infinite = true;
         path_ctx->uidx = -1;
     } else {
-        agtv_temp = get_gtype_value("age_vle", AG_GET_ARG_GTYPE_P(4), AGTV_INTEGER, true);
+        agtv_temp = get_gtype_value("age_vle", AG_GET_ARG_GTYPE_P(arg + 1), AGTV_INTEGER, true);
         path_ctx->uidx = agtv_temp->val.int_value;
         path_ctx->uidx_infinite = false;
     }
     // get edge direction 
-    agtv_temp = get_gtype_value("age_vle", AG_GET_ARG_GTYPE_P(5), AGTV_INTEGER, true);
+    agtv_temp = get_gtype_value("age_vle", AG_GET_ARG_GTYPE_P(arg + 2), AGTV_INTEGER, true);
     path_ctx->edge_direction = agtv_temp->val.int_value;
 
-    // label name
-    if (PG_ARGISNULL(6)  || is_gtype_null(AG_GET_ARG_GTYPE_P(6))) {
-        path_ctx->label_name = NULL;
+    // label name, resolved to the label tables it matches
+    if (PG_ARGISNULL(arg + 3)  || is_gtype_null(AG_GET_ARG_GTYPE_P(arg + 3))) {
+        build_label_filter(&path_ctx->edge_labels, graph_oid, NULL);
     } else {
-	agtv_temp = get_gtype_value("age_vle", AG_GET_ARG_GTYPE_P(6), AGTV_STRING, true);
-        path_ctx->label_name = agtv_temp->val.string.val;
+	agtv_temp = get_gtype_value("age_vle", AG_GET_ARG_GTYPE_P(arg + 3), AGTV_STRING, true);
+        build_label_filter(&path_ctx->edge_labels, graph_oid,
+                           pnstrdup(agtv_temp->val.string.val, agtv_temp->val.string.len));
     }
 
-    if (PG_ARGISNULL(7)  || is_gtype_null(AG_GET_ARG_GTYPE_P(7))) {
-        path_ctx->properties = NULL;
+    if (PG_ARGISNULL(arg + 4)  || is_gtype_null(AG_GET_ARG_GTYPE_P(arg + 4))) {
+        build_property_filter(&path_ctx->properties, NULL);
     } else {
-        path_ctx->properties = AG_GET_ARG_GTYPE_P(7);
-
+        build_property_filter(&path_ctx->properties, AG_GET_ARG_GTYPE_P(arg + 4));
     }
 
-    create_hashtable(path_ctx);
+    path_ctx->visit_marks = acquire_visit_marks(funcctx->multi_call_memory_ctx, get_graph_edge_count(ggctx));
 
-    // initialize the dfs queues 
-    path_ctx->dfs_vertex_queue = new_graphid_queue();
-    path_ctx->dfs_edge_queue = new_graphid_queue();
-    path_ctx->dfs_path_queue = new_graphid_queue();
+    // initialize the dfs stacks 
+    path_ctx->dfs_vertex_stack = new_graphid_stack();
+    path_ctx->dfs_edge_stack = new_graphid_stack();
+    path_ctx->dfs_path_stack = new_graphid_stack();
 
     // load in the starting edge(s) 
-    load_initial_dfs_queues(path_ctx);
+    load_initial_dfs_stacks(path_ctx);
 
     path_ctx->next = NULL;
 
@@ -304,60 +744,41 @@ static path_finding_context *build_vle_context(FunctionCallInfo fcinfo, FuncCall
 }
 
 /*
- * Helper function to get the specified edge's state. If it does not find it, it
- * creates and initializes it.
- */
-static edge_state_entry *get_edge_state(path_finding_context *path_ctx, graphid edge_id) {
-    edge_state_entry *ese = NULL;
-    bool found = false;
-
-    // retrieve the edge_state_entry from the edge state hashtable 
-    ese = (edge_state_entry *)hash_search(path_ctx->edge_state_hashtable, (void *)&edge_id, HASH_ENTER, &found);
-
-    // if it isn't found, it needs to be created and initialized 
-    if (!found) {
-        // the edge id is also the hash key for resolving collisions 
-        ese->edge_id = edge_id;
-        ese->visited = false;
-    }
-    return ese;
-}
-
-/*
- * Helper function to get the id of the next vertex to move to. This is to
+ * Helper function to get the index of the next vertex to move to. This is to
  * simplify finding the next vertex due to the VLE edge's direction.
  */
-static graphid get_next_vertex(path_finding_context *path_ctx, edge_entry *ee)
+static int64 get_next_vertex(path_finding_context *path_ctx, int64 edge_index)
 {
-    graphid id;
+    graph_context *ggctx = path_ctx->ggctx;
+    int64 index;
 
     // get the result based on the specified VLE edge direction 
     switch (path_ctx->edge_direction) {
         case CYPHER_REL_DIR_RIGHT:
-            id = get_end_id(ee);
+            index = get_edge_end_index(ggctx, edge_index);
             break;
 
         case CYPHER_REL_DIR_LEFT:
-            id = get_start_id(ee);
+            index = get_edge_start_index(ggctx, edge_index);
             break;
 
         case CYPHER_REL_DIR_NONE:
         {
-            Queue *vertex_queue = NULL;
-            graphid parent_vertex_id;
+            graphid_stack *vertex_stack = NULL;
+            int64 parent_vertex_index;
 
-            vertex_queue = path_ctx->dfs_vertex_queue;
+            vertex_stack = path_ctx->dfs_vertex_stack;
             /*
              * Get the parent vertex of this edge. When we are looking at edges
              * as bi-directional, where we go to next depends on where we came
              * from. This is because we can go against an edge.
              */
-            parent_vertex_id = PEEK_GRAPHID_STACK(vertex_queue);
+            parent_vertex_index = PEEK_GRAPHID_STACK(vertex_stack);
             // find the terminal vertex 
-            if (get_start_id(ee) == parent_vertex_id)
-                id = get_end_id(ee);
-            else if (get_end_id(ee) == parent_vertex_id)
-                id = get_start_id(ee);
+            if (get_edge_start_index(ggctx, edge_index) == parent_vertex_index)
+                index = get_edge_end_index(ggctx, edge_index);
+            else if (get_edge_end_index(ggctx, edge_index) == parent_vertex_index)
+                index = get_edge_start_index(ggctx, edge_index);
             else
                 elog(ERROR, "get_next_vertex: no parent match");
 
@@ -368,7 +789,7 @@ static graphid get_next_vertex(path_finding_context *path_ctx, edge_entry *ee)
             elog(ERROR, "get_next_vertex: unknown edge direction");
     }
 
-    return id;
+    return index;
 }
 
 /*
@@ -376,95 +797,94 @@ static graphid get_next_vertex(path_finding_context *path_ctx, edge_entry *ee)
  *
  * This function will always return on either a valid path found (true) or none
  * found (false). If one is found, the position (vertex & edge) will still be in
- * the queue. Each successive invocation within the SRF will then look for the
+ * the stack. Each successive invocation within the SRF will then look for the
  * next available path until there aren't any left.
  */
 static bool dfs_find_a_path_between(path_finding_context *path_ctx)
 {
     Assert(path_ctx);
 
-    Queue *vertex_queue = path_ctx->dfs_vertex_queue;
-    Queue *edge_queue = path_ctx->dfs_edge_queue;
-    Queue *path_queue = path_ctx->dfs_path_queue;
-    graphid end_vertex_id = path_ctx->veid;
+    graphid_stack *vertex_stack = path_ctx->dfs_vertex_stack;
+    graphid_stack *edge_stack = path_ctx->dfs_edge_stack;
+    graphid_stack *path_stack = path_ctx->dfs_path_stack;
+    int64 end_vertex_index = path_ctx->veidx;
 
     // while we have edges to process 
-    while (!IS_GRAPHID_STACK_EMPTY(edge_queue)) {
-        graphid edge_id;
-        graphid next_vertex_id;
-        edge_state_entry *ese = NULL;
-        edge_entry *ee = NULL;
+    while (!IS_GRAPHID_STACK_EMPTY(edge_stack)) {
+        int64 edge_index;
+        int64 next_vertex_index;
         bool found = false;
 
-        // get an edge, but leave it on the queue for now 
-        edge_id = PEEK_GRAPHID_STACK(edge_queue);
-        // get the edge's state 
-        ese = get_edge_state(path_ctx, edge_id);
+        // get an edge, but leave it on the stack for now 
+        edge_index = PEEK_GRAPHID_STACK(edge_stack);
         /*
          * If the edge is already in use, it means that the edge is in the path.
          * So, we need to see if it is the last path entry (we are backing up -
-         * we need to remove the edge from the path queue and reset its state
-         * and from the edge queue as we are done with it) or an interior edge
-         * in the path (loop - we need to remove the edge from the edge queue
+         * we need to remove the edge from the path stack and reset its state
+         * and from the edge stack as we are done with it) or an interior edge
+         * in the path (loop - we need to remove the edge from the edge stack
          * and start with the next edge).
          */
-        if (ese->visited) {
-            graphid path_edge_id;
+        if (is_edge_visited(path_ctx, edge_index)) {
+            int64 path_edge_index;
 
-            // get the edge id on the top of the path queue (last edge) 
-            path_edge_id = PEEK_GRAPHID_STACK(path_queue);
+            // get the edge index on the top of the path stack (last edge) 
+            path_edge_index = PEEK_GRAPHID_STACK(path_stack);
             
-            // If the ids are the same, we're backing up. So, remove it from the path queue and reset visited.
-            if (edge_id == path_edge_id) {
-                pop_graphid_queue(path_queue);
-                ese->visited = false;
+            // If the indexes are the same, we're backing up. So, remove it from the path stack and reset visited.
+            if (edge_index == path_edge_index) {
+                pop_graphid_stack(path_stack);
+                set_edge_visited(path_ctx, edge_index, false);
             }
-            // now remove it from the edge queue 
-            pop_graphid_queue(edge_queue);
+            // now remove it from the edge stack 
+            pop_graphid_stack(edge_stack);
 
 	        /*
              * Remove its source vertex, if we are looking at edges as
-             * bi-directional. We only maintain the vertex queue when the
+             * bi-directional. We only maintain the vertex stack when the
              * edge_direction is CYPHER_REL_DIR_NONE. This is to save space
              * and time.
              */
             if (path_ctx->edge_direction == CYPHER_REL_DIR_NONE)
-                pop_graphid_queue(vertex_queue);
+                pop_graphid_stack(vertex_stack);
 
 	    // move to the next edge 
             continue;
         }
 
         /*
-         * Mark it and push it on the path queue. There is no need to push it on
-         * the edge queue as it is already there.
+         * Mark it and push it on the path stack. There is no need to push it on
+         * the edge stack as it is already there.
          */
-        ese->visited = true;
-        push_graphid_queue(path_queue, edge_id);
+        set_edge_visited(path_ctx, edge_index, true);
+        push_graphid_stack(path_stack, edge_index);
 
-        // now get the edge entry so we can get the next vertex to move to 
-        ee = get_edge_entry(path_ctx->ggctx, edge_id);
-        next_vertex_id = get_next_vertex(path_ctx, ee);
+        // now get the next vertex to move to 
+        next_vertex_index = get_next_vertex(path_ctx, edge_index);
 
         /*
          * Is this the end of a path that meets our requirements? Is its length
-         * within the bounds specified?
+         * within the bounds specified? Without an end vertex, every vertex
+         * reached ends a path.
          */
-        if (next_vertex_id == end_vertex_id && queue_size(path_queue) >= path_ctx->lidx &&
-            (path_ctx->uidx_infinite || queue_size(path_queue) <= path_ctx->uidx))
+        if ((path_ctx->single_source || next_vertex_index == end_vertex_index) &&
+            graphid_stack_size(path_stack) >= path_ctx->lidx &&
+            (path_ctx->uidx_infinite || graphid_stack_size(path_stack) <= path_ctx->uidx)) {
+            path_ctx->last_vertex_index = next_vertex_index;
             found = true;
+        }
         
 	/*
          * If we have found the end vertex but, we are not within our upper
          * bounds, we need to back up. We still need to continue traversing
          * the graph if we aren't within our lower bounds, though.
          */
-        if (next_vertex_id == end_vertex_id && !path_ctx->uidx_infinite && queue_size(path_queue) > path_ctx->uidx)
+        if (next_vertex_index == end_vertex_index && !path_ctx->uidx_infinite && graphid_stack_size(path_stack) > path_ctx->uidx)
             continue;
 
         // add in the edges for the next vertex if we won't exceed the bounds 
-        if (path_ctx->uidx_infinite || queue_size(path_queue) < path_ctx->uidx)
-            add_edges(path_ctx, next_vertex_id);
+        if (path_ctx->uidx_infinite || graphid_stack_size(path_stack) < path_ctx->uidx)
+            add_edges(path_ctx, next_vertex_index);
 
         if (found)
             return true;
@@ -475,74 +895,46 @@ static bool dfs_find_a_path_between(path_finding_context *path_ctx)
 
 
 // add in valid vertex edges as part of the dfs path algorithm.
-static void add_edges(path_finding_context *path_ctx, graphid vertex_id) {
-    Queue *edges = NULL;
-
-    // get the vertex entry 
-    vertex_entry *ve = get_vertex_entry(path_ctx->ggctx, vertex_id);
-    Assert(ve);
-
-    Queue *vertex_queue = path_ctx->dfs_vertex_queue;
-    Queue *edge_queue = path_ctx->dfs_edge_queue;
-
-    // set to the first edge for each edge list for the specified direction 
-    QueueNode *edge_out = NULL;
-    if (path_ctx->edge_direction != CYPHER_REL_DIR_LEFT) {
-        edges = get_vertex_entry_edges_out(ve);
-        edge_out = (edges != NULL) ? get_list_head(edges) : NULL;
-    }
-
-    QueueNode *edge_in = NULL;
-    if (path_ctx->edge_direction != CYPHER_REL_DIR_RIGHT) {
-        edges = get_vertex_entry_edges_in(ve);
-        edge_in = (edges != NULL) ? get_list_head(edges) : NULL;
-    }
-
-    // set to the first selfloop edge 
-    edges = get_vertex_entry_edges_self(ve);
-    QueueNode *edge_self = (edges != NULL) ? get_list_head(edges) : NULL;
+static void add_edges(path_finding_context *path_ctx, int64 vertex_index) {
+    graph_context *ggctx = path_ctx->ggctx;
+    vertex_adjacency adj;
+    int64 start[3];
+    int64 end[3];
+
+    graphid_stack *vertex_stack = path_ctx->dfs_vertex_stack;
+    graphid_stack *edge_stack = path_ctx->dfs_edge_stack;
+
+    // get the adjacency entries of the vertex 
+    get_vertex_adjacency(ggctx, vertex_index, &adj);
+
+    // the runs of exiting, entering and selfloop edges 
+    start[0] = 0;
+    end[0] = (path_ctx->edge_direction != CYPHER_REL_DIR_LEFT) ? adj.out_cnt : 0;
+    start[1] = adj.out_cnt;
+    end[1] = (path_ctx->edge_direction != CYPHER_REL_DIR_RIGHT) ? adj.out_cnt + adj.in_cnt : adj.out_cnt;
+    start[2] = adj.out_cnt + adj.in_cnt;
+    end[2] = adj.out_cnt + adj.in_cnt + adj.loop_cnt;
 
     // add in valid vertex edges 
-    while (edge_out || edge_in || edge_self) {
-        graphid edge_id;
-
-        // get the edge_id from the next available edge
-        if (edge_out)
-            edge_id = get_graphid(edge_out);
-        else if (edge_in)
-            edge_id = get_graphid(edge_in);
-        else
-            edge_id = get_graphid(edge_self);
-
-        // get the edge entry 
-        edge_entry *ee = get_edge_entry(path_ctx->ggctx, edge_id);
-        Assert(ee);
-            
-        // get its state 
-        edge_state_entry *ese = get_edge_state(path_ctx, edge_id);
-
-        // Don't add any edges that we have already seen because they will cause a loop to form.
-        if (!ese->visited && check_edge_constraints(path_ctx, ee)) {
-            /*
-             * We need to maintain our source vertex for each edge added
-             * if the edge_direction is CYPHER_REL_DIR_NONE. This is due
-             * to the edges having a fixed direction and the dfs
-             * algorithm working strictly through edges. With an
-             * un-directional edge, you don't know the vertex that
-             * you just came from. So, we need to store it.
-             */
-            if (path_ctx->edge_direction == CYPHER_REL_DIR_NONE)
-                push_graphid_queue(vertex_queue, get_vertex_entry_id(ve));
-            push_graphid_queue(edge_queue, edge_id);
+    for (int list = 0; list < 3; list++) {
+        for (int64 i = start[list]; i < end[list]; i++) {
+            int64 edge_index = adj.edges[i];
+
+            // Don't add any edges that we have already seen because they will cause a loop to form.
+            if (!is_edge_visited(path_ctx, edge_index) && check_edge_constraints(ggctx, edge_index, adj.labels[i], &path_ctx->edge_labels, &path_ctx->properties)) {
+                /*
+                 * We need to maintain our source vertex for each edge added
+                 * if the edge_direction is CYPHER_REL_DIR_NONE. This is due
+                 * to the edges having a fixed direction and the dfs
+                 * algorithm working strictly through edges. With an
+                 * un-directional edge, you don't know the vertex that
+                 * you just came from. So, we need to store it.
+                 */
+                if (path_ctx->edge_direction == CYPHER_REL_DIR_NONE)
+                    push_graphid_stack(vertex_stack, vertex_index);
+                push_graphid_stack(edge_stack, edge_index);
+            }
         }
-
-        // get the next edge
-        if (edge_out)
-            edge_out = next_queue_node(edge_out);
-        else if (edge_in)
-            edge_in = next_queue_node(edge_in);
-        else
-            edge_self = next_queue_node(edge_self);
     }
 }
 
@@ -574,7 +966,7 @@ static path_container *create_path_container(int64 path_size)
 
 /*
  * Helper function to build a path_container containing the graphid array
- * from the path_queue. The graphid array will be a complete path (vertices and
+ * from the path_stack. The graphid array will be a complete path (vertices and
  * edges interleaved) -
  *
  *     start vertex, first edge,... nth edge, end vertex
@@ -594,15 +986,14 @@ static path_container *create_path_container(int64 path_size)
  *     The total size of the container for copying.
  */
 static path_container *build_path_container(path_finding_context *path_ctx) {
-    Queue *queue = path_ctx->dfs_path_queue;
+    graphid_stack *stack = path_ctx->dfs_path_stack;
     graphid *graphid_array = NULL;
-    QueueNode *edge = NULL;
     graphid vid = 0;
 
-    if (!queue)
+    if (!stack)
         return NULL;
 
-    int ssize = queue_size(queue);
+    int ssize = graphid_stack_size(stack);
 
     /*
      * Create the container. Note that the path size will always be 2 times the
@@ -620,35 +1011,23 @@ static path_container *build_path_container(path_finding_context *path_ctx) {
     vid = path_ctx->vsid;
     graphid_array[0] = vid;
 
-    // get the head of the queue 
-    edge = peek_queue_head(queue);
-
-    /*
-     * We need to fill in the array from the back to the front. This is due
-     * to the order of the path queue - last in first out.
-     */
-    int index = vpc->graphid_array_size - 2;
-
-    // copy while we have an edge to copy 
-    while (edge) {
-        // 0 is the vsid, we should never get here 
-        Assert(index > 0);
-
-        // store and set to the next edge 
-        graphid_array[index] = get_graphid(edge);
-        edge = next_queue_node(edge);
-
-        // we need to skip over the interior vertices 
-        index -= 2;
-    }
+    // the bottom of the path stack is the first edge, store the edge ids 
+    for (int i = 0; i < ssize; i++)
+        graphid_array[(i * 2) + 1] = get_edge_id(path_ctx->ggctx, stack->ids[i]);
 
     // now add in the interior vertices, starting from the first edge 
-    for (index = 1; index < vpc->graphid_array_size - 1; index += 2) {
-        edge_entry *ee = get_edge_entry(path_ctx->ggctx, graphid_array[index]);
+    for (int index = 1; index < vpc->graphid_array_size - 1; index += 2) {
+        int64 edge_index = get_edge_index(path_ctx->ggctx, graphid_array[index]);
         
-	    graphid_array[index+1] = (vid == get_start_id(ee)) ? get_end_id(ee) : get_start_id(ee);
+	    graphid_array[index+1] = (vid == get_start_id(path_ctx->ggctx, edge_index)) ? get_end_id(path_ctx->ggctx, edge_index) : get_start_id(path_ctx->ggctx, edge_index);
     }
 
+    // and the end vertex 
+    if (path_ctx->single_source)
+        graphid_array[vpc->graphid_array_size - 1] = get_vertex_id(path_ctx->ggctx, path_ctx->last_vertex_index);
+    else
+        graphid_array[vpc->graphid_array_size - 1] = path_ctx->veid;
+
     // return the container 
     return vpc;
 }
@@ -665,6 +1044,7 @@ static path_container *build_path_container(path_finding_context *path_ctx) {
 PG_FUNCTION_INFO_V1(gtype_vle);
 Datum gtype_vle(PG_FUNCTION_ARGS) {
     FuncCallContext *funcctx;
+    path_finding_context *path_ctx;
     bool found_a_path;
     MemoryContext oldctx;
 
@@ -677,7 +1057,7 @@ Datum gtype_vle(PG_FUNCTION_ARGS) {
 
         funcctx = SRF_FIRSTCALL_INIT();
 
-        funcctx->user_fctx = build_vle_context(fcinfo, funcctx);
+        funcctx->user_fctx = start_vle_call(fcinfo, funcctx, false);
 
         //if (((path_finding_context *)funcctx->user_fctx)->lidx == 0)
           //  SRF_RETURN_NEXT(funcctx, PointerGetDatum(build_path_container(funcctx->user_fctx)));
@@ -687,6 +1067,18 @@ Datum gtype_vle(PG_FUNCTION_ARGS) {
 
     // stuff done on every call of the function 
     funcctx = SRF_PERCALL_SETUP();
+    path_ctx = funcctx->user_fctx;
+
+    // return the memoized rows, if the search was done before 
+    if (path_ctx->memo_entry != NULL) {
+        ListCell *lc = path_ctx->memo_next;
+
+        if (lc == NULL)
+            SRF_RETURN_DONE(funcctx);
+
+        path_ctx->memo_next = lnext(path_ctx->memo_entry->results, lc);
+        SRF_RETURN_NEXT(funcctx, PointerGetDatum(lfirst(lc)));
+    }
 
     /*
      * All work done in dfs_find_a_path needs to be done in a context that
@@ -694,140 +1086,274 @@ Datum gtype_vle(PG_FUNCTION_ARGS) {
      */
     oldctx = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
 
-    found_a_path = dfs_find_a_path_between(funcctx->user_fctx);
+    found_a_path = dfs_find_a_path_between(path_ctx);
 
     // switch back to a more volatile context 
     MemoryContextSwitchTo(oldctx);
 
     /*
-     * If we find a path, we need to convert the path_queue into a list that
+     * If we find a path, we need to convert the path_stack into a list that
      * the outside world can use.
      */
     if (found_a_path) {
-        path_container *vpc = build_path_container(funcctx->user_fctx);
+        path_container *vpc = build_path_container(path_ctx);
+        Datum result;
         
-	Assert(((path_finding_context *)funcctx->user_fctx)->dfs_path_queue > 0);
+	Assert(path_ctx->dfs_path_stack != NULL);
+
+        result = PointerGetDatum(create_variable_edge(vpc));
+        record_vle_result(path_ctx, funcctx->multi_call_memory_ctx, result);
 
         // return the result and signal that the function is not yet done 
-        SRF_RETURN_NEXT(funcctx, PointerGetDatum(create_variable_edge(vpc)));
+        SRF_RETURN_NEXT(funcctx, result);
     } else {
-	hash_destroy(((path_finding_context *)funcctx->user_fctx)->edge_state_hashtable);
-        hash_destroy(((path_finding_context *)funcctx->user_fctx)->exists_hash);
+        finish_vle_memo_entry(path_ctx);
+        SRF_RETURN_DONE(funcctx);
+    }
+}
+
+/*
+ * The VLE without an end vertex. One traversal from the start vertex returns
+ * every vertex reached within the bounds along with the path to it, rather
+ * than running a traversal for each possible end vertex.
+ *
+ *     0 - gtype REQUIRED (graph name as string)
+ *     1 - vertex REQUIRED (start vertex)
+ *     2 - gtype OPTIONAL lidx (lower range index)
+ *     3 - gtype OPTIONAL uidx (upper range index)
+ *     4 - gtype REQUIRED edge direction (enum) as an integer
+ *     5 - gtype OPTIONAL edge label
+ *     6 - gtype OPTIONAL edge properties
+ *
+ * Returns the id and properties of the end vertex and the path's edges.
+ */
+PG_FUNCTION_INFO_V1(gtype_vle_single_source);
+Datum gtype_vle_single_source(PG_FUNCTION_ARGS) {
+    FuncCallContext *funcctx;
+    path_finding_context *path_ctx;
+    bool found_a_path;
+    MemoryContext oldctx;
+
+    if (SRF_IS_FIRSTCALL()) {
+        TupleDesc tupdesc;
+
+        if (PG_ARGISNULL(0) || PG_ARGISNULL(1) || PG_ARGISNULL(4))
+             ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("age_vle: invalid NULL argument passed")));
+
+        funcctx = SRF_FIRSTCALL_INIT();
+
+        oldctx = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+            ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                            errmsg("vle_single_source: return type must be a row type")));
+
+        funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+
+        MemoryContextSwitchTo(oldctx);
+
+        funcctx->user_fctx = start_vle_call(fcinfo, funcctx, true);
+    }
+
+    funcctx = SRF_PERCALL_SETUP();
+    path_ctx = funcctx->user_fctx;
+
+    // return the memoized rows, if the search was done before 
+    if (path_ctx->memo_entry != NULL) {
+        ListCell *lc = path_ctx->memo_next;
+
+        if (lc == NULL)
+            SRF_RETURN_DONE(funcctx);
+
+        path_ctx->memo_next = lnext(path_ctx->memo_entry->results, lc);
+        SRF_RETURN_NEXT(funcctx, PointerGetDatum(lfirst(lc)));
+    }
+
+    oldctx = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+    found_a_path = dfs_find_a_path_between(path_ctx);
+
+    MemoryContextSwitchTo(oldctx);
+
+    if (found_a_path) {
+        graph_context *ggctx = path_ctx->ggctx;
+        path_container *vpc = build_path_container(path_ctx);
+        Datum values[3];
+        bool nulls[3] = {false, false, false};
+        HeapTuple tuple;
+
+        values[0] = GRAPHID_GET_DATUM(get_vertex_id(ggctx, path_ctx->last_vertex_index));
+        values[1] = get_vertex_properties(ggctx, path_ctx->last_vertex_index);
+        values[2] = PointerGetDatum(create_variable_edge(vpc));
+
+        tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+        record_vle_result(path_ctx, funcctx->multi_call_memory_ctx, HeapTupleGetDatum(tuple));
+
+        SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+    } else {
+        finish_vle_memo_entry(path_ctx);
         SRF_RETURN_DONE(funcctx);
     }
 }
 
 VariableEdge *create_variable_edge(path_container *vpc) {
-    StringInfoData buffer;
-    initStringInfo(&buffer);
-    int32 size;
+    return create_compact_variable_edge(vpc->graph_oid, GET_GRAPHID_ARRAY_FROM_CONTAINER(vpc), vpc->graphid_array_size);
+}
+
+/*
+ * The kinds of the arguments of _ag_enforce_edge_uniqueness, found once per
+ * call site, so a row doesn't look the types up again.
+ */
+typedef struct edge_uniqueness_args
+{
+    int nargs;
+    char kinds[FLEXIBLE_ARRAY_MEMBER]; // EDGE_ID_ARG... of each argument 
+} edge_uniqueness_args;
 
-    graphid *graphid_array = GET_GRAPHID_ARRAY_FROM_CONTAINER(vpc);
-    int graphid_array_size = vpc->graphid_array_size;
+// buffer for the edge ids of rows with many edges, kept between rows 
+static graphid *edge_id_buffer = NULL;
+static int edge_id_buffer_size = 0;
 
-    graph_context *ggctx = find_graph_context(vpc->graph_oid);
+static void add_edge_id(graphid **ids, int *cnt, int *capacity, graphid id);
+static bool are_edge_ids_unique(graphid *ids, int cnt);
+static int graphid_cmp(const void *a, const void *b);
 
-    Assert(ggctx != NULL);
+static int graphid_cmp(const void *a, const void *b) {
+    graphid lhs = *(const graphid *)a;
+    graphid rhs = *(const graphid *)b;
 
-    // header
-    reserve_from_buffer(&buffer, VARHDRSZ);
-    size = graphid_array_size - 2;
-    append_to_buffer(&buffer, (char *)&size, sizeof(prentry));
+    return (lhs > rhs) - (lhs < rhs);
+}
 
-    int cnt = 0;
-    for (int index = 0; index < graphid_array_size; index += 2) {
-        // get the vertex entry from the hashtable
-        if (index != 0 && index + 1 != graphid_array_size) {
-            vertex_entry *ve = get_vertex_entry(ggctx, graphid_array[index]);
-
-	    //char *label_name = get_rel_name(get_vertex_entry_label_table_oid(ve));
-	    graphid id = get_vertex_entry_id(ve);
-	    gtype *prop = DATUM_GET_GTYPE_P(get_vertex_entry_properties(ve));
-            Datum d = VERTEX_GET_DATUM(create_vertex(id, vpc->graph_oid, prop));
-
-            append_to_buffer(&buffer, DATUM_GET_VERTEX(d), VARSIZE(d));
-            cnt++;
+// add an edge id, moving to the kept buffer once the ids don't fit
+static void add_edge_id(graphid **ids, int *cnt, int *capacity, graphid id) {
+    if (*cnt == *capacity) {
+        int size = *capacity * 2;
+
+        if (edge_id_buffer_size < size) {
+            if (edge_id_buffer == NULL)
+                edge_id_buffer = MemoryContextAlloc(TopMemoryContext, sizeof(graphid) * size);
+            else if (*ids == edge_id_buffer)
+                edge_id_buffer = repalloc(edge_id_buffer, sizeof(graphid) * size);
+            else {
+                pfree(edge_id_buffer);
+                edge_id_buffer = MemoryContextAlloc(TopMemoryContext, sizeof(graphid) * size);
+            }
+
+            edge_id_buffer_size = size;
         }
-        if (index + 1 == graphid_array_size)
-                break;
 
-        // get the edge entry from the hashtable 
-        edge_entry *ee = get_edge_entry(ggctx, graphid_array[index+1]);
-        
-        char *label_name = get_rel_name(get_edge_entry_label_table_oid(ee));
-        graphid id = get_vertex_entry_id(ee);
-        graphid startid = get_start_id(ee);
-        graphid endid = get_end_id(ee);
-        gtype *prop = DATUM_GET_GTYPE_P(get_edge_entry_properties(ee));
-        Datum d = EDGE_GET_DATUM(create_edge(id, startid, endid, vpc->graph_oid, prop));
+        if (*ids != edge_id_buffer)
+            memcpy(edge_id_buffer, *ids, sizeof(graphid) * *cnt);
+
+        *ids = edge_id_buffer;
+        *capacity = edge_id_buffer_size;
+    }
+
+    (*ids)[(*cnt)++] = id;
+}
+
+/*
+ * A few ids are compared pairwise, which for the handful of edges in most
+ * patterns is cheaper than anything else. More are sorted.
+ */
+static bool are_edge_ids_unique(graphid *ids, int cnt) {
+    if (cnt <= SMALL_EDGE_ID_COUNT) {
+        for (int i = 1; i < cnt; i++) {
+            for (int j = 0; j < i; j++) {
+                if (ids[i] == ids[j])
+                    return false;
+            }
+        }
 
-        append_to_buffer(&buffer, DATUM_GET_EDGE(d), VARSIZE(d));
-        cnt++;
+        return true;
     }
 
-    VariableEdge *p = (VariableEdge *)buffer.data;
+    qsort(ids, cnt, sizeof(graphid), graphid_cmp);
 
-    SET_VARSIZE(p, buffer.len);
+    for (int i = 1; i < cnt; i++) {
+        if (ids[i] == ids[i - 1])
+            return false;
+    }
 
-    return p;
+    return true;
 }
 
-// function checks the edges in a MATCH clause to see if they are unique or not.
+/*
+ * function checks the edges in a MATCH clause to see if they are unique or
+ * not. It is run for every row, so it allocates nothing for the common case of
+ * a few edges.
+ */
 PG_FUNCTION_INFO_V1(_ag_enforce_edge_uniqueness);
 Datum _ag_enforce_edge_uniqueness(PG_FUNCTION_ARGS) {
+    edge_uniqueness_args *arg_kinds = fcinfo->flinfo->fn_extra;
+    graphid small_ids[SMALL_EDGE_ID_COUNT];
+    graphid *ids = small_ids;
+    int cnt = 0;
+    int capacity = SMALL_EDGE_ID_COUNT;
     Datum *args;
     bool *nulls;
     Oid *types;
+    int nargs;
 
-    int nargs = extract_variadic_args(fcinfo, 0, true, &args, &types, &nulls);
-
-    // configure the hash table 
-    HASHCTL exists_ctl;
-    MemSet(&exists_ctl, 0, sizeof(exists_ctl));
-    exists_ctl.keysize = sizeof(int64);
-    exists_ctl.entrysize = sizeof(int64);
-    exists_ctl.hash = tag_hash;
+    // the arguments passed as a VARIADIC array are the rare case 
+    if (get_fn_expr_variadic(fcinfo->flinfo)) {
+        nargs = extract_variadic_args(fcinfo, 0, true, &args, &types, &nulls);
+        arg_kinds = NULL;
+    } else {
+        nargs = PG_NARGS();
+        types = NULL;
+
+        if (arg_kinds == NULL) {
+            arg_kinds = MemoryContextAlloc(fcinfo->flinfo->fn_mcxt, offsetof(edge_uniqueness_args, kinds) + Max(nargs, 1));
+            arg_kinds->nargs = nargs;
+
+            for (int i = 0; i < nargs; i++) {
+                Oid type = get_fn_expr_argtype(fcinfo->flinfo, i);
+
+                if (type == GRAPHIDOID)
+                    arg_kinds->kinds[i] = EDGE_ID_ARG_GRAPHID;
+                else if (type == VARIABLEEDGEOID)
+                    arg_kinds->kinds[i] = EDGE_ID_ARG_VARIABLE_EDGE;
+                else
+                    arg_kinds->kinds[i] = EDGE_ID_ARG_OTHER;
+            }
 
-    HTAB *exists_hash = hash_create(EXISTS_HTAB_NAME, nargs, &exists_ctl, HASH_ELEM | HASH_FUNCTION);
+            fcinfo->flinfo->fn_extra = arg_kinds;
+        }
+    }
 
-    // insert arguments into hash table 
     for (int i = 0; i < nargs; i++) {
+        char kind;
+        Datum arg;
+
+        if (arg_kinds == NULL) {
+            if (nulls[i])
+                continue;
+
+            arg = args[i];
+            kind = (types[i] == GRAPHIDOID) ? EDGE_ID_ARG_GRAPHID :
+                   (types[i] == VARIABLEEDGEOID) ? EDGE_ID_ARG_VARIABLE_EDGE : EDGE_ID_ARG_OTHER;
+        } else {
+            if (PG_ARGISNULL(i))
+                continue;
+
+            arg = PG_GETARG_DATUM(i);
+            kind = arg_kinds->kinds[i];
+        }
 
-        if (nulls[i])
-            continue;
-
-        if (types[i] == GRAPHIDOID) {
-            graphid edge_id = DatumGetInt64(args[i]);
-
-	    bool found;
-            int64 *value = (int64 *)hash_search(exists_hash, (void *)&edge_id, HASH_ENTER, &found);
-
-            // if we found it, we're done, we have a duplicate 
-            if (found)
-                PG_RETURN_BOOL(false);
-
-            *value = edge_id;
+        if (kind == EDGE_ID_ARG_GRAPHID) {
+            add_edge_id(&ids, &cnt, &capacity, DATUM_GET_GRAPHID(arg));
+        } else if (kind == EDGE_ID_ARG_VARIABLE_EDGE) {
+            VariableEdge *ve = DATUM_GET_VARIABLE_EDGE(arg);
+            graphid *ve_ids = extract_variable_edge_ids(ve);
 
-            continue;
+            // the edges are at the even positions
+            for (int j = 0; j < VARIABLE_EDGE_SIZE(ve); j += 2)
+                add_edge_id(&ids, &cnt, &capacity, ve_ids[j]);
         }
-	    else if (types[i] == VARIABLEEDGEOID) {
-            VariableEdge *ve = DATUM_GET_VARIABLE_EDGE(args[i]);
-            char *ptr = &ve->children[1];
-            for (int i = 0; i < ve->children[0]; i++, ptr = ptr + VARSIZE(ptr)) {
-                if (i % 2 == 1) {
-                    continue;
-                } else {
-	            edge *e = (edge *)ptr;
-
-                    graphid i =  *((int64 *)(&e->children[0]));
-	            bool found;
-                    (int64 *)hash_search(exists_hash, (void *)&i, HASH_ENTER, &found);
-                    if (found)
-                        PG_RETURN_BOOL(false);
-	            }
-            }
-	   }
     }
 
-    PG_RETURN_BOOL(true);
+    PG_RETURN_BOOL(are_edge_ids_unique(ids, cnt));
 }
@@ -0,0 +1,379 @@
+/*
+ * Copyright (C) 2023 PostGraphDB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "postgres.h"
+
+#include <math.h>
+
+#include "funcapi.h"
+#include "lib/pairingheap.h"
+#include "utils/float.h"
+#include "utils/memutils.h"
+
+#include "catalog/ag_graph.h"
+#include "utils/graphid.h"
+#include "utils/path_finding.h"
+#include "utils/vertex.h"
+
+// defines
+#define HEAP_NODE_CHUNK_SIZE 1024
+
+/*
+ * A* heuristic, the estimated cost from a vertex to the end vertex. It must
+ * never be more than the actual cost, or the path found may not be the
+ * cheapest. It need not be consistent, a vertex reached at a lower cost after
+ * it was expanded is expanded again. Without a heuristic the search is plain
+ * Dijkstra.
+ */
+typedef float8 (*path_heuristic)(void *arg, int64 vertex_index);
+
+// entry of the priority queue, a vertex and the cost it was reached at
+typedef struct heap_node
+{
+    pairingheap_node ph_node;
+    float8 priority;               // cost so far plus the heuristic
+    float8 distance;               // cost so far
+    int64 vertex_index;
+} heap_node;
+
+/*
+ * The coordinates heuristic, the straight line distance between the numeric
+ * vertex properties named, such as ['x', 'y'].
+ */
+typedef struct coordinates_heuristic
+{
+    graph_context *ggctx;
+    char **properties;             // names of the coordinate properties
+    int property_cnt;
+    float8 *target;                // coordinates of the end vertex
+    bool has_target;
+} coordinates_heuristic;
+
+typedef struct weighted_path_context
+{
+    graph_context *ggctx;          // global graph context
+    Oid graph_oid;                 // graph oid for building the path
+    int64 vsidx;                   // starting vertex index
+    int64 veidx;                   // ending vertex index
+    char *weight_property;         // edge property holding the weight
+    const float8 *weights;         // weights of the image's edges
+    path_heuristic heuristic;      // NULL for plain Dijkstra
+    void *heuristic_arg;
+    // per query distance map, indexed by vertex index
+    float8 *distances;
+    int64 *parent_edges;
+    // the priority queue
+    pairingheap *heap;
+    heap_node *nodes;
+    int nodes_used;
+} weighted_path_context;
+
+static int compare_heap_nodes(const pairingheap_node *a, const pairingheap_node *b, void *arg);
+static void push_vertex(weighted_path_context *wp_ctx, int64 vertex_index, float8 distance);
+static bool get_vertex_coordinates(coordinates_heuristic *ch, int64 vertex_index, float8 *coordinates);
+static float8 coordinates_distance(void *arg, int64 vertex_index);
+static void *build_coordinates_heuristic(graph_context *ggctx, gtype *agt, int64 veidx);
+static bool find_weighted_path(weighted_path_context *wp_ctx);
+static VariableEdge *build_weighted_path(weighted_path_context *wp_ctx);
+
+// the pairing heap keeps the largest on top, so the order is reversed
+static int compare_heap_nodes(const pairingheap_node *a, const pairingheap_node *b, void *arg) {
+    const heap_node *na = pairingheap_const_container(heap_node, ph_node, a);
+    const heap_node *nb = pairingheap_const_container(heap_node, ph_node, b);
+
+    if (na->priority < nb->priority)
+        return 1;
+    if (na->priority > nb->priority)
+        return -1;
+    return 0;
+}
+
+/*
+ * Add a vertex to the priority queue. The pairing heap can't lower the
+ * priority of an entry, so a vertex reached at a lower cost is added again
+ * and the entries left behind, with a higher cost than the vertex's, are
+ * skipped when they come out.
+ */
+static void push_vertex(weighted_path_context *wp_ctx, int64 vertex_index, float8 distance) {
+    heap_node *node;
+
+    if (wp_ctx->nodes == NULL || wp_ctx->nodes_used == HEAP_NODE_CHUNK_SIZE) {
+        wp_ctx->nodes = palloc(sizeof(heap_node) * HEAP_NODE_CHUNK_SIZE);
+        wp_ctx->nodes_used = 0;
+    }
+
+    node = &wp_ctx->nodes[wp_ctx->nodes_used++];
+    node->vertex_index = vertex_index;
+    node->distance = distance;
+    node->priority = distance;
+
+    if (wp_ctx->heuristic != NULL)
+        node->priority += wp_ctx->heuristic(wp_ctx->heuristic_arg, vertex_index);
+
+    pairingheap_add(wp_ctx->heap, &node->ph_node);
+}
+
+// get the coordinates of the vertex, false if any of them is missing
+static bool get_vertex_coordinates(coordinates_heuristic *ch, int64 vertex_index, float8 *coordinates) {
+    gtype *agt = DATUM_GET_GTYPE_P(get_vertex_properties(ch->ggctx, vertex_index));
+
+    for (int i = 0; i < ch->property_cnt; i++) {
+        gtype_value key = { .type = AGTV_STRING, .val.string = { strlen(ch->properties[i]), ch->properties[i] } };
+        gtype_value *value = find_gtype_value_from_container(&agt->root, GT_FOBJECT, &key);
+
+        if (value == NULL)
+            return false;
+        else if (value->type == AGTV_INTEGER)
+            coordinates[i] = (float8)value->val.int_value;
+        else if (value->type == AGTV_FLOAT)
+            coordinates[i] = value->val.float_value;
+        else
+            return false;
+    }
+
+    return true;
+}
+
+/*
+ * Estimate the cost as the distance to the end vertex, 0 when unknown. The
+ * estimate never overshoots, but a vertex without coordinates makes it
+ * inconsistent, which the search allows for.
+ */
+static float8 coordinates_distance(void *arg, int64 vertex_index) {
+    coordinates_heuristic *ch = arg;
+    float8 coordinates[ch->property_cnt];
+    float8 sum = 0;
+
+    if (!ch->has_target || !get_vertex_coordinates(ch, vertex_index, coordinates))
+        return 0;
+
+    for (int i = 0; i < ch->property_cnt; i++)
+        sum += (coordinates[i] - ch->target[i]) * (coordinates[i] - ch->target[i]);
+
+    return sqrt(sum);
+}
+
+// set up the coordinates heuristic from a list of property names
+static void *build_coordinates_heuristic(graph_context *ggctx, gtype *agt, int64 veidx) {
+    coordinates_heuristic *ch = palloc0(sizeof(coordinates_heuristic));
+    gtype_iterator *it = NULL;
+    gtype_value value;
+    gtype_iterator_token token;
+
+    if (!AGT_ROOT_IS_ARRAY(agt) || AGT_ROOT_IS_SCALAR(agt))
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                        errmsg("weighted_shortest_path: the heuristic must be a list of property names")));
+
+    ch->ggctx = ggctx;
+    ch->properties = palloc(sizeof(char *) * AGT_ROOT_COUNT(agt));
+
+    it = gtype_iterator_init(&agt->root);
+    while ((token = gtype_iterator_next(&it, &value, true)) != WGT_DONE) {
+        if (token != WGT_ELEM)
+            continue;
+
+        if (value.type != AGTV_STRING)
+            ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                            errmsg("weighted_shortest_path: the heuristic must be a list of property names")));
+
+        ch->properties[ch->property_cnt++] = pnstrdup(value.val.string.val, value.val.string.len);
+    }
+
+    ch->target = palloc(sizeof(float8) * Max(ch->property_cnt, 1));
+    ch->has_target = ch->property_cnt > 0 && get_vertex_coordinates(ch, veidx, ch->target);
+
+    return ch;
+}
+
+/*
+ * Find the cheapest path from the start vertex to the end vertex, following
+ * the edges in their direction. Returns false if there is none.
+ */
+static bool find_weighted_path(weighted_path_context *wp_ctx) {
+    graph_context *ggctx = wp_ctx->ggctx;
+    int64 vertex_count = get_graph_vertex_count(ggctx);
+
+    wp_ctx->distances = palloc(sizeof(float8) * vertex_count);
+    wp_ctx->parent_edges = palloc(sizeof(int64) * vertex_count);
+
+    for (int64 i = 0; i < vertex_count; i++) {
+        wp_ctx->distances[i] = get_float8_infinity();
+        wp_ctx->parent_edges[i] = -1;
+    }
+
+    wp_ctx->heap = pairingheap_allocate(compare_heap_nodes, NULL);
+
+    wp_ctx->distances[wp_ctx->vsidx] = 0;
+    push_vertex(wp_ctx, wp_ctx->vsidx, 0);
+
+    while (!pairingheap_is_empty(wp_ctx->heap)) {
+        heap_node *node = pairingheap_container(heap_node, ph_node, pairingheap_remove_first(wp_ctx->heap));
+        int64 vertex_index = node->vertex_index;
+        vertex_adjacency adj;
+
+        CHECK_FOR_INTERRUPTS();
+
+        // skip the entries left behind by a cheaper way there
+        if (node->distance > wp_ctx->distances[vertex_index])
+            continue;
+
+        if (vertex_index == wp_ctx->veidx)
+            return true;
+
+        get_vertex_adjacency(ggctx, vertex_index, &adj);
+
+        // only the exiting edges, self loops never make a path cheaper
+        for (int64 j = 0; j < adj.out_cnt; j++) {
+            int64 next_index = adj.vertices[j];
+            float8 weight;
+            float8 distance;
+
+            weight = get_edge_weight(ggctx, wp_ctx->weights, adj.edges[j], wp_ctx->weight_property);
+
+            // edges without a weight can't be taken
+            if (isnan(weight))
+                continue;
+
+            if (weight < 0)
+                ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                                errmsg("weighted_shortest_path: edge weights must not be negative")));
+
+            distance = wp_ctx->distances[vertex_index] + weight;
+
+            // also reopens a vertex expanded before, if the heuristic misled
+            if (distance >= wp_ctx->distances[next_index])
+                continue;
+
+            wp_ctx->distances[next_index] = distance;
+            wp_ctx->parent_edges[next_index] = adj.edges[j];
+
+            push_vertex(wp_ctx, next_index, distance);
+        }
+    }
+
+    return false;
+}
+
+// build the variable_edge of the path found, start vertex to end vertex
+static VariableEdge *build_weighted_path(weighted_path_context *wp_ctx) {
+    graph_context *ggctx = wp_ctx->ggctx;
+    int64 vertex_index = wp_ctx->veidx;
+    int path_len = 0;
+    graphid *graphid_array;
+    int graphid_array_size;
+    int index;
+
+    while (vertex_index != wp_ctx->vsidx) {
+        vertex_index = get_edge_start_index(ggctx, wp_ctx->parent_edges[vertex_index]);
+        path_len++;
+    }
+
+    graphid_array_size = path_len * 2 + 1;
+    graphid_array = palloc(sizeof(graphid) * graphid_array_size);
+
+    // fill the array from its end, walking back to the start vertex
+    index = graphid_array_size - 1;
+    vertex_index = wp_ctx->veidx;
+    graphid_array[index--] = get_vertex_id(ggctx, vertex_index);
+
+    while (vertex_index != wp_ctx->vsidx) {
+        int64 edge_index = wp_ctx->parent_edges[vertex_index];
+
+        vertex_index = get_edge_start_index(ggctx, edge_index);
+
+        graphid_array[index--] = get_edge_id(ggctx, edge_index);
+        graphid_array[index--] = get_vertex_id(ggctx, vertex_index);
+    }
+
+    return create_compact_variable_edge(wp_ctx->graph_oid, graphid_array, graphid_array_size);
+}
+
+/*
+ * The cheapest path between two vertices, where the cost of an edge is the
+ * value of one of its properties. Returns no rows if there is no such path,
+ * or if the start and end vertices are the same.
+ *
+ *     0 - gtype REQUIRED (graph name as string)
+ *     1 - vertex REQUIRED (start vertex)
+ *     2 - vertex REQUIRED (end vertex)
+ *     3 - gtype REQUIRED weight property name
+ *     4 - gtype OPTIONAL list of the vertex properties holding coordinates,
+ *         to guide the search with their distance to the end vertex (A*)
+ */
+PG_FUNCTION_INFO_V1(gtype_weighted_shortest_path);
+Datum gtype_weighted_shortest_path(PG_FUNCTION_ARGS) {
+    FuncCallContext *funcctx;
+    weighted_path_context *wp_ctx;
+
+    if (SRF_IS_FIRSTCALL()) {
+        MemoryContext oldctx;
+        gtype_value *agtv_temp;
+        char *graph_name;
+        vertex *v;
+        graphid vsid;
+        graphid veid;
+        bool found;
+
+        // all of these arguments need to be non NULL
+        if (PG_ARGISNULL(0) || PG_ARGISNULL(1) || PG_ARGISNULL(2) || PG_ARGISNULL(3))
+             ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("weighted_shortest_path: invalid NULL argument passed")));
+
+        funcctx = SRF_FIRSTCALL_INIT();
+        oldctx = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        wp_ctx = palloc0(sizeof(weighted_path_context));
+        funcctx->user_fctx = wp_ctx;
+
+        agtv_temp = get_gtype_value("weighted_shortest_path", AG_GET_ARG_GTYPE_P(0), AGTV_STRING, true);
+        graph_name = pnstrdup(agtv_temp->val.string.val, agtv_temp->val.string.len);
+        wp_ctx->graph_oid = get_graph_oid(graph_name);
+        wp_ctx->ggctx = manage_graph_contexts(graph_name, wp_ctx->graph_oid);
+
+        v = AG_GET_ARG_VERTEX(1);
+        vsid = *((int64 *)(&v->children[0]));
+        v = AG_GET_ARG_VERTEX(2);
+        veid = *((int64 *)(&v->children[0]));
+
+        agtv_temp = get_gtype_value("weighted_shortest_path", AG_GET_ARG_GTYPE_P(3), AGTV_STRING, true);
+        wp_ctx->weight_property = pnstrdup(agtv_temp->val.string.val, agtv_temp->val.string.len);
+
+        wp_ctx->vsidx = get_vertex_index(wp_ctx->ggctx, vsid);
+        wp_ctx->veidx = get_vertex_index(wp_ctx->ggctx, veid);
+
+        // like shortest_path, there is no zero length path to return
+        found = wp_ctx->vsidx >= 0 && wp_ctx->veidx >= 0 && wp_ctx->vsidx != wp_ctx->veidx;
+
+        if (found && !PG_ARGISNULL(4) && !is_gtype_null(AG_GET_ARG_GTYPE_P(4))) {
+            wp_ctx->heuristic = coordinates_distance;
+            wp_ctx->heuristic_arg = build_coordinates_heuristic(wp_ctx->ggctx, AG_GET_ARG_GTYPE_P(4), wp_ctx->veidx);
+        }
+
+        if (found) {
+            wp_ctx->weights = get_edge_weights(wp_ctx->ggctx, wp_ctx->weight_property);
+            found = find_weighted_path(wp_ctx);
+        }
+
+        MemoryContextSwitchTo(oldctx);
+
+        if (found)
+            SRF_RETURN_NEXT(funcctx, PointerGetDatum(build_weighted_path(wp_ctx)));
+    }
+
+    funcctx = SRF_PERCALL_SETUP();
+    SRF_RETURN_DONE(funcctx);
+}
@@ -20,643 +20,2635 @@
 
 #include "postgres.h"
 
+#include "fmgr.h"
 #include "access/heapam.h"
+#include "access/parallel.h"
 #include "access/relscan.h"
 #include "access/skey.h"
 #include "access/table.h"
 #include "access/tableam.h"
+#include "access/transam.h"
+#include "access/xact.h"
 #include "catalog/namespace.h"
 #include "commands/label_commands.h"
+#include "executor/executor.h"
+#include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "parser/parsetree.h"
+#include "port/atomics.h"
+#include "storage/bufmgr.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "storage/shm_toc.h"
+#include "tcop/utility.h"
+#include "utils/builtins.h"
+#include "utils/datum.h"
+#include "utils/dsa.h"
+#include "utils/float.h"
+#include "utils/guc.h"
+#include "utils/hsearch.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/snapmgr.h"
-#include "commands/label_commands.h"
-#include "common/hashfn.h"
 
 #include "catalog/ag_graph.h"
 #include "catalog/ag_label.h"
+#include "utils/ag_cache.h"
 #include "utils/global_graph.h"
-#include "utils/queue.h"
 #include "utils/gtype.h"
-#include "catalog/ag_graph.h"
-#include "catalog/ag_label.h"
 #include "utils/graphid.h"
-#include "utils/queue.h"
 
-// defines 
-#define VERTEX_HTAB_NAME "Vertex to edge lists " // added a space at end for 
-#define EDGE_HTAB_NAME "Edge to vertex mapping " // the graph name to follow 
-#define VERTEX_HTAB_INITIAL_SIZE 1000000
-#define EDGE_HTAB_INITIAL_SIZE 1000000
+// defines
+#define GRAPH_BUILD_CONTEXT_NAME "Graph image build"
+#define GRAPH_BUILD_INITIAL_SIZE 1024
+#define SHARED_GRAPH_STATE_NAME "postgraph shared graph cache"
+#define SHARED_GRAPH_TRANCHE_NAME "postgraph_shared_graph"
+#define SHARED_GRAPH_AREA_TRANCHE_NAME "postgraph_shared_graph_area"
+#define MAX_SHARED_GRAPHS 32
+#define GRAPH_DELTA_CONTEXT_NAME "Graph delta"
+#define DELTA_VERTEX_HTAB_NAME "Changed vertices"
+#define DELTA_VERTEX_ID_HTAB_NAME "Changed vertex ids"
+#define DELTA_EDGE_ID_HTAB_NAME "Changed edge ids"
+#define DELTA_HTAB_INITIAL_SIZE 64
+#define GRAPH_CHANGE_LOG_INITIAL_SIZE 64
+#define GRAPH_CHANGE_LOG_MAX_SIZE 65536
+#define GRAPH_DELTA_MIN_CHANGES 10000
+#define GRAPH_LOAD_MAX_WORKERS 1024
+#define GRAPH_LOAD_PARALLEL_MIN_BLOCKS 1024
+#define GRAPH_LOAD_KEY_SHARED UINT64CONST(0xD000000000000001)
+#define GRAPH_LOAD_KEY_DSA UINT64CONST(0xD000000000000002)
+
+// internal data structures implementation
+
+/*
+ * A graph image is one contiguous, pointer free, chunk of memory holding every
+ * vertex, edge and property of a graph as it was seen by one snapshot, in
+ * compressed sparse row form. Vertices and edges are numbered in id order, and
+ * each one is described by one entry in a set of parallel arrays. The edges of
+ * vertex v are the adjacency entries vertex_offsets[v] to vertex_offsets[v + 1]:
+ * first the exiting edges, then the entering edges and finally the self loops.
+ * An adjacency entry holds the edge's index, the index of the vertex at the
+ * other end and the edge's label, so a neighbourhood is scanned without
+ * looking at the edges themselves.
+ *
+ * The image only holds offsets, never pointers, so that it can live in shared
+ * memory that is mapped at a different address in every backend. It is either
+ * allocated in the TopMemoryContext, or in the dsa area shared by all backends
+ * when postgraph.shared_graph_cache is enabled.
+ */
+typedef struct graph_image
+{
+    pg_atomic_uint32 refcount;     // references held on a shared image
+    Oid graph_oid;                 // graph the image was built for
+    uint64 completion_count;       // snapshot the image was built with
+    TransactionId xmin;
+    TransactionId xmax;
+    CommandId curcid;
+    int64 vertex_cnt;              // number of vertices in the image
+    int64 edge_cnt;                // number of edges in the image
+    int64 adjacency_cnt;           // number of adjacency entries
+    // offsets of the arrays from the image start
+    Size vertex_ids;               // graphid[vertex_cnt], sorted
+    Size vertex_oids;              // Oid[vertex_cnt], label table
+    Size vertex_properties;        // Size[vertex_cnt], property offset
+    Size vertex_offsets;           // int64[vertex_cnt + 1], first adjacency entry
+    Size vertex_out_cnts;          // uint32[vertex_cnt], exiting edges
+    Size vertex_in_cnts;           // uint32[vertex_cnt], entering edges
+    Size edge_ids;                 // graphid[edge_cnt], sorted
+    Size edge_oids;                // Oid[edge_cnt], label table
+    Size edge_starts;              // int64[edge_cnt], start vertex index
+    Size edge_ends;                // int64[edge_cnt], end vertex index
+    Size edge_properties;          // Size[edge_cnt], property offset
+    Size adjacency_edges;          // int64[adjacency_cnt], edge index
+    Size adjacency_vertices;       // int64[adjacency_cnt], other vertex index
+    Size adjacency_labels;         // Oid[adjacency_cnt], edge label table
+    Size properties;               // the property area
+    Size size;                     // total size of the image in bytes
+} graph_image;
+
+/*
+ * GRAPH global context per graph. They are chained together via next.
+ * Be aware that the global pointer will point to the root BUT that
+ * the root will change as new graphs are added to the top.
+ */
+typedef struct graph_context
+{
+    char *graph_name;              // graph name
+    Oid graph_oid;                 // graph oid for searching
+    uint64 completion_count;       // transaction completions the graph reflects
+    TransactionId xmin;            // transaction ids for this graph
+    TransactionId xmax;
+    CommandId curcid;              // commands of this transaction the graph reflects
+    bool stale;                    // the graph can't be brought up to date
+    int applied;                   // entries of the change log applied
+    int64 vertex_cnt;              // number of loaded vertices in this graph
+    int64 edge_cnt;                // number of loaded edges in this graph
+    graph_image *image;            // the image, local or mapped from the dsa
+    dsa_pointer shared_image;      // the image in the dsa, if it is shared
+    struct graph_delta *delta;     // changes made since the image was built
+    // arrays inside of the image
+    graphid *vertex_ids;
+    Oid *vertex_oids;
+    Size *vertex_properties;
+    int64 *vertex_offsets;
+    uint32 *vertex_out_cnts;
+    uint32 *vertex_in_cnts;
+    graphid *edge_ids;
+    Oid *edge_oids;
+    int64 *edge_starts;
+    int64 *edge_ends;
+    Size *edge_properties;
+    int64 *adjacency_edges;
+    int64 *adjacency_vertices;
+    Oid *adjacency_labels;
+    char *properties;
+    struct edge_weights *weights;  // weight properties extracted so far
+    struct graph_context *next;    // next graph
+} graph_context;
+
+/*
+ * A numeric edge property extracted from every edge of the image, so weighted
+ * searches never look into the property containers. The edges missing the
+ * property, or with a value that isn't a number, get NaN.
+ */
+typedef struct edge_weights
+{
+    char *property;                // name of the weight property
+    float8 *values;                // float8[edge_cnt] of the image
+    struct edge_weights *next;
+} edge_weights;
+
+// vertex and edge as collected by the label table scans
+typedef struct build_vertex
+{
+    graphid id;
+    Oid oid;
+    Size properties;
+} build_vertex;
+
+typedef struct build_edge
+{
+    graphid id;
+    Oid oid;
+    graphid start_id;
+    graphid end_id;
+    Size properties;
+} build_edge;
+
+/*
+ * Graph image under construction. Vertices and edges are appended as the label
+ * tables are scanned, and the properties are copied into one growing buffer.
+ * Once sorted, the adjacency is built in the layout of the image.
+ */
+typedef struct graph_build_state
+{
+    MemoryContext mcxt;            // holds everything below
+    build_vertex *vertices;
+    int64 vertex_cnt;
+    int64 vertex_cap;
+    build_edge *edges;
+    int64 edge_cnt;
+    int64 edge_cap;
+    int64 *edge_starts;
+    int64 *edge_ends;
+    int64 *vertex_offsets;
+    uint32 *vertex_out_cnts;
+    uint32 *vertex_in_cnts;
+    int64 *adjacency_edges;
+    int64 *adjacency_vertices;
+    Oid *adjacency_labels;
+    int64 adjacency_cnt;
+    char *properties;
+    Size properties_len;
+    Size properties_cap;
+} graph_build_state;
+
+/*
+ * A vertex whose properties or edges changed since the image was built. When
+ * its edges change, it gets its own copy of its adjacency entries.
+ */
+typedef struct delta_vertex
+{
+    int64 index;                   // vertex index, it is also the hash key
+    bool has_properties;           // the properties changed
+    Size properties;               // offset in the delta's property area
+    bool has_edges;                // the edges changed
+    int64 *edges;                  // adjacency entries, as in the image
+    int64 *vertices;
+    Oid *labels;
+    int64 out_cnt;
+    int64 in_cnt;
+    int64 loop_cnt;
+    int64 edges_cap;               // allocated size of the adjacency arrays
+} delta_vertex;
+
+// the current index of a vertex or edge that was created, changed or deleted
+typedef struct delta_id
+{
+    graphid id;                    // vertex or edge id, it is also the hash key
+    int64 index;                   // index of the current version
+    bool deleted;                  // it no longer exists
+} delta_id;
+
+// a vertex created since the image was built
+typedef struct delta_new_vertex
+{
+    graphid id;
+    Oid oid;
+    Size properties;
+} delta_new_vertex;
+
+// an edge created, or changed, since the image was built
+typedef struct delta_new_edge
+{
+    graphid id;
+    Oid oid;
+    int64 start;
+    int64 end;
+    Size properties;
+} delta_new_edge;
+
+/*
+ * Changes applied on top of a graph image. Created vertices and edges get the
+ * indexes following the image's, so indexes stay stable while a graph is used.
+ * A changed edge is treated as deleted and created again.
+ */
+typedef struct graph_delta
+{
+    MemoryContext mcxt;            // holds everything below
+    HTAB *vertex_ids;              // graphid -> delta_id
+    HTAB *edge_ids;                // graphid -> delta_id
+    HTAB *vertices;                // vertex index -> delta_vertex
+    delta_new_vertex *new_vertices;// vertices with index vertex_cnt and above
+    int64 new_vertex_cnt;
+    int64 new_vertex_cap;
+    delta_new_edge *new_edges;     // edges with index edge_cnt and above
+    int64 new_edge_cnt;
+    int64 new_edge_cap;
+    char *properties;              // property area of the changed entities
+    Size properties_len;
+    Size properties_cap;
+    int64 changes;                 // number of changes applied
+} graph_delta;
+
+/*
+ * A change made to a graph by the current transaction. The CREATE, DELETE,
+ * SET and MERGE executors log every vertex and edge they write, so graphs
+ * already in memory can be brought forward without being loaded again.
+ */
+typedef struct graph_change
+{
+    Oid graph_oid;                 // graph the entity belongs to
+    graph_change_kind kind;        // what was done to it
+    char label_kind;               // LABEL_KIND_VERTEX or LABEL_KIND_EDGE
+    CommandId cid;                 // command the change was made in
+    int nest_level;                // transaction nest level of the change
+    graphid id;
+    graphid start_id;
+    graphid end_id;
+    Oid label_oid;                 // label table of the entity
+    Datum properties;              // new properties, if any
+} graph_change;
+
+// a published image in the shared graph cache
+typedef struct shared_graph_slot
+{
+    Oid graph_oid;                 // InvalidOid for an empty slot
+    dsa_pointer image;             // the slot holds one reference on it
+} shared_graph_slot;
+
+// shared memory control structure of the shared graph cache
+typedef struct shared_graph_state
+{
+    LWLock *lock;                  // protects the slots and the area handle
+    int area_tranche_id;           // tranche of the dsa area's locks
+    dsa_handle area;               // the dsa area images are allocated in
+    int next_victim;               // slot to evict when all are in use
+    shared_graph_slot slots[MAX_SHARED_GRAPHS];
+} shared_graph_state;
+
+// a label table to load, with the parallel scan over it
+typedef struct graph_load_label
+{
+    Oid oid;                       // label table
+    char kind;                     // LABEL_KIND_VERTEX or LABEL_KIND_EDGE
+    Size pscan;                    // offset of the scan from graph_load_shared
+} graph_load_label;
+
+/*
+ * What a parallel worker loaded: its vertices, its edges and their
+ * properties, in one chunk of the dsa area.
+ */
+typedef struct graph_load_result
+{
+    dsa_pointer data;              // InvalidDsaPointer until the worker is done
+    int64 vertex_cnt;
+    int64 edge_cnt;
+    Size properties_len;
+} graph_load_result;
+
+/*
+ * Shared state of a parallel graph load. Every participant, the leader
+ * included, goes through the label tables in order and takes part in one
+ * parallel scan of each, so the work is balanced even when a few label tables
+ * hold most of the graph.
+ */
+typedef struct graph_load_shared
+{
+    int nlabels;
+    int nworkers;
+    Size labels;                   // offset of the graph_load_label array
+    graph_load_result results[FLEXIBLE_ARRAY_MEMBER];
+} graph_load_shared;
+
+// GUC variables
+bool shared_graph_cache = false;
+int shared_graph_cache_size = 1024;
+int graph_load_workers = 2;
+
+// global variable to hold the per process GRAPH global context
+static graph_context *global_graph_contexts = NULL;
+
+/*
+ * Changes made by the current transaction, in command order. The log and the
+ * list of subtransaction start commands live in the TopTransactionContext.
+ */
+static graph_change *change_log = NULL;
+static int change_log_cnt = 0;
+static int change_log_cap = 0;
+static bool change_log_overflow = false;
+static List *subxact_start_cids = NIL;
+
+/*
+ * Commands of the current transaction that wrote to a label table without
+ * going through the executors, in command order. They live in the
+ * TopTransactionContext too.
+ */
+static List *unlogged_write_cids = NIL;
+
+/*
+ * A snapshot known to see the transactions of the completion count it holds
+ * as completed, kept for the rest of the transaction so every statement's
+ * snapshot can be matched against it without taking a new one. Its arrays
+ * live in the TopTransactionContext.
+ */
+static SnapshotData known_snapshot;
+static bool known_snapshot_set = false;
+static ExecutorStart_hook_type prev_executor_start_hook = NULL;
+static ProcessUtility_hook_type prev_process_utility_hook = NULL;
+
+// shared graph cache, only set when loaded with shared_preload_libraries
+static shared_graph_state *shared_state = NULL;
+static dsa_area *shared_area = NULL;
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+#if PG_VERSION_NUM >= 150000
+static shmem_request_hook_type prev_shmem_request_hook = NULL;
+#endif
+
+// declarations
+// GRAPH global context functions
+static void free_graph_context(graph_context *ggctx);
+static void release_graph_image(graph_context *ggctx);
+static float8 extract_edge_weight(Datum properties, char *property);
+static void set_graph_context_image(graph_context *ggctx, graph_image *image);
+static graph_build_state *create_build_state(MemoryContext parent);
+static void load_graph(graph_context *ggctx, graph_build_state *bs);
+static List *get_label_tables(graph_context *ggctx, Snapshot snapshot, List **kinds);
+static void load_label_table(graph_build_state *bs, TableScanDesc scan_desc, Oid oid, char kind);
+static int get_graph_load_workers(List *relations);
+static void load_label_tables_parallel(graph_build_state *bs, List *oids, List *kinds, List *relations, int nworkers);
+static void scan_label_tables(graph_load_shared *shared, graph_build_state *bs);
+static void merge_load_result(graph_build_state *bs, graph_load_result *result, char *data);
+static void build_adjacency(graph_build_state *bs);
+static Size compute_image_size(graph_build_state *bs, graph_image *layout);
+static void write_image(graph_image *image, graph_build_state *bs, Oid graph_oid, uint64 completion_count);
+static List *get_labels(Snapshot snapshot, Oid graph_oid, char label_type);
+static void insert_edge(graph_build_state *bs, graphid id, Datum properties, graphid start_id, graphid end_id, Oid oid);
+static void insert_vertex_entry(graph_build_state *bs, graphid id, Oid oid, Datum properties);
+static Size insert_properties(graph_build_state *bs, Datum properties);
+static int compare_build_vertices(const void *a, const void *b);
+static int compare_build_edges(const void *a, const void *b);
+static int64 find_build_vertex(graph_build_state *bs, graphid id);
+static int64 find_id(graphid *ids, int64 cnt, graphid id);
+// shared graph cache functions
+static void shared_graph_shmem_request(void);
+static void shared_graph_shmem_startup(void);
+static dsa_area *get_shared_area(void);
+static void release_shared_graphs(int code, Datum arg);
+static void release_shared_image(dsa_pointer image);
+static bool attach_shared_image(graph_context *ggctx);
+static void publish_shared_image(graph_context *ggctx, graph_build_state *bs);
+// change tracking functions
+static void graph_xact_callback(XactEvent event, void *arg);
+static void graph_subxact_callback(SubXactEvent event, SubTransactionId mySubid, SubTransactionId parentSubid, void *arg);
+static void apply_remaining_graph_changes(void);
+static void end_graph_changes(bool commit);
+static bool are_changes_logged(CommandId from, CommandId to);
+static uint64 get_snapshot_completion_count(Snapshot snap);
+static bool snapshots_see_same(Snapshot a, Snapshot b);
+static void set_known_snapshot(Snapshot snap);
+static void graph_executor_start(QueryDesc *queryDesc, int eflags);
+static void graph_process_utility(PlannedStmt *pstmt, const char *queryString, bool readOnlyTree,
+                                  ProcessUtilityContext context, ParamListInfo params,
+                                  QueryEnvironment *queryEnv, DestReceiver *dest,
+                                  QueryCompletion *qc);
+static void mark_unlogged_range_var(RangeVar *relation);
+static int count_applied_changes(CommandId to);
+static void apply_graph_changes(graph_context *ggctx, CommandId to);
+static void apply_graph_change(graph_context *ggctx, graph_change *change);
+static graph_delta *get_graph_delta(graph_context *ggctx);
+static delta_vertex *get_delta_vertex(graph_context *ggctx, int64 vertex_index, bool create);
+static void copy_delta_vertex_edges(graph_context *ggctx, delta_vertex *dv);
+static void set_delta_id(HTAB *ids, graphid id, int64 index, bool deleted);
+static Size insert_delta_properties(graph_delta *delta, Datum properties);
+static bool insert_delta_edge(graph_context *ggctx, graphid id, graphid start_id, graphid end_id, Oid oid, Datum properties);
+static bool delete_delta_edge(graph_context *ggctx, graphid id);
+static void add_delta_vertex_edge(graph_context *ggctx, delta_vertex *dv, int list, int64 edge_index, int64 vertex_index, Oid label);
+static void remove_delta_vertex_edge(graph_context *ggctx, delta_vertex *dv, int64 edge_index);
+
+/*
+ * A GRAPH global context is invalid when it can't be brought up to date with
+ * the active snapshot. This is the case when any other transaction completed
+ * since the graph was loaded, or when the current transaction made changes
+ * to the database that were not logged by the executors.
+ */
+bool is_ggctx_invalid(graph_context *ggctx) {
+    Snapshot snap = GetActiveSnapshot();
+    uint64 completion_count;
+
+    if (ggctx->stale)
+        return true;
+
+    completion_count = get_snapshot_completion_count(snap);
+
+    // without a completion count, only the exact same snapshot will do
+    if (completion_count == 0 || ggctx->completion_count == 0)
+        return (ggctx->xmin != snap->xmin || ggctx->xmax != snap->xmax || ggctx->curcid != snap->curcid);
+
+    if (ggctx->completion_count != completion_count || ggctx->curcid > snap->curcid)
+        return true;
+
+    return !are_changes_logged(ggctx->curcid, snap->curcid);
+}
+
+/*
+ * Get the number of transaction completions the snapshot was taken after, or
+ * 0 when it isn't known. The active snapshot is always a copy, and copies
+ * don't keep the count, so it is taken from a new snapshot instead, provided
+ * the new one sees the same transactions as completed.
+ */
+static uint64 get_snapshot_completion_count(Snapshot snap) {
+    Snapshot latest;
+
+    if (snap->snapXactCompletionCount != 0)
+        return snap->snapXactCompletionCount;
+
+    if (snap->snapshot_type != SNAPSHOT_MVCC)
+        return 0;
+
+    if (known_snapshot_set && snapshots_see_same(snap, &known_snapshot))
+        return known_snapshot.snapXactCompletionCount;
+
+    // no new snapshot can be taken during a parallel operation
+    if (IsInParallelMode() || HistoricSnapshotActive())
+        return 0;
+
+    latest = GetLatestSnapshot();
+    if (latest->snapXactCompletionCount == 0 || !snapshots_see_same(snap, latest))
+        return 0;
+
+    set_known_snapshot(latest);
+
+    return latest->snapXactCompletionCount;
+}
+
+/*
+ * Check that two MVCC snapshots see the same transactions as completed. The
+ * transactions in progress are compared in order, so snapshots taken while
+ * the backends came and went may be found different when they aren't.
+ */
+static bool snapshots_see_same(Snapshot a, Snapshot b) {
+    if (a->xmin != b->xmin || a->xmax != b->xmax || a->xcnt != b->xcnt ||
+        a->suboverflowed != b->suboverflowed || a->takenDuringRecovery != b->takenDuringRecovery)
+        return false;
+
+    if (a->xcnt > 0 && memcmp(a->xip, b->xip, sizeof(TransactionId) * a->xcnt) != 0)
+        return false;
+
+    // the subtransactions of an overflowed snapshot are looked up in pg_subtrans
+    if (a->suboverflowed && !a->takenDuringRecovery)
+        return true;
+
+    if (a->subxcnt != b->subxcnt)
+        return false;
+
+    return a->subxcnt == 0 || memcmp(a->subxip, b->subxip, sizeof(TransactionId) * a->subxcnt) == 0;
+}
+
+// remember the snapshot and its completion count for the rest of the transaction
+static void set_known_snapshot(Snapshot snap) {
+    MemoryContext oldctx = MemoryContextSwitchTo(TopTransactionContext);
+
+    if (known_snapshot_set) {
+        if (known_snapshot.xip != NULL)
+            pfree(known_snapshot.xip);
+        if (known_snapshot.subxip != NULL)
+            pfree(known_snapshot.subxip);
+    }
+
+    known_snapshot = *snap;
+    known_snapshot.xip = NULL;
+    known_snapshot.subxip = NULL;
+
+    if (snap->xcnt > 0) {
+        known_snapshot.xip = palloc(sizeof(TransactionId) * snap->xcnt);
+        memcpy(known_snapshot.xip, snap->xip, sizeof(TransactionId) * snap->xcnt);
+    }
+
+    if (snap->subxcnt > 0 && (!snap->suboverflowed || snap->takenDuringRecovery)) {
+        known_snapshot.subxip = palloc(sizeof(TransactionId) * snap->subxcnt);
+        memcpy(known_snapshot.subxip, snap->subxip, sizeof(TransactionId) * snap->subxcnt);
+    }
+
+    known_snapshot_set = true;
+
+    MemoryContextSwitchTo(oldctx);
+}
+
+/*
+ * Define the GUC variables and, when loaded with shared_preload_libraries,
+ * reserve the shared memory and lock needed by the shared graph cache.
+ */
+void global_graph_init(void) {
+    DefineCustomBoolVariable("postgraph.shared_graph_cache",
+                             "Shares the in-memory graph used by path finding functions between backends.",
+                             "Requires postgraph to be in shared_preload_libraries.",
+                             &shared_graph_cache, false, PGC_SUSET, 0, NULL, NULL, NULL);
+
+    DefineCustomIntVariable("postgraph.shared_graph_cache_size",
+                            "Sets the maximum amount of shared memory used by the shared graph cache.",
+                            "Graphs that don't fit are kept in the memory of the backend that loaded them.",
+                            &shared_graph_cache_size, 1024, 1, MAX_KILOBYTES / 1024, PGC_SIGHUP, GUC_UNIT_MB,
+                            NULL, NULL, NULL);
+
+    DefineCustomIntVariable("postgraph.graph_load_workers",
+                            "Sets the number of parallel workers used to load a graph into memory.",
+                            "Only graphs whose label tables span at least 1024 blocks are loaded in parallel.",
+                            &graph_load_workers, 2, 0, GRAPH_LOAD_MAX_WORKERS, PGC_USERSET, 0, NULL, NULL, NULL);
+
+    // keep the graphs in memory in step with the transaction's own changes
+    RegisterXactCallback(graph_xact_callback, NULL);
+    RegisterSubXactCallback(graph_subxact_callback, NULL);
+
+    // and notice the writes to label tables the executors don't log
+    prev_executor_start_hook = ExecutorStart_hook;
+    ExecutorStart_hook = graph_executor_start;
+    prev_process_utility_hook = ProcessUtility_hook;
+    ProcessUtility_hook = graph_process_utility;
+
+    if (!process_shared_preload_libraries_in_progress)
+        return;
+
+    // from PostgreSQL 15 on, shared memory can only be requested from the hook
+#if PG_VERSION_NUM >= 150000
+    prev_shmem_request_hook = shmem_request_hook;
+    shmem_request_hook = shared_graph_shmem_request;
+#else
+    shared_graph_shmem_request();
+#endif
+
+    prev_shmem_startup_hook = shmem_startup_hook;
+    shmem_startup_hook = shared_graph_shmem_startup;
+}
+
+// reserve the shared memory and lock of the shared graph cache
+static void shared_graph_shmem_request(void) {
+#if PG_VERSION_NUM >= 150000
+    if (prev_shmem_request_hook)
+        prev_shmem_request_hook();
+#endif
+
+    RequestAddinShmemSpace(MAXALIGN(sizeof(shared_graph_state)));
+    RequestNamedLWLockTranche(SHARED_GRAPH_TRANCHE_NAME, 1);
+}
+
+// create or attach to the shared graph cache control structure
+static void shared_graph_shmem_startup(void) {
+    bool found;
+
+    if (prev_shmem_startup_hook)
+        prev_shmem_startup_hook();
+
+    LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+    shared_state = ShmemInitStruct(SHARED_GRAPH_STATE_NAME, sizeof(shared_graph_state), &found);
+    if (!found) {
+        MemSet(shared_state, 0, sizeof(shared_graph_state));
+        shared_state->lock = &(GetNamedLWLockTranche(SHARED_GRAPH_TRANCHE_NAME))->lock;
+        shared_state->area_tranche_id = LWLockNewTrancheId();
+        shared_state->area = DSM_HANDLE_INVALID;
+        shared_state->next_victim = 0;
+
+        for (int i = 0; i < MAX_SHARED_GRAPHS; i++) {
+            shared_state->slots[i].graph_oid = InvalidOid;
+            shared_state->slots[i].image = InvalidDsaPointer;
+        }
+    }
+
+    LWLockRelease(AddinShmemInitLock);
+}
+
+/*
+ * Get the dsa area the shared images are allocated in. The first backend to
+ * need it creates it, every other backend attaches to it. The mapping is kept
+ * for the life of the backend.
+ */
+static dsa_area *get_shared_area(void) {
+    MemoryContext oldctx;
+
+    if (shared_area != NULL)
+        return shared_area;
+
+    LWLockRegisterTranche(shared_state->area_tranche_id, SHARED_GRAPH_AREA_TRANCHE_NAME);
+
+    oldctx = MemoryContextSwitchTo(TopMemoryContext);
+
+    LWLockAcquire(shared_state->lock, LW_EXCLUSIVE);
+    if (shared_state->area == DSM_HANDLE_INVALID) {
+        shared_area = dsa_create(shared_state->area_tranche_id);
+        // keep the area around when no backend is attached to it
+        dsa_pin(shared_area);
+        shared_state->area = dsa_get_handle(shared_area);
+    } else {
+        shared_area = dsa_attach(shared_state->area);
+    }
+    LWLockRelease(shared_state->lock);
+
+    dsa_pin_mapping(shared_area);
+
+    MemoryContextSwitchTo(oldctx);
+
+    // drop the references this backend holds on shared images when it exits
+    before_shmem_exit(release_shared_graphs, (Datum)0);
+
+    return shared_area;
+}
+
+// release a reference to a shared image, freeing it with the last one
+static void release_shared_image(dsa_pointer image) {
+    graph_image *img = dsa_get_address(shared_area, image);
+
+    if (pg_atomic_sub_fetch_u32(&img->refcount, 1) == 0)
+        dsa_free(shared_area, image);
+}
+
+// before_shmem_exit callback to release the images this backend is using
+static void release_shared_graphs(int code, Datum arg) {
+    graph_context *ggctx;
+
+    for (ggctx = global_graph_contexts; ggctx != NULL; ggctx = ggctx->next) {
+        if (DsaPointerIsValid(ggctx->shared_image)) {
+            release_shared_image(ggctx->shared_image);
+            ggctx->shared_image = InvalidDsaPointer;
+            ggctx->image = NULL;
+        }
+    }
+}
+
+/*
+ * Look for a shared image of the graph that was built after the same set of
+ * transactions completed as the active snapshot. If there is one, take a
+ * reference to it and use it for the passed GRAPH global context.
+ */
+static bool attach_shared_image(graph_context *ggctx) {
+    dsa_area *area = get_shared_area();
+    dsa_pointer image = InvalidDsaPointer;
+
+    LWLockAcquire(shared_state->lock, LW_SHARED);
+
+    for (int i = 0; i < MAX_SHARED_GRAPHS; i++) {
+        shared_graph_slot *slot = &shared_state->slots[i];
+        graph_image *img;
+
+        if (slot->graph_oid != ggctx->graph_oid)
+            continue;
+
+        img = dsa_get_address(area, slot->image);
+        if (img->completion_count == ggctx->completion_count) {
+            // the slot's reference keeps the image alive while we hold the lock
+            pg_atomic_add_fetch_u32(&img->refcount, 1);
+            image = slot->image;
+        }
+        break;
+    }
+
+    LWLockRelease(shared_state->lock);
+
+    if (!DsaPointerIsValid(image))
+        return false;
+
+    ggctx->shared_image = image;
+    set_graph_context_image(ggctx, dsa_get_address(area, image));
+
+    ereport(DEBUG1, (errmsg("using the shared image of graph \"%s\"", ggctx->graph_name)));
+
+    return true;
+}
+
+/*
+ * Copy the built graph into the dsa area and publish it in the graph's slot,
+ * replacing any older image of the graph. The passed context keeps its own
+ * reference to the new image. If the area cannot hold the image, the graph is
+ * kept local to this backend instead.
+ */
+static void publish_shared_image(graph_context *ggctx, graph_build_state *bs) {
+    dsa_area *area = get_shared_area();
+    graph_image layout;
+    graph_image *img;
+    dsa_pointer image;
+    shared_graph_slot *slot = NULL;
+    Size size;
+
+    size = compute_image_size(bs, &layout);
+
+    // the limit may have changed since the area was created
+    dsa_set_size_limit(area, (Size)shared_graph_cache_size * 1024 * 1024);
+
+    image = dsa_allocate_extended(area, size, DSA_ALLOC_HUGE | DSA_ALLOC_NO_OOM);
+    if (!DsaPointerIsValid(image)) {
+        ereport(DEBUG1, (errmsg("graph \"%s\" does not fit in the shared graph cache", ggctx->graph_name)));
+
+        img = MemoryContextAllocHuge(TopMemoryContext, size);
+        write_image(img, bs, ggctx->graph_oid, ggctx->completion_count);
+        set_graph_context_image(ggctx, img);
+        return;
+    }
+
+    img = dsa_get_address(area, image);
+    write_image(img, bs, ggctx->graph_oid, ggctx->completion_count);
+
+    // one reference for the slot and one for this backend
+    pg_atomic_init_u32(&img->refcount, 2);
+
+    LWLockAcquire(shared_state->lock, LW_EXCLUSIVE);
+
+    for (int i = 0; i < MAX_SHARED_GRAPHS; i++) {
+        if (shared_state->slots[i].graph_oid == ggctx->graph_oid) {
+            slot = &shared_state->slots[i];
+            break;
+        }
+
+        if (slot == NULL && shared_state->slots[i].graph_oid == InvalidOid)
+            slot = &shared_state->slots[i];
+    }
+
+    // every slot is in use by another graph, evict one
+    if (slot == NULL) {
+        slot = &shared_state->slots[shared_state->next_victim];
+        shared_state->next_victim = (shared_state->next_victim + 1) % MAX_SHARED_GRAPHS;
+    }
+
+    if (DsaPointerIsValid(slot->image))
+        release_shared_image(slot->image);
+
+    slot->graph_oid = ggctx->graph_oid;
+    slot->image = image;
+
+    LWLockRelease(shared_state->lock);
+
+    ggctx->shared_image = image;
+    set_graph_context_image(ggctx, img);
+}
+
+// point the GRAPH global context at the arrays of its image
+static void set_graph_context_image(graph_context *ggctx, graph_image *image) {
+    char *base = (char *)image;
+
+    ggctx->image = image;
+    ggctx->vertex_cnt = image->vertex_cnt;
+    ggctx->edge_cnt = image->edge_cnt;
+    ggctx->vertex_ids = (graphid *)(base + image->vertex_ids);
+    ggctx->vertex_oids = (Oid *)(base + image->vertex_oids);
+    ggctx->vertex_properties = (Size *)(base + image->vertex_properties);
+    ggctx->vertex_offsets = (int64 *)(base + image->vertex_offsets);
+    ggctx->vertex_out_cnts = (uint32 *)(base + image->vertex_out_cnts);
+    ggctx->vertex_in_cnts = (uint32 *)(base + image->vertex_in_cnts);
+    ggctx->edge_ids = (graphid *)(base + image->edge_ids);
+    ggctx->edge_oids = (Oid *)(base + image->edge_oids);
+    ggctx->edge_starts = (int64 *)(base + image->edge_starts);
+    ggctx->edge_ends = (int64 *)(base + image->edge_ends);
+    ggctx->edge_properties = (Size *)(base + image->edge_properties);
+    ggctx->adjacency_edges = (int64 *)(base + image->adjacency_edges);
+    ggctx->adjacency_vertices = (int64 *)(base + image->adjacency_vertices);
+    ggctx->adjacency_labels = (Oid *)(base + image->adjacency_labels);
+    ggctx->properties = base + image->properties;
+}
+
+// helper function to create the state the graph image is built in
+static graph_build_state *create_build_state(MemoryContext parent) {
+    MemoryContext mcxt = AllocSetContextCreate(parent, GRAPH_BUILD_CONTEXT_NAME, ALLOCSET_DEFAULT_SIZES);
+    graph_build_state *bs = MemoryContextAllocZero(mcxt, sizeof(graph_build_state));
+
+    bs->mcxt = mcxt;
+
+    bs->vertex_cap = GRAPH_BUILD_INITIAL_SIZE;
+    bs->vertices = MemoryContextAllocHuge(mcxt, sizeof(build_vertex) * bs->vertex_cap);
+
+    bs->edge_cap = GRAPH_BUILD_INITIAL_SIZE;
+    bs->edges = MemoryContextAllocHuge(mcxt, sizeof(build_edge) * bs->edge_cap);
+
+    bs->properties_cap = GRAPH_BUILD_INITIAL_SIZE * 64;
+    bs->properties = MemoryContextAllocHuge(mcxt, bs->properties_cap);
+
+    return bs;
+}
+
+// helper function to get a List of all label names for the specified graph
+static List *get_labels(Snapshot snapshot, Oid graph_oid, char label_type) {
+    List *labels = NIL;
+    ScanKeyData scan_keys[2];
+    Relation ag_label;
+    TableScanDesc scan_desc;
+    HeapTuple tuple;
+    TupleDesc tupdesc;
+
+    // we need a valid snapshot
+    Assert(snapshot != NULL);
+
+    // setup scan keys to get all edges for the given graph oid
+    ScanKeyInit(&scan_keys[1], Anum_ag_label_graph, BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(graph_oid));
+    ScanKeyInit(&scan_keys[0], Anum_ag_label_kind, BTEqualStrategyNumber, F_CHAREQ, CharGetDatum(label_type));
+
+    // setup the table to be scanned, ag_label in this case
+    ag_label = table_open(ag_label_relation_id(), ShareLock);
+    scan_desc = table_beginscan(ag_label, snapshot, 2, scan_keys);
+
+    // get the tupdesc - we don't need to release this one
+    tupdesc = RelationGetDescr(ag_label);
+
+    // get all of the label names
+    while((tuple = heap_getnext(scan_desc, ForwardScanDirection)) != NULL) {
+        Name label;
+        bool is_null = false;
+
+        // something is wrong if this tuple isn't valid
+        Assert(HeapTupleIsValid(tuple));
+        // get the label name
+        label = DatumGetName(heap_getattr(tuple, Anum_ag_label_name, tupdesc, &is_null));
+        Assert(!is_null);
+        // add it to our list
+        labels = lappend(labels, pstrdup(NameStr(*label)));
+    }
+
+    // close up scan
+    table_endscan(scan_desc);
+    table_close(ag_label, ShareLock);
+
+    return labels;
+}
+
+/*
+ * Helper function to copy a properties datum into the property area of the
+ * image being built. Returns the offset of the copy. The datum is detoasted,
+ * as the image must not reference anything outside of itself.
+ */
+static Size insert_properties(graph_build_state *bs, Datum properties) {
+    struct varlena *props = PG_DETOAST_DATUM(properties);
+    Size len = VARSIZE(props);
+    Size offset = MAXALIGN(bs->properties_len);
+
+    if (offset + len > bs->properties_cap) {
+        while (offset + len > bs->properties_cap)
+            bs->properties_cap *= 2;
+
+        bs->properties = repalloc_huge(bs->properties, bs->properties_cap);
+    }
+
+    memcpy(bs->properties + offset, props, len);
+    bs->properties_len = offset + len;
+
+    if ((Pointer)props != DatumGetPointer(properties))
+        pfree(props);
+
+    return offset;
+}
+
+// Helper function to add one edge to the image being built.
+static void insert_edge(graph_build_state *bs, graphid id, Datum properties, graphid start_id, graphid end_id, Oid oid)
+{
+    build_edge *value = NULL;
+
+    if (bs->edge_cnt == bs->edge_cap) {
+        bs->edge_cap *= 2;
+        bs->edges = repalloc_huge(bs->edges, sizeof(build_edge) * bs->edge_cap);
+    }
+
+    value = &bs->edges[bs->edge_cnt++];
+
+    value->id = id;
+    value->oid = oid;
+    value->start_id = start_id;
+    value->end_id = end_id;
+    value->properties = insert_properties(bs, properties);
+}
+
+// Helper function to add one vertex to the image being built.
+static void insert_vertex_entry(graph_build_state *bs, graphid id, Oid oid, Datum properties) {
+    build_vertex *value = NULL;
+
+    if (bs->vertex_cnt == bs->vertex_cap) {
+        bs->vertex_cap *= 2;
+        bs->vertices = repalloc_huge(bs->vertices, sizeof(build_vertex) * bs->vertex_cap);
+    }
+
+    value = &bs->vertices[bs->vertex_cnt++];
+
+    value->id = id;
+    // set the label table oid for this vertex
+    value->oid = oid;
+    // set the vertex properties
+    value->properties = insert_properties(bs, properties);
+}
+
+static int compare_build_vertices(const void *a, const void *b) {
+    graphid lhs = ((const build_vertex *)a)->id;
+    graphid rhs = ((const build_vertex *)b)->id;
+
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+static int compare_build_edges(const void *a, const void *b) {
+    graphid lhs = ((const build_edge *)a)->id;
+    graphid rhs = ((const build_edge *)b)->id;
+
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+// binary search the sorted vertices being built, returns -1 if the id isn't there
+static int64 find_build_vertex(graph_build_state *bs, graphid id) {
+    int64 low = 0;
+    int64 high = bs->vertex_cnt - 1;
+
+    while (low <= high) {
+        int64 mid = low + (high - low) / 2;
+
+        if (bs->vertices[mid].id == id)
+            return mid;
+        else if (bs->vertices[mid].id < id)
+            low = mid + 1;
+        else
+            high = mid - 1;
+    }
+
+    return -1;
+}
+
+// binary search a sorted id array, returns -1 if the id isn't there
+static int64 find_id(graphid *ids, int64 cnt, graphid id) {
+    int64 low = 0;
+    int64 high = cnt - 1;
+
+    while (low <= high) {
+        int64 mid = low + (high - low) / 2;
+
+        if (ids[mid] == id)
+            return mid;
+        else if (ids[mid] < id)
+            low = mid + 1;
+        else
+            high = mid - 1;
+    }
+
+    return -1;
+}
+
+/*
+ * Helper function to build the adjacency of the sorted vertices and edges.
+ * Each vertex gets one run of adjacency entries: the exiting edges, the
+ * entering edges and then the self loops.
+ */
+static void build_adjacency(graph_build_state *bs) {
+    uint32 *loop_cnts;
+    int64 *cursor;
+    int64 nvertices = Max(bs->vertex_cnt, 1);
+    int64 nedges = Max(bs->edge_cnt, 1);
+
+    bs->edge_starts = MemoryContextAllocHuge(bs->mcxt, sizeof(int64) * nedges);
+    bs->edge_ends = MemoryContextAllocHuge(bs->mcxt, sizeof(int64) * nedges);
+    bs->vertex_offsets = MemoryContextAllocHuge(bs->mcxt, sizeof(int64) * (bs->vertex_cnt + 1));
+    bs->vertex_out_cnts = MemoryContextAllocHuge(bs->mcxt, sizeof(uint32) * nvertices);
+    bs->vertex_in_cnts = MemoryContextAllocHuge(bs->mcxt, sizeof(uint32) * nvertices);
+    loop_cnts = MemoryContextAllocHuge(bs->mcxt, sizeof(uint32) * nvertices);
+
+    memset(bs->vertex_out_cnts, 0, sizeof(uint32) * nvertices);
+    memset(bs->vertex_in_cnts, 0, sizeof(uint32) * nvertices);
+    memset(loop_cnts, 0, sizeof(uint32) * nvertices);
+
+    // resolve the end vertices and count the edges of every vertex
+    for (int64 i = 0; i < bs->edge_cnt; i++) {
+        build_edge *be = &bs->edges[i];
+        int64 start = find_build_vertex(bs, be->start_id);
+        int64 end = find_build_vertex(bs, be->end_id);
+
+        if (start < 0 || end < 0)
+            ereport(ERROR, (errcode(ERRCODE_DATA_CORRUPTED),
+                            errmsg("edge " INT64_FORMAT " references a vertex that does not exist", be->id)));
+
+        bs->edge_starts[i] = start;
+        bs->edge_ends[i] = end;
+
+        if (start == end) {
+            loop_cnts[start]++;
+        } else {
+            bs->vertex_out_cnts[start]++;
+            bs->vertex_in_cnts[end]++;
+        }
+    }
+
+    // give every vertex its run of adjacency entries
+    bs->vertex_offsets[0] = 0;
+    for (int64 i = 0; i < bs->vertex_cnt; i++)
+        bs->vertex_offsets[i + 1] = bs->vertex_offsets[i] + bs->vertex_out_cnts[i] + bs->vertex_in_cnts[i] + loop_cnts[i];
+
+    bs->adjacency_cnt = bs->vertex_offsets[bs->vertex_cnt];
+    bs->adjacency_edges = MemoryContextAllocHuge(bs->mcxt, sizeof(int64) * Max(bs->adjacency_cnt, 1));
+    bs->adjacency_vertices = MemoryContextAllocHuge(bs->mcxt, sizeof(int64) * Max(bs->adjacency_cnt, 1));
+    bs->adjacency_labels = MemoryContextAllocHuge(bs->mcxt, sizeof(Oid) * Max(bs->adjacency_cnt, 1));
+
+    /*
+     * Fill in the runs. The cursor holds the next free out, in, and loop
+     * positions of each vertex.
+     */
+    cursor = MemoryContextAllocHuge(bs->mcxt, sizeof(int64) * 3 * nvertices);
+    for (int64 i = 0; i < bs->vertex_cnt; i++) {
+        cursor[i * 3] = bs->vertex_offsets[i];
+        cursor[i * 3 + 1] = bs->vertex_offsets[i] + bs->vertex_out_cnts[i];
+        cursor[i * 3 + 2] = bs->vertex_offsets[i] + bs->vertex_out_cnts[i] + bs->vertex_in_cnts[i];
+    }
+
+    for (int64 i = 0; i < bs->edge_cnt; i++) {
+        int64 start = bs->edge_starts[i];
+        int64 end = bs->edge_ends[i];
+        int64 pos;
+
+        if (start == end) {
+            pos = cursor[start * 3 + 2]++;
+            bs->adjacency_edges[pos] = i;
+            bs->adjacency_vertices[pos] = start;
+            bs->adjacency_labels[pos] = bs->edges[i].oid;
+        } else {
+            pos = cursor[start * 3]++;
+            bs->adjacency_edges[pos] = i;
+            bs->adjacency_vertices[pos] = end;
+            bs->adjacency_labels[pos] = bs->edges[i].oid;
+
+            pos = cursor[end * 3 + 1]++;
+            bs->adjacency_edges[pos] = i;
+            bs->adjacency_vertices[pos] = start;
+            bs->adjacency_labels[pos] = bs->edges[i].oid;
+        }
+    }
+
+    pfree(cursor);
+    pfree(loop_cnts);
+}
+
+// Helper routine to scan one label table into the image being built.
+static void load_label_table(graph_build_state *bs, TableScanDesc scan_desc, Oid oid, char kind) {
+    TupleDesc tupdesc = RelationGetDescr(scan_desc->rs_rd);
+    HeapTuple tuple;
+
+    Assert(kind == LABEL_TYPE_VERTEX || tupdesc->natts == 4);
+
+    while((tuple = heap_getnext(scan_desc, ForwardScanDirection)) != NULL) {
+        graphid id;
+        Datum properties;
+        bool isnull;
+
+        Assert(HeapTupleIsValid(tuple));
+
+        // id
+        id = DATUM_GET_GRAPHID(heap_getattr(tuple, 1, tupdesc, &isnull));
+
+        if (kind == LABEL_TYPE_VERTEX) {
+            // properties
+            properties = heap_getattr(tuple, 2, tupdesc, &isnull);
+
+            // insert vertex into the image
+            insert_vertex_entry(bs, id, oid, properties);
+        } else {
+            graphid start_id, end_id;
+
+            // start_id
+            start_id = DATUM_GET_GRAPHID(heap_getattr(tuple, 2, tupdesc, &isnull));
+            // end_id
+            end_id = DATUM_GET_GRAPHID(heap_getattr(tuple, 3, tupdesc, &isnull));
+            // properties
+            properties = heap_getattr(tuple, 4, tupdesc, &isnull);
+
+            // insert edge into the image
+            insert_edge(bs, id, properties, start_id, end_id, oid);
+        }
+    }
+}
+
+// helper routine to get the label tables of the graph, vertex labels first
+static List *get_label_tables(graph_context *ggctx, Snapshot snapshot, List **kinds) {
+    Oid graph_namespace_oid = get_namespace_oid(ggctx->graph_name, false);
+    char label_kinds[2] = {LABEL_TYPE_VERTEX, LABEL_TYPE_EDGE};
+    List *oids = NIL;
+
+    *kinds = NIL;
+
+    for (int i = 0; i < 2; i++) {
+        List *label_names = get_labels(snapshot, ggctx->graph_oid, label_kinds[i]);
+        ListCell *lc;
+
+        foreach (lc, label_names) {
+            char *label_name = lfirst(lc);
+
+            oids = lappend_oid(oids, get_relname_relid(label_name, graph_namespace_oid));
+            *kinds = lappend_int(*kinds, label_kinds[i]);
+        }
+    }
+
+    return oids;
+}
+
+/*
+ * Helper function to decide how many parallel workers to load the label
+ * tables with. Small graphs are loaded by the backend alone, as starting
+ * workers would take longer than the scans.
+ */
+static int get_graph_load_workers(List *relations) {
+    BlockNumber nblocks = 0;
+    ListCell *lc;
+
+    if (graph_load_workers == 0 || IsInParallelMode() || !IsUnderPostmaster)
+        return 0;
+
+    foreach (lc, relations)
+        nblocks += RelationGetNumberOfBlocks((Relation)lfirst(lc));
+
+    if (nblocks < GRAPH_LOAD_PARALLEL_MIN_BLOCKS)
+        return 0;
+
+    return Min(graph_load_workers, nblocks / GRAPH_LOAD_PARALLEL_MIN_BLOCKS);
+}
+
+/*
+ * Scan the label tables of a parallel graph load. The leader and the workers
+ * each take part in every scan, and collect what they read in their own build
+ * state.
+ */
+static void scan_label_tables(graph_load_shared *shared, graph_build_state *bs) {
+    graph_load_label *labels = (graph_load_label *)((char *)shared + shared->labels);
+    MemoryContext oldctx = MemoryContextSwitchTo(bs->mcxt);
+
+    for (int i = 0; i < shared->nlabels; i++) {
+        ParallelTableScanDesc pscan = (ParallelTableScanDesc)((char *)shared + labels[i].pscan);
+        Relation rel = table_open(labels[i].oid, AccessShareLock);
+        TableScanDesc scan_desc = table_beginscan_parallel(rel, pscan);
+
+        load_label_table(bs, scan_desc, labels[i].oid, labels[i].kind);
+
+        table_endscan(scan_desc);
+        table_close(rel, AccessShareLock);
+    }
+
+    MemoryContextSwitchTo(oldctx);
+}
+
+/*
+ * Entry point of the parallel workers loading a graph. The worker hands what
+ * it read back to the leader as one chunk: its vertices, its edges, and the
+ * property area they point into.
+ */
+void graph_load_worker_main(dsm_segment *seg, shm_toc *toc) {
+    graph_load_shared *shared = shm_toc_lookup(toc, GRAPH_LOAD_KEY_SHARED, false);
+    graph_load_result *result = &shared->results[ParallelWorkerNumber];
+    dsa_area *area = dsa_attach_in_place(shm_toc_lookup(toc, GRAPH_LOAD_KEY_DSA, false), seg);
+    graph_build_state *bs = create_build_state(CurrentMemoryContext);
+    Size vertices_len;
+    Size edges_len;
+    char *data;
+
+    scan_label_tables(shared, bs);
+
+    vertices_len = MAXALIGN(sizeof(build_vertex) * bs->vertex_cnt);
+    edges_len = MAXALIGN(sizeof(build_edge) * bs->edge_cnt);
+
+    result->data = dsa_allocate_extended(area, vertices_len + edges_len + bs->properties_len + 1, DSA_ALLOC_HUGE);
+    data = dsa_get_address(area, result->data);
+
+    memcpy(data, bs->vertices, sizeof(build_vertex) * bs->vertex_cnt);
+    memcpy(data + vertices_len, bs->edges, sizeof(build_edge) * bs->edge_cnt);
+    memcpy(data + vertices_len + edges_len, bs->properties, bs->properties_len);
+
+    result->vertex_cnt = bs->vertex_cnt;
+    result->edge_cnt = bs->edge_cnt;
+    result->properties_len = bs->properties_len;
+
+    MemoryContextDelete(bs->mcxt);
+    dsa_detach(area);
+}
+
+// append what a parallel worker loaded to the leader's build state
+static void merge_load_result(graph_build_state *bs, graph_load_result *result, char *data) {
+    build_vertex *vertices = (build_vertex *)data;
+    build_edge *edges = (build_edge *)(data + MAXALIGN(sizeof(build_vertex) * result->vertex_cnt));
+    char *properties = (char *)edges + MAXALIGN(sizeof(build_edge) * result->edge_cnt);
+    Size base = MAXALIGN(bs->properties_len);
+
+    // the worker's property offsets move up by where its area goes
+    if (base + result->properties_len > bs->properties_cap) {
+        while (base + result->properties_len > bs->properties_cap)
+            bs->properties_cap *= 2;
+
+        bs->properties = repalloc_huge(bs->properties, bs->properties_cap);
+    }
+
+    memcpy(bs->properties + base, properties, result->properties_len);
+    bs->properties_len = base + result->properties_len;
+
+    if (bs->vertex_cnt + result->vertex_cnt > bs->vertex_cap) {
+        while (bs->vertex_cnt + result->vertex_cnt > bs->vertex_cap)
+            bs->vertex_cap *= 2;
+
+        bs->vertices = repalloc_huge(bs->vertices, sizeof(build_vertex) * bs->vertex_cap);
+    }
+
+    for (int64 i = 0; i < result->vertex_cnt; i++) {
+        build_vertex *value = &bs->vertices[bs->vertex_cnt++];
+
+        *value = vertices[i];
+        value->properties += base;
+    }
+
+    if (bs->edge_cnt + result->edge_cnt > bs->edge_cap) {
+        while (bs->edge_cnt + result->edge_cnt > bs->edge_cap)
+            bs->edge_cap *= 2;
+
+        bs->edges = repalloc_huge(bs->edges, sizeof(build_edge) * bs->edge_cap);
+    }
+
+    for (int64 i = 0; i < result->edge_cnt; i++) {
+        build_edge *value = &bs->edges[bs->edge_cnt++];
+
+        *value = edges[i];
+        value->properties += base;
+    }
+}
+
+/*
+ * Load the label tables with the help of parallel workers. Each participant
+ * collects the part of every label table it scanned, and the leader merges
+ * the workers' parts into its own once they are done. If no worker could be
+ * started, the leader scans everything itself.
+ */
+static void load_label_tables_parallel(graph_build_state *bs, List *oids, List *kinds, List *relations, int nworkers) {
+    Snapshot snapshot = GetActiveSnapshot();
+    int nlabels = list_length(oids);
+    ParallelContext *pcxt;
+    graph_load_shared *shared;
+    graph_load_label *labels;
+    dsa_area *area = NULL;
+    Size shared_len;
+    Size labels_offset;
+    Size *pscan_lens;
+    ListCell *lc;
+    int i;
+
+    EnterParallelMode();
+
+    pcxt = CreateParallelContext("postgraph", "graph_load_worker_main", nworkers);
+
+    // the header and its results, the labels, then one scan per label
+    labels_offset = MAXALIGN(add_size(offsetof(graph_load_shared, results),
+                                      mul_size(sizeof(graph_load_result), nworkers)));
+    shared_len = add_size(labels_offset, MAXALIGN(mul_size(sizeof(graph_load_label), nlabels)));
+
+    pscan_lens = palloc(sizeof(Size) * nlabels);
+    i = 0;
+    foreach (lc, relations) {
+        pscan_lens[i] = MAXALIGN(table_parallelscan_estimate((Relation)lfirst(lc), snapshot));
+        shared_len = add_size(shared_len, pscan_lens[i++]);
+    }
+
+    shm_toc_estimate_chunk(&pcxt->estimator, shared_len);
+    shm_toc_estimate_chunk(&pcxt->estimator, dsa_minimum_size());
+    shm_toc_estimate_keys(&pcxt->estimator, 2);
+
+    InitializeParallelDSM(pcxt);
+
+    shared = shm_toc_allocate(pcxt->toc, shared_len);
+    shared->nlabels = nlabels;
+    shared->nworkers = nworkers;
+    shared->labels = labels_offset;
+
+    for (i = 0; i < nworkers; i++) {
+        shared->results[i].data = InvalidDsaPointer;
+        shared->results[i].vertex_cnt = 0;
+        shared->results[i].edge_cnt = 0;
+        shared->results[i].properties_len = 0;
+    }
+
+    labels = (graph_load_label *)((char *)shared + labels_offset);
+    shared_len = labels_offset + MAXALIGN(sizeof(graph_load_label) * nlabels);
+
+    for (i = 0; i < nlabels; i++) {
+        Relation rel = list_nth(relations, i);
+
+        labels[i].oid = list_nth_oid(oids, i);
+        labels[i].kind = (char)list_nth_int(kinds, i);
+        labels[i].pscan = shared_len;
+
+        table_parallelscan_initialize(rel, (ParallelTableScanDesc)((char *)shared + shared_len), snapshot);
+        shared_len += pscan_lens[i];
+    }
+
+    shm_toc_insert(pcxt->toc, GRAPH_LOAD_KEY_SHARED, shared);
+
+    // without a dsm segment there are no workers, so no results either
+    if (pcxt->seg != NULL) {
+        void *area_space = shm_toc_allocate(pcxt->toc, dsa_minimum_size());
+
+        area = dsa_create_in_place(area_space, dsa_minimum_size(), LWTRANCHE_PARALLEL_QUERY_DSA, pcxt->seg);
+        shm_toc_insert(pcxt->toc, GRAPH_LOAD_KEY_DSA, area_space);
+    }
+
+    LaunchParallelWorkers(pcxt);
+
+    // the leader does its share of the scans
+    scan_label_tables(shared, bs);
+
+    WaitForParallelWorkersToFinish(pcxt);
+
+    for (i = 0; i < pcxt->nworkers_launched; i++) {
+        graph_load_result *result = &shared->results[i];
+
+        if (DsaPointerIsValid(result->data))
+            merge_load_result(bs, result, dsa_get_address(area, result->data));
+    }
+
+    if (area != NULL)
+        dsa_detach(area);
+
+    DestroyParallelContext(pcxt);
+    ExitParallelMode();
+
+    pfree(pscan_lens);
+}
+
+/*
+ * Helper function to load the graph into the build state: all vertices, all
+ * edges, sorted by id, and their adjacency. The label tables are scanned by
+ * parallel workers when postgraph.graph_load_workers allows it and the graph
+ * is large enough.
+ */
+static void load_graph(graph_context *ggctx, graph_build_state *bs) {
+    MemoryContext oldctx = MemoryContextSwitchTo(bs->mcxt);
+    Snapshot snapshot = GetActiveSnapshot();
+    List *relations = NIL;
+    List *kinds = NIL;
+    List *oids;
+    ListCell *lc;
+    int nworkers;
+
+    oids = get_label_tables(ggctx, snapshot, &kinds);
+
+    foreach (lc, oids)
+        relations = lappend(relations, table_open(lfirst_oid(lc), ShareLock));
+
+    nworkers = get_graph_load_workers(relations);
+
+    if (nworkers > 0) {
+        load_label_tables_parallel(bs, oids, kinds, relations, nworkers);
+    } else {
+        ListCell *lc2;
+
+        forboth (lc, relations, lc2, kinds) {
+            Relation rel = lfirst(lc);
+            TableScanDesc scan_desc = table_beginscan(rel, snapshot, 0, NULL);
+
+            load_label_table(bs, scan_desc, RelationGetRelid(rel), (char)lfirst_int(lc2));
+
+            table_endscan(scan_desc);
+        }
+    }
+
+    foreach (lc, relations)
+        table_close(lfirst(lc), ShareLock);
+
+    qsort(bs->vertices, bs->vertex_cnt, sizeof(build_vertex), compare_build_vertices);
+    qsort(bs->edges, bs->edge_cnt, sizeof(build_edge), compare_build_edges);
+
+    build_adjacency(bs);
+
+    MemoryContextSwitchTo(oldctx);
+}
+
+/*
+ * Compute the layout of the image for the build state, filling in the counts
+ * and offsets of the passed header. Returns the total size of the image.
+ */
+static Size compute_image_size(graph_build_state *bs, graph_image *layout) {
+    Size size = MAXALIGN(sizeof(graph_image));
+    int64 nvertices = bs->vertex_cnt;
+    int64 nedges = bs->edge_cnt;
+    int64 nadjacency = bs->adjacency_cnt;
+
+    layout->vertex_cnt = nvertices;
+    layout->edge_cnt = nedges;
+    layout->adjacency_cnt = nadjacency;
+
+#define IMAGE_ARRAY(field, len) \
+    do { layout->field = size; size += MAXALIGN(len); } while (0)
+
+    IMAGE_ARRAY(vertex_ids, sizeof(graphid) * nvertices);
+    IMAGE_ARRAY(vertex_oids, sizeof(Oid) * nvertices);
+    IMAGE_ARRAY(vertex_properties, sizeof(Size) * nvertices);
+    IMAGE_ARRAY(vertex_offsets, sizeof(int64) * (nvertices + 1));
+    IMAGE_ARRAY(vertex_out_cnts, sizeof(uint32) * nvertices);
+    IMAGE_ARRAY(vertex_in_cnts, sizeof(uint32) * nvertices);
+    IMAGE_ARRAY(edge_ids, sizeof(graphid) * nedges);
+    IMAGE_ARRAY(edge_oids, sizeof(Oid) * nedges);
+    IMAGE_ARRAY(edge_starts, sizeof(int64) * nedges);
+    IMAGE_ARRAY(edge_ends, sizeof(int64) * nedges);
+    IMAGE_ARRAY(edge_properties, sizeof(Size) * nedges);
+    IMAGE_ARRAY(adjacency_edges, sizeof(int64) * nadjacency);
+    IMAGE_ARRAY(adjacency_vertices, sizeof(int64) * nadjacency);
+    IMAGE_ARRAY(adjacency_labels, sizeof(Oid) * nadjacency);
+    IMAGE_ARRAY(properties, bs->properties_len);
+
+#undef IMAGE_ARRAY
+
+    layout->size = size;
+
+    return size;
+}
+
+// copy the build state into an image of compute_image_size() bytes
+static void write_image(graph_image *image, graph_build_state *bs, Oid graph_oid, uint64 completion_count) {
+    Snapshot snap = GetActiveSnapshot();
+    char *base = (char *)image;
+    graphid *vertex_ids;
+    Oid *vertex_oids;
+    Size *vertex_properties;
+    graphid *edge_ids;
+    Oid *edge_oids;
+    Size *edge_properties;
+
+    compute_image_size(bs, image);
+
+    pg_atomic_init_u32(&image->refcount, 0);
+    image->graph_oid = graph_oid;
+    image->completion_count = completion_count;
+    image->xmin = snap->xmin;
+    image->xmax = snap->xmax;
+    image->curcid = snap->curcid;
+
+    // split the vertices and edges up into their arrays
+    vertex_ids = (graphid *)(base + image->vertex_ids);
+    vertex_oids = (Oid *)(base + image->vertex_oids);
+    vertex_properties = (Size *)(base + image->vertex_properties);
+    for (int64 i = 0; i < bs->vertex_cnt; i++) {
+        vertex_ids[i] = bs->vertices[i].id;
+        vertex_oids[i] = bs->vertices[i].oid;
+        vertex_properties[i] = bs->vertices[i].properties;
+    }
+
+    edge_ids = (graphid *)(base + image->edge_ids);
+    edge_oids = (Oid *)(base + image->edge_oids);
+    edge_properties = (Size *)(base + image->edge_properties);
+    for (int64 i = 0; i < bs->edge_cnt; i++) {
+        edge_ids[i] = bs->edges[i].id;
+        edge_oids[i] = bs->edges[i].oid;
+        edge_properties[i] = bs->edges[i].properties;
+    }
+
+    memcpy(base + image->vertex_offsets, bs->vertex_offsets, sizeof(int64) * (bs->vertex_cnt + 1));
+    memcpy(base + image->vertex_out_cnts, bs->vertex_out_cnts, sizeof(uint32) * bs->vertex_cnt);
+    memcpy(base + image->vertex_in_cnts, bs->vertex_in_cnts, sizeof(uint32) * bs->vertex_cnt);
+    memcpy(base + image->edge_starts, bs->edge_starts, sizeof(int64) * bs->edge_cnt);
+    memcpy(base + image->edge_ends, bs->edge_ends, sizeof(int64) * bs->edge_cnt);
+    memcpy(base + image->adjacency_edges, bs->adjacency_edges, sizeof(int64) * bs->adjacency_cnt);
+    memcpy(base + image->adjacency_vertices, bs->adjacency_vertices, sizeof(int64) * bs->adjacency_cnt);
+    memcpy(base + image->adjacency_labels, bs->adjacency_labels, sizeof(Oid) * bs->adjacency_cnt);
+    memcpy(base + image->properties, bs->properties, bs->properties_len);
+}
+
+// helper function to release the image and the changes of a GRAPH global context
+static void release_graph_image(graph_context *ggctx)
+{
+    // release the image, shared images are freed by their last user
+    if (DsaPointerIsValid(ggctx->shared_image))
+        release_shared_image(ggctx->shared_image);
+    else if (ggctx->image != NULL)
+        pfree(ggctx->image);
+
+    ggctx->shared_image = InvalidDsaPointer;
+    ggctx->image = NULL;
+    ggctx->vertex_ids = NULL;
+    ggctx->vertex_oids = NULL;
+    ggctx->vertex_properties = NULL;
+    ggctx->vertex_offsets = NULL;
+    ggctx->vertex_out_cnts = NULL;
+    ggctx->vertex_in_cnts = NULL;
+    ggctx->edge_ids = NULL;
+    ggctx->edge_oids = NULL;
+    ggctx->edge_starts = NULL;
+    ggctx->edge_ends = NULL;
+    ggctx->edge_properties = NULL;
+    ggctx->adjacency_edges = NULL;
+    ggctx->adjacency_vertices = NULL;
+    ggctx->adjacency_labels = NULL;
+    ggctx->properties = NULL;
+
+    // free the changes made since the image was built
+    if (ggctx->delta != NULL)
+        MemoryContextDelete(ggctx->delta->mcxt);
+    ggctx->delta = NULL;
+
+    // the extracted weights are only valid for the image
+    while (ggctx->weights != NULL) {
+        edge_weights *next = ggctx->weights->next;
+
+        pfree(ggctx->weights->property);
+        pfree(ggctx->weights->values);
+        pfree(ggctx->weights);
+
+        ggctx->weights = next;
+    }
+}
+
+/*
+ * Helper function to free the entire specified GRAPH global context. After
+ * running this you should not use the pointer in ggctx.
+ */
+static void free_graph_context(graph_context *ggctx)
+{
+    // don't do anything if NULL
+    if (!ggctx)
+        return;
+
+    // free the graph name
+    pfree(ggctx->graph_name);
+    ggctx->graph_name = NULL;
+
+    ggctx->graph_oid = InvalidOid;
+    ggctx->next = NULL;
+
+    release_graph_image(ggctx);
+
+    pfree(ggctx);
+    ggctx = NULL;
+}
+
+/*
+ * It will create the
+ * context for the graph specified, provided it isn't already built and valid.
+ * During processing it will free (delete) all invalid GRAPH contexts. It
+ * returns the GRAPH global context for the specified graph.
+ *
+ * A GRAPH global context that is still valid is brought up to date with the
+ * changes the current transaction made since it was last used.
+ *
+ * With postgraph.shared_graph_cache enabled, the graph is first looked up in
+ * the shared graph cache. Only when no backend has built it for the active
+ * snapshot yet is it loaded here, and then published for the others to use.
+ */
+graph_context *manage_graph_contexts(char *graph_name, Oid graph_oid) {
+    graph_context *new_ggctx = NULL;
+    graph_context *curr_ggctx = NULL;
+    graph_context *prev_ggctx = NULL;
+    graph_build_state *bs = NULL;
+    Snapshot snap = GetActiveSnapshot();
+
+    // we need a higher context, or one that isn't destroyed by SRF exit
+    MemoryContext oldctx = MemoryContextSwitchTo(TopMemoryContext);
+
+    // free the invalidated GRAPH global contexts first
+    prev_ggctx = NULL;
+    curr_ggctx = global_graph_contexts;
+    while (curr_ggctx) {
+        graph_context *next_ggctx = curr_ggctx->next;
+        bool invalid = is_ggctx_invalid(curr_ggctx);
+
+        // applying the changes may find that the graph is better off reloaded
+        if (!invalid && curr_ggctx->completion_count != 0) {
+            apply_graph_changes(curr_ggctx, snap->curcid);
+            invalid = curr_ggctx->stale;
+        }
+
+        if (invalid) {
+            if (prev_ggctx == NULL)
+                global_graph_contexts = next_ggctx;
+            else
+                prev_ggctx->next = curr_ggctx->next;
+
+            free_graph_context(curr_ggctx);
+        } else {
+            prev_ggctx = curr_ggctx;
+        }
+
+        curr_ggctx = next_ggctx;
+    }
+
+    curr_ggctx = global_graph_contexts;
+    while (curr_ggctx) {
+        if (curr_ggctx->graph_oid == graph_oid) {
+            MemoryContextSwitchTo(oldctx);
+            return curr_ggctx;
+        }
+        curr_ggctx = curr_ggctx->next;
+    }
+
+    new_ggctx = palloc0(sizeof(graph_context));
+
+    new_ggctx->graph_name = pstrdup(graph_name);
+    new_ggctx->graph_oid = graph_oid;
+
+    new_ggctx->completion_count = get_snapshot_completion_count(snap);
+    new_ggctx->xmin = snap->xmin;
+    new_ggctx->xmax = snap->xmax;
+
+    new_ggctx->image = NULL;
+    new_ggctx->shared_image = InvalidDsaPointer;
+    new_ggctx->delta = NULL;
+    new_ggctx->weights = NULL;
+
+    /*
+     * A shared image holds only what every transaction sees. It can be used if
+     * this transaction's own changes, if any, can be applied on top of it.
+     */
+    if (shared_graph_cache && shared_state != NULL && new_ggctx->completion_count != 0 &&
+        are_changes_logged(FirstCommandId, snap->curcid) && attach_shared_image(new_ggctx)) {
+        new_ggctx->curcid = FirstCommandId;
+        new_ggctx->applied = 0;
+        apply_graph_changes(new_ggctx, snap->curcid);
+
+        // too many changes to carry on top of the image, load it instead
+        if (new_ggctx->stale) {
+            release_graph_image(new_ggctx);
+            new_ggctx->stale = false;
+        }
+    }
+
+    if (new_ggctx->image == NULL) {
+        ereport(DEBUG1, (errmsg("loading graph \"%s\" into memory", graph_name)));
+
+        // build in the caller's context, so nothing is left behind on error
+        bs = create_build_state(oldctx);
+
+        load_graph(new_ggctx, bs);
+
+        // the scans saw the changes this transaction made before the snapshot
+        new_ggctx->curcid = snap->curcid;
+        new_ggctx->applied = count_applied_changes(snap->curcid);
+
+        // only publish what other transactions can see as well
+        if (shared_graph_cache && shared_state != NULL && new_ggctx->completion_count != 0 &&
+            snap->curcid == FirstCommandId) {
+            publish_shared_image(new_ggctx, bs);
+        } else {
+            graph_image layout;
+            graph_image *image = MemoryContextAllocHuge(TopMemoryContext, compute_image_size(bs, &layout));
+
+            write_image(image, bs, graph_oid, new_ggctx->completion_count);
+            set_graph_context_image(new_ggctx, image);
+        }
+
+        MemoryContextDelete(bs->mcxt);
+    }
+
+    // only link the context in once it is complete
+    new_ggctx->next = global_graph_contexts;
+    global_graph_contexts = new_ggctx;
+
+    MemoryContextSwitchTo(oldctx);
+
+    return new_ggctx;
+}
+
+/*
+ * Log a change the executors made to a vertex or edge label table, so that
+ * graphs already in memory can be brought forward instead of reloaded. The
+ * tuple is the new version of the entity, or the deleted one. The cid must be
+ * the command the tuple was written with.
+ */
+void log_graph_change(Relation rel, HeapTuple tuple, CommandId cid, graph_change_kind kind) {
+    label_cache_data *label = search_label_relation_cache(RelationGetRelid(rel));
+    TupleDesc tupdesc = RelationGetDescr(rel);
+    MemoryContext oldctx;
+    graph_change *change;
+    bool isnull;
+
+    // not a label table, nothing to track
+    if (label == NULL)
+        return;
+
+    // once changes are lost, graphs can no longer be brought forward
+    if (change_log_overflow)
+        return;
+
+    if (change_log_cnt == GRAPH_CHANGE_LOG_MAX_SIZE) {
+        change_log_overflow = true;
+        return;
+    }
+
+    oldctx = MemoryContextSwitchTo(TopTransactionContext);
+
+    if (change_log == NULL) {
+        change_log_cap = GRAPH_CHANGE_LOG_INITIAL_SIZE;
+        change_log = palloc(sizeof(graph_change) * change_log_cap);
+    } else if (change_log_cnt == change_log_cap) {
+        change_log_cap *= 2;
+        change_log = repalloc(change_log, sizeof(graph_change) * change_log_cap);
+    }
+
+    change = &change_log[change_log_cnt++];
+
+    change->graph_oid = label->graph;
+    change->kind = kind;
+    change->label_kind = label->kind;
+    change->cid = cid;
+    change->nest_level = GetCurrentTransactionNestLevel();
+    change->label_oid = RelationGetRelid(rel);
+    change->id = DATUM_GET_GRAPHID(heap_getattr(tuple, 1, tupdesc, &isnull));
+    change->start_id = 0;
+    change->end_id = 0;
+    change->properties = (Datum)0;
+
+    if (label->kind == LABEL_KIND_EDGE) {
+        change->start_id = DATUM_GET_GRAPHID(heap_getattr(tuple, 2, tupdesc, &isnull));
+        change->end_id = DATUM_GET_GRAPHID(heap_getattr(tuple, 3, tupdesc, &isnull));
+    }
+
+    if (kind != GRAPH_CHANGE_DELETE) {
+        int attnum = (label->kind == LABEL_KIND_EDGE) ? 4 : 2;
+        Datum properties = heap_getattr(tuple, attnum, tupdesc, &isnull);
+
+        change->properties = PointerGetDatum(PG_DETOAST_DATUM_COPY(properties));
+    }
+
+    MemoryContextSwitchTo(oldctx);
+}
+
+/*
+ * Record that the current command writes to the label table relid in a way
+ * the executors don't log, such as plain SQL DML, COPY, TRUNCATE or dropping
+ * the label. Graphs can't be brought forward past such a command.
+ */
+void mark_unlogged_graph_write(Oid relid) {
+    CommandId cid = GetCurrentCommandId(false);
+    MemoryContext oldctx;
+
+    if (!IsTransactionState() || search_label_relation_cache(relid) == NULL)
+        return;
+
+    if (unlogged_write_cids != NIL && (CommandId)llast_int(unlogged_write_cids) == cid)
+        return;
+
+    oldctx = MemoryContextSwitchTo(TopTransactionContext);
+    unlogged_write_cids = lappend_int(unlogged_write_cids, (int)cid);
+    MemoryContextSwitchTo(oldctx);
+}
+
+// mark the label table named by relation, if there is one, as written unlogged
+static void mark_unlogged_range_var(RangeVar *relation) {
+    Oid relid = RangeVarGetRelid(relation, NoLock, true);
+
+    if (OidIsValid(relid))
+        mark_unlogged_graph_write(relid);
+}
+
+// plans that modify label tables directly write changes the log doesn't have
+static void graph_executor_start(QueryDesc *queryDesc, int eflags) {
+    PlannedStmt *pstmt = queryDesc->plannedstmt;
+    ListCell *lc;
+
+    if (!(eflags & EXEC_FLAG_EXPLAIN_ONLY)) {
+        foreach (lc, pstmt->resultRelations) {
+            RangeTblEntry *rte = rt_fetch(lfirst_int(lc), pstmt->rtable);
+
+            mark_unlogged_graph_write(rte->relid);
+        }
+    }
+
+    if (prev_executor_start_hook)
+        prev_executor_start_hook(queryDesc, eflags);
+    else
+        standard_ExecutorStart(queryDesc, eflags);
+}
+
+// utility commands that change the contents of label tables
+static void graph_process_utility(PlannedStmt *pstmt, const char *queryString, bool readOnlyTree,
+                                  ProcessUtilityContext context, ParamListInfo params,
+                                  QueryEnvironment *queryEnv, DestReceiver *dest,
+                                  QueryCompletion *qc) {
+    Node *stmt = pstmt->utilityStmt;
+    ListCell *lc;
 
-// internal data structures implementation 
+    if (IsA(stmt, CopyStmt) && ((CopyStmt *)stmt)->is_from && ((CopyStmt *)stmt)->relation != NULL) {
+        mark_unlogged_range_var(((CopyStmt *)stmt)->relation);
+    } else if (IsA(stmt, TruncateStmt)) {
+        foreach (lc, ((TruncateStmt *)stmt)->relations)
+            mark_unlogged_range_var(lfirst(lc));
+    } else if (IsA(stmt, DropStmt) && ((DropStmt *)stmt)->removeType == OBJECT_TABLE) {
+        foreach (lc, ((DropStmt *)stmt)->objects)
+            mark_unlogged_range_var(makeRangeVarFromNameList(lfirst(lc)));
+    }
 
-// vertex entry for the vertex_hastable 
-typedef struct vertex_entry
-{
-    graphid id;             // vertex id, it is also the hash key 
-    Queue *in;         // List of entering edges graphids (int64) 
-    Queue *out;        // List of exiting edges graphids (int64) 
-    Queue *loop;       // List of selfloop edges graphids (int64) 
-    Oid oid;    // the label table oid 
-    Datum properties;       // datum property value 
-} vertex_entry;
-
-// edge entry for the edge_hashtable 
-typedef struct edge_entry
-{
-    graphid id;               // edge id, it is also the hash key 
-    Oid oid;      // the label table oid 
-    Datum properties;         // datum property value 
-    graphid start_id;       // start vertex 
-    graphid end_id;         // end vertex 
-} edge_entry;
+    if (prev_process_utility_hook)
+        prev_process_utility_hook(pstmt, queryString, readOnlyTree, context, params, queryEnv, dest, qc);
+    else
+        standard_ProcessUtility(pstmt, queryString, readOnlyTree, context, params, queryEnv, dest, qc);
+}
 
 /*
- * GRAPH global context per graph. They are chained together via next.
- * Be aware that the global pointer will point to the root BUT that
- * the root will change as new graphs are added to the top.
+ * Check that the changes the current transaction made to label tables in the
+ * commands [from, to) are all in the log, so none of them wrote to a label
+ * table without going through the executors.
  */
-typedef struct graph_context
-{
-    char *graph_name;              // graph name 
-    Oid graph_oid;                 // graph oid for searching 
-    HTAB *vertex_hashtable;        // hashtable to hold vertex edge lists 
-    HTAB *edge_hashtable;          // hashtable to hold edge to vertex map 
-    TransactionId xmin;            // transaction ids for this graph 
-    TransactionId xmax;
-    CommandId curcid;              // currentCommandId graph was created with 
-    int64 vertex_cnt;     // number of loaded vertices in this graph 
-    int64 edge_cnt;        // number of loaded edges in this graph 
-    Queue *vertices;         // vertices for vertex hashtable cleanup 
-    struct graph_context *next; // next graph 
-} graph_context;
+static bool are_changes_logged(CommandId from, CommandId to) {
+    ListCell *lc;
 
-// global variable to hold the per process GRAPH global context 
-static graph_context *global_graph_contexts = NULL;
+    if (from >= to)
+        return true;
 
-// declarations 
-// GRAPH global context functions 
-static void free_graph_context(graph_context *ggctx);
-static void create_hashtables(graph_context *ggctx);
-static void load_hashtables(graph_context *ggctx);
-static void load_vertex_hashtable(graph_context *ggctx);
-static void load_edge_hashtable(graph_context *ggctx);
-static void freeze_hashtables(graph_context *ggctx);
-static List *get_labels(Snapshot snapshot, Oid graph_oid, char label_type);
-static bool insert_edge(graph_context *ggctx, graphid id, Datum properties, graphid start_id, graphid end_id, Oid oid);
-static void insert_vertex(graph_context *ggctx, graphid start_id, graphid end_id, graphid id);
-static void insert_vertex_entry(graph_context *ggctx, graphid id, Oid oid, Datum properties);
+    if (change_log_overflow)
+        return false;
 
-//XXX: To Be Removed
-bool is_ggctx_invalid(graph_context *ggctx) {
-    Snapshot snap = GetActiveSnapshot();
-    return (ggctx->xmin != snap->xmin || ggctx->xmax != snap->xmax || ggctx->curcid != snap->curcid);
+    foreach (lc, unlogged_write_cids) {
+        CommandId cid = (CommandId)lfirst_int(lc);
+
+        if (cid >= from && cid < to)
+            return false;
+    }
+
+    return true;
+}
+
+// count the leading entries of the change log that were made before to
+static int count_applied_changes(CommandId to) {
+    int i = 0;
+
+    while (i < change_log_cnt && change_log[i].cid < to)
+        i++;
 
+    return i;
 }
+
 /*
- * Helper function to create the global vertex and edge hashtables. One
- * hashtable will hold the vertex, its edges (both incoming and exiting) as a
- * list, and its properties datum. The other hashtable will hold the edge, its
- * properties datum, and its source and target vertex.
+ * Apply the logged changes made before the command to to the GRAPH global
+ * context. The caller has checked that they are all logged.
  */
-static void create_hashtables(graph_context *ggctx)
-{
-    HASHCTL vertex_ctl;
-    HASHCTL edge_ctl;
+static void apply_graph_changes(graph_context *ggctx, CommandId to) {
+    int applied = 0;
+    int i;
+
+    for (i = ggctx->applied; i < change_log_cnt && change_log[i].cid < to; i++) {
+        if (change_log[i].graph_oid == ggctx->graph_oid && change_log[i].kind != GRAPH_CHANGE_NONE) {
+            apply_graph_change(ggctx, &change_log[i]);
+            applied++;
+        }
+    }
 
-    // initialize the vertex hashtable 
-    MemSet(&vertex_ctl, 0, sizeof(vertex_ctl));
-    vertex_ctl.keysize = sizeof(int64);
-    vertex_ctl.entrysize = sizeof(vertex_entry);
-    vertex_ctl.hash = tag_hash;
-    ggctx->vertex_hashtable = hash_create(VERTEX_HTAB_NAME, VERTEX_HTAB_INITIAL_SIZE, &vertex_ctl, HASH_ELEM | HASH_FUNCTION);
+    if (applied > 0)
+        ereport(DEBUG1, (errmsg("applied %d changes to graph \"%s\"", applied, ggctx->graph_name)));
 
-    // initialize the edge hashtable 
-    MemSet(&edge_ctl, 0, sizeof(edge_ctl));
-    edge_ctl.keysize = sizeof(int64);
-    edge_ctl.entrysize = sizeof(edge_entry);
-    edge_ctl.hash = tag_hash;
-    ggctx->edge_hashtable = hash_create(EDGE_HTAB_NAME, EDGE_HTAB_INITIAL_SIZE, &edge_ctl, HASH_ELEM | HASH_FUNCTION);
-}
+    ggctx->applied = i;
+    ggctx->curcid = Max(ggctx->curcid, to);
 
-// helper function to get a List of all label names for the specified graph 
-static List *get_labels(Snapshot snapshot, Oid graph_oid, char label_type) {
-    List *labels = NIL;
-    ScanKeyData scan_keys[2];
-    Relation ag_label;
-    TableScanDesc scan_desc;
-    HeapTuple tuple;
-    TupleDesc tupdesc;
+    // past a point, loading the graph again is cheaper than carrying the changes
+    if (ggctx->delta != NULL &&
+        ggctx->delta->changes > Max(GRAPH_DELTA_MIN_CHANGES, (ggctx->vertex_cnt + ggctx->edge_cnt) / 4))
+        ggctx->stale = true;
+}
 
-    // we need a valid snapshot 
-    Assert(snapshot != NULL);
+// apply one logged change to the GRAPH global context
+static void apply_graph_change(graph_context *ggctx, graph_change *change) {
+    graph_delta *delta = get_graph_delta(ggctx);
+    MemoryContext oldctx = MemoryContextSwitchTo(delta->mcxt);
 
-    // setup scan keys to get all edges for the given graph oid 
-    ScanKeyInit(&scan_keys[1], Anum_ag_label_graph, BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(graph_oid));
-    ScanKeyInit(&scan_keys[0], Anum_ag_label_kind, BTEqualStrategyNumber, F_CHAREQ, CharGetDatum(label_type));
+    delta->changes++;
 
-    // setup the table to be scanned, ag_label in this case 
-    ag_label = table_open(ag_label_relation_id(), ShareLock);
-    scan_desc = table_beginscan(ag_label, snapshot, 2, scan_keys);
+    if (change->label_kind == LABEL_KIND_VERTEX) {
+        if (change->kind == GRAPH_CHANGE_INSERT) {
+            delta_new_vertex *nv;
 
-    // get the tupdesc - we don't need to release this one 
-    tupdesc = RelationGetDescr(ag_label);
+            if (delta->new_vertex_cnt == delta->new_vertex_cap) {
+                delta->new_vertex_cap *= 2;
+                delta->new_vertices = repalloc_huge(delta->new_vertices, sizeof(delta_new_vertex) * delta->new_vertex_cap);
+            }
 
-    // get all of the label names 
-    while((tuple = heap_getnext(scan_desc, ForwardScanDirection)) != NULL) {
-        Name label;
-        bool is_null = false;
+            nv = &delta->new_vertices[delta->new_vertex_cnt];
+            nv->id = change->id;
+            nv->oid = change->label_oid;
+            nv->properties = insert_delta_properties(delta, change->properties);
 
-        // something is wrong if this tuple isn't valid 
-        Assert(HeapTupleIsValid(tuple));
-        // get the label name 
-        label = DatumGetName(heap_getattr(tuple, Anum_ag_label_name, tupdesc, &is_null));
-        Assert(!is_null);
-        // add it to our list 
-        labels = lappend(labels, label);
+            set_delta_id(delta->vertex_ids, change->id, ggctx->vertex_cnt + delta->new_vertex_cnt, false);
+            delta->new_vertex_cnt++;
+        } else {
+            int64 index = get_vertex_index(ggctx, change->id);
+
+            if (index < 0) {
+                ggctx->stale = true;
+            } else if (change->kind == GRAPH_CHANGE_DELETE) {
+                set_delta_id(delta->vertex_ids, change->id, index, true);
+            } else {
+                delta_vertex *dv = get_delta_vertex(ggctx, index, true);
+
+                dv->properties = insert_delta_properties(delta, change->properties);
+                dv->has_properties = true;
+            }
+        }
+    } else {
+        // a changed edge is deleted and created again under a new index
+        if (change->kind != GRAPH_CHANGE_INSERT && !delete_delta_edge(ggctx, change->id))
+            ggctx->stale = true;
+
+        if (change->kind != GRAPH_CHANGE_DELETE &&
+            !insert_delta_edge(ggctx, change->id, change->start_id, change->end_id,
+                               change->label_oid, change->properties))
+            ggctx->stale = true;
     }
 
-    // close up scan 
-    table_endscan(scan_desc);
-    table_close(ag_label, ShareLock);
+    MemoryContextSwitchTo(oldctx);
+}
 
-    return labels;
+// get the changes of the GRAPH global context, creating them on first use
+static graph_delta *get_graph_delta(graph_context *ggctx) {
+    MemoryContext mcxt;
+    graph_delta *delta;
+    HASHCTL ctl;
+
+    if (ggctx->delta != NULL)
+        return ggctx->delta;
+
+    mcxt = AllocSetContextCreate(TopMemoryContext, GRAPH_DELTA_CONTEXT_NAME, ALLOCSET_DEFAULT_SIZES);
+    delta = MemoryContextAllocZero(mcxt, sizeof(graph_delta));
+    delta->mcxt = mcxt;
+
+    MemSet(&ctl, 0, sizeof(ctl));
+    ctl.keysize = sizeof(graphid);
+    ctl.entrysize = sizeof(delta_id);
+    ctl.hcxt = mcxt;
+    delta->vertex_ids = hash_create(DELTA_VERTEX_ID_HTAB_NAME, DELTA_HTAB_INITIAL_SIZE, &ctl,
+                                    HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+    MemSet(&ctl, 0, sizeof(ctl));
+    ctl.keysize = sizeof(graphid);
+    ctl.entrysize = sizeof(delta_id);
+    ctl.hcxt = mcxt;
+    delta->edge_ids = hash_create(DELTA_EDGE_ID_HTAB_NAME, DELTA_HTAB_INITIAL_SIZE, &ctl,
+                                  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+    MemSet(&ctl, 0, sizeof(ctl));
+    ctl.keysize = sizeof(int64);
+    ctl.entrysize = sizeof(delta_vertex);
+    ctl.hcxt = mcxt;
+    delta->vertices = hash_create(DELTA_VERTEX_HTAB_NAME, DELTA_HTAB_INITIAL_SIZE, &ctl,
+                                  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+    delta->new_vertex_cap = DELTA_HTAB_INITIAL_SIZE;
+    delta->new_vertices = MemoryContextAlloc(mcxt, sizeof(delta_new_vertex) * delta->new_vertex_cap);
+
+    delta->new_edge_cap = DELTA_HTAB_INITIAL_SIZE;
+    delta->new_edges = MemoryContextAlloc(mcxt, sizeof(delta_new_edge) * delta->new_edge_cap);
+
+    delta->properties_cap = DELTA_HTAB_INITIAL_SIZE * 64;
+    delta->properties = MemoryContextAlloc(mcxt, delta->properties_cap);
+
+    ggctx->delta = delta;
+
+    return delta;
 }
 
-/*
- * Helper function to insert one edge/edge->vertex, key/value pair, in the
- * current GRAPH global edge hashtable.
- */
-static bool insert_edge(graph_context *ggctx, graphid id, Datum properties, graphid start_id, graphid end_id, Oid oid)
-{
-    edge_entry *value = NULL;
-    bool found = false;
+// copy a properties datum into the property area of the changes
+static Size insert_delta_properties(graph_delta *delta, Datum properties) {
+    struct varlena *props = PG_DETOAST_DATUM(properties);
+    Size len = VARSIZE(props);
+    Size offset = MAXALIGN(delta->properties_len);
 
-    // search for the edge 
-    value = (edge_entry *)hash_search(ggctx->edge_hashtable, (void *)&id, HASH_ENTER, &found);
-    /*
-     * If we found the key, either we have a duplicate, or we made a mistake and
-     * inserted it already. Either way, this isn't good so don't insert it and
-     * return false. Likewise, if the value returned is NULL, don't do anything,
-     * just return false. This way the caller can decide what to do.
-     */
-    if (found || value == NULL)
-        return false;
+    if (offset + len > delta->properties_cap) {
+        while (offset + len > delta->properties_cap)
+            delta->properties_cap *= 2;
 
-    // not sure if we really need to zero out the entry, as we set everything 
-    MemSet(value, 0, sizeof(edge_entry));
+        delta->properties = repalloc_huge(delta->properties, delta->properties_cap);
+    }
 
-    /*
-     * Set the edge id - this is important as this is the hash key value used
-     * for hash function collisions.
-     */
-    value->id = id;
-    value->properties = properties;
-    value->start_id = start_id;
-    value->end_id = end_id;
-    value->oid = oid;
+    memcpy(delta->properties + offset, props, len);
+    delta->properties_len = offset + len;
+
+    return offset;
+}
 
-    // increment the number of loaded edges 
-    ggctx->edge_cnt++;
+// record the current index of a vertex or edge id
+static void set_delta_id(HTAB *ids, graphid id, int64 index, bool deleted) {
+    bool found;
+    delta_id *di = hash_search(ids, &id, HASH_ENTER, &found);
 
-    return true;
+    di->id = id;
+    di->index = index;
+    di->deleted = deleted;
 }
 
 /*
- * Helper function to insert an entire vertex into the current GRAPH global
- * vertex hashtable. It will return false if there is a duplicate.
+ * Get the changes of a vertex by its index. If it has none yet, NULL is
+ * returned, unless create is set.
  */
-static void insert_vertex_entry(graph_context *ggctx, graphid id, Oid oid, Datum properties) {
-    vertex_entry *ve = NULL;
+static delta_vertex *get_delta_vertex(graph_context *ggctx, int64 vertex_index, bool create) {
+    graph_delta *delta = get_graph_delta(ggctx);
+    delta_vertex *dv;
     bool found;
 
-    // search for the vertex 
-    ve = (vertex_entry *)hash_search(ggctx->vertex_hashtable, (void *)&id, HASH_ENTER, &found);
+    dv = hash_search(delta->vertices, &vertex_index, create ? HASH_ENTER : HASH_FIND, &found);
+    if (found || dv == NULL)
+        return dv;
+
+    dv->index = vertex_index;
+    dv->has_properties = false;
+    dv->properties = 0;
+    dv->has_edges = false;
+    dv->edges = NULL;
+    dv->vertices = NULL;
+    dv->labels = NULL;
+    dv->out_cnt = 0;
+    dv->in_cnt = 0;
+    dv->loop_cnt = 0;
+    dv->edges_cap = 0;
+
+    return dv;
+}
+
+// give a changed vertex its own copy of its adjacency entries
+static void copy_delta_vertex_edges(graph_context *ggctx, delta_vertex *dv) {
+    vertex_adjacency adj;
+    int64 nedges;
 
-    // again, MemSet may not be needed here 
-    MemSet(ve, 0, sizeof(vertex_entry));
+    if (dv->has_edges)
+        return;
 
-    /*
-     * Set the vertex id - this is important as this is the hash key value
-     * used for hash function collisions.
-     */
-    ve->id = id;
-    // set the label table oid for this vertex 
-    ve->oid = oid;
-    // set the datum vertex properties 
-    ve->properties = properties;
-    // set the NIL edge list 
-    ve->in = NULL;
-    ve->out = NULL;
-    ve->loop = NULL;
+    get_vertex_adjacency(ggctx, dv->index, &adj);
+    nedges = adj.out_cnt + adj.in_cnt + adj.loop_cnt;
 
-    // we also need to store the vertex id for clean up of vertex lists 
-    ggctx->vertices = append_graphid(ggctx->vertices, id);
+    dv->edges_cap = Max(nedges, 4);
+    dv->edges = MemoryContextAlloc(ggctx->delta->mcxt, sizeof(int64) * dv->edges_cap);
+    dv->vertices = MemoryContextAlloc(ggctx->delta->mcxt, sizeof(int64) * dv->edges_cap);
+    dv->labels = MemoryContextAlloc(ggctx->delta->mcxt, sizeof(Oid) * dv->edges_cap);
 
-    // increment the number of loaded vertices 
-    ggctx->vertex_cnt++;
+    if (nedges > 0) {
+        memcpy(dv->edges, adj.edges, sizeof(int64) * nedges);
+        memcpy(dv->vertices, adj.vertices, sizeof(int64) * nedges);
+        memcpy(dv->labels, adj.labels, sizeof(Oid) * nedges);
+    }
+
+    dv->out_cnt = adj.out_cnt;
+    dv->in_cnt = adj.in_cnt;
+    dv->loop_cnt = adj.loop_cnt;
+    dv->has_edges = true;
 }
 
 /*
- * Helper function to append one edge to an existing vertex in the current
- * global vertex hashtable.
+ * Add an adjacency entry to one of the edge runs of a changed vertex: 0 for
+ * the exiting edges, 1 for the entering edges and 2 for the selfloop edges.
  */
-static void insert_vertex(graph_context *ggctx, graphid start_id, graphid end_id, graphid id) {
-    vertex_entry *value = NULL;
-    bool found = false;
-    bool is_selfloop = false;
+static void add_delta_vertex_edge(graph_context *ggctx, delta_vertex *dv, int list, int64 edge_index, int64 vertex_index, Oid label) {
+    int64 nedges;
+    int64 pos;
 
-    // is it a self loop 
-    is_selfloop = (start_id == end_id);
+    copy_delta_vertex_edges(ggctx, dv);
 
-    // search for the start vertex of the edge 
-    value = (vertex_entry *)hash_search(ggctx->vertex_hashtable, (void *)&start_id, HASH_FIND, &found);
-    // vertices were preloaded so it must be there 
-    Assert(found);
+    nedges = dv->out_cnt + dv->in_cnt + dv->loop_cnt;
 
-    // if it is a self loop, add the edge to loop and we're done 
-    if (is_selfloop) {
-        value->loop = append_graphid(value->loop, id);
-        return;
+    if (nedges == dv->edges_cap) {
+        dv->edges_cap *= 2;
+        dv->edges = repalloc(dv->edges, sizeof(int64) * dv->edges_cap);
+        dv->vertices = repalloc(dv->vertices, sizeof(int64) * dv->edges_cap);
+        dv->labels = repalloc(dv->labels, sizeof(Oid) * dv->edges_cap);
     }
 
-    // add the edge to the out list of the start vertex 
-    value->out = append_graphid(value->out, id);
+    // the end of the run the entry goes in
+    if (list == 0) {
+        pos = dv->out_cnt++;
+    } else if (list == 1) {
+        pos = dv->out_cnt + dv->in_cnt++;
+    } else {
+        pos = nedges;
+        dv->loop_cnt++;
+    }
 
-    // search for the end vertex of the edge 
-    value = (vertex_entry *)hash_search(ggctx->vertex_hashtable, (void *)&end_id, HASH_FIND, &found);
-    // vertices were preloaded so it must be there 
-    Assert(found);
+    memmove(&dv->edges[pos + 1], &dv->edges[pos], sizeof(int64) * (nedges - pos));
+    memmove(&dv->vertices[pos + 1], &dv->vertices[pos], sizeof(int64) * (nedges - pos));
+    memmove(&dv->labels[pos + 1], &dv->labels[pos], sizeof(Oid) * (nedges - pos));
 
-    // add the edge to the in list of the end vertex 
-    value->in = append_graphid(value->in, id);
+    dv->edges[pos] = edge_index;
+    dv->vertices[pos] = vertex_index;
+    dv->labels[pos] = label;
 }
 
-// helper routine to load all vertices into the GRAPH global vertex hashtable 
-static void load_vertex_hashtable(graph_context *ggctx) {
-    ListCell *lc;
+// remove the adjacency entry of an edge from a changed vertex
+static void remove_delta_vertex_edge(graph_context *ggctx, delta_vertex *dv, int64 edge_index) {
+    int64 nedges;
 
-    Oid graph_oid = ggctx->graph_oid;
-    Oid graph_namespace_oid = get_namespace_oid(ggctx->graph_name, false);
+    copy_delta_vertex_edges(ggctx, dv);
 
-    Snapshot snapshot = GetActiveSnapshot();
+    nedges = dv->out_cnt + dv->in_cnt + dv->loop_cnt;
 
-    List *label_names = get_labels(snapshot, graph_oid, LABEL_TYPE_VERTEX);
-
-    foreach (lc, label_names) {
-        TableScanDesc scan_desc;
-        HeapTuple tuple;
-        TupleDesc tupdesc;
-
-        char *label_name = lfirst(lc);
-        
-        Oid oid = get_relname_relid(label_name, graph_namespace_oid);
-       
-        Relation graph_vertex_label = table_open(oid, ShareLock);
-        scan_desc = table_beginscan(graph_vertex_label, snapshot, 0, NULL);
-      
-        tupdesc = RelationGetDescr(graph_vertex_label);
-                     
-        while((tuple = heap_getnext(scan_desc, ForwardScanDirection))) {
-            graphid id;
-            Datum properties;
-            bool isnull;
-            HeapTupleData htd;
-
-            Assert(HeapTupleIsValid(tuple));
-
-            HeapTupleHeader hth = tuple->t_data;
-            htd.t_len = HeapTupleHeaderGetDatumLength(hth);
-            htd.t_data = hth;
-
-            Assert(HeapTupleIsValid(tuple));
-            // id
-            id = DATUM_GET_GRAPHID(heap_getattr(&htd, 1, tupdesc, &isnull));
-            // properties
-            properties = heap_getattr(&htd, 2, tupdesc, &isnull);
+    for (int64 pos = 0; pos < nedges; pos++) {
+        int64 nmove = nedges - pos - 1;
 
-            // insert vertex into vertex hashtable 
-            insert_vertex_entry(ggctx, id, oid, properties);
-        }
+        if (dv->edges[pos] != edge_index)
+            continue;
 
-        table_endscan(scan_desc);
-        table_close(graph_vertex_label, ShareLock);
+        if (pos < dv->out_cnt)
+            dv->out_cnt--;
+        else if (pos < dv->out_cnt + dv->in_cnt)
+            dv->in_cnt--;
+        else
+            dv->loop_cnt--;
+
+        memmove(&dv->edges[pos], &dv->edges[pos + 1], sizeof(int64) * nmove);
+        memmove(&dv->vertices[pos], &dv->vertices[pos + 1], sizeof(int64) * nmove);
+        memmove(&dv->labels[pos], &dv->labels[pos + 1], sizeof(Oid) * nmove);
+        return;
     }
 }
 
 /*
- * Helper function to load all of the GRAPH global hashtables (vertex & edge)
- * for the current global context.
+ * Add a new version of an edge to the changes, with the edge index following
+ * the last one used. Returns false if an end vertex is missing.
  */
-static void load_hashtables(graph_context *ggctx)
-{
-    // initialize statistics 
-    ggctx->vertex_cnt = 0;
-    ggctx->edge_cnt = 0;
+static bool insert_delta_edge(graph_context *ggctx, graphid id, graphid start_id, graphid end_id, Oid oid, Datum properties) {
+    graph_delta *delta = get_graph_delta(ggctx);
+    int64 start = get_vertex_index(ggctx, start_id);
+    int64 end = get_vertex_index(ggctx, end_id);
+    delta_new_edge *ne;
+    int64 index;
+
+    if (start < 0 || end < 0)
+        return false;
+
+    if (delta->new_edge_cnt == delta->new_edge_cap) {
+        delta->new_edge_cap *= 2;
+        delta->new_edges = repalloc_huge(delta->new_edges, sizeof(delta_new_edge) * delta->new_edge_cap);
+    }
+
+    index = ggctx->edge_cnt + delta->new_edge_cnt;
+    ne = &delta->new_edges[delta->new_edge_cnt++];
+
+    ne->id = id;
+    ne->oid = oid;
+    ne->start = start;
+    ne->end = end;
+    ne->properties = insert_delta_properties(delta, properties);
+
+    if (start == end) {
+        add_delta_vertex_edge(ggctx, get_delta_vertex(ggctx, start, true), 2, index, start, oid);
+    } else {
+        add_delta_vertex_edge(ggctx, get_delta_vertex(ggctx, start, true), 0, index, end, oid);
+        add_delta_vertex_edge(ggctx, get_delta_vertex(ggctx, end, true), 1, index, start, oid);
+    }
 
-    load_vertex_hashtable(ggctx);
-    load_edge_hashtable(ggctx);
+    set_delta_id(delta->edge_ids, id, index, false);
+
+    return true;
 }
 
 /*
- * Helper routine to load all edges into the GRAPH global edge and vertex
- * hashtables.
+ * Remove the current version of an edge from the adjacency of its vertices.
+ * Returns false if there is no such edge.
  */
-static void load_edge_hashtable(graph_context *ggctx) {
-    Oid graph_oid;
-    Oid graph_namespace_oid;
-    Snapshot snapshot;
-    List *labels = NIL;
-    ListCell *lc;
+static bool delete_delta_edge(graph_context *ggctx, graphid id) {
+    graph_delta *delta = get_graph_delta(ggctx);
+    int64 index = get_edge_index(ggctx, id);
+    int64 start;
+    int64 end;
 
-    graph_oid = ggctx->graph_oid;
-    graph_namespace_oid = get_namespace_oid(ggctx->graph_name, false);
-    snapshot = GetActiveSnapshot();
-
-    labels = get_labels(snapshot, graph_oid, LABEL_TYPE_EDGE);
-
-    foreach (lc, labels) {
-        HeapTuple tuple;
-        char *label = lfirst(lc);
-
-        Oid oid = get_relname_relid(label, graph_namespace_oid);
-        Relation graph_edge_label = table_open(oid, ShareLock);
-        TableScanDesc scan_desc = table_beginscan(graph_edge_label, snapshot, 0, NULL);
-        TupleDesc tupdesc = RelationGetDescr(graph_edge_label);
-        Assert (tupdesc->natts == 4);
-
-        while((tuple = heap_getnext(scan_desc, ForwardScanDirection)) != NULL) {
-	    graphid id, start_id, end_id;
-            Datum properties;
-            bool inserted = false;
-            bool isnull;
-            HeapTupleHeader hth;
-            HeapTupleData tmptup, *htd;
-
-            hth = tuple->t_data;
-            tmptup.t_len = HeapTupleHeaderGetDatumLength(hth);
-            tmptup.t_data = hth;
-            htd = &tmptup;
-
-            Assert(HeapTupleIsValid(tuple));
-            // id
-            id = DATUM_GET_GRAPHID(heap_getattr(htd, 1, tupdesc, &isnull));
-            // start_id
-            start_id = DATUM_GET_GRAPHID(heap_getattr(htd, 2, tupdesc, &isnull));
-            // end_id
-            end_id = DATUM_GET_GRAPHID(heap_getattr(htd, 3, tupdesc, &isnull));
-            // properties
-            properties = heap_getattr(htd, 4, tupdesc, &isnull);
+    if (index < 0)
+        return false;
 
-            // insert edge into edge hashtable 
-            inserted = insert_edge(ggctx, id, properties, start_id, end_id, oid);
-            Assert (inserted);
+    start = get_edge_start_index(ggctx, index);
+    end = get_edge_end_index(ggctx, index);
 
-            // insert the edge into the start and end vertices edge lists 
-            insert_vertex(ggctx, start_id, end_id, id);
-        }
+    remove_delta_vertex_edge(ggctx, get_delta_vertex(ggctx, start, true), index);
+    if (end != start)
+        remove_delta_vertex_edge(ggctx, get_delta_vertex(ggctx, end, true), index);
 
-        // end the scan and close the relation 
-        table_endscan(scan_desc);
-        table_close(graph_edge_label, ShareLock);
-    }
-}
+    set_delta_id(delta->edge_ids, id, index, true);
 
-static void freeze_hashtables(graph_context *ggctx) {
-    hash_freeze(ggctx->vertex_hashtable);
-    hash_freeze(ggctx->edge_hashtable);
+    return true;
 }
 
 /*
- * Helper function to free the entire specified GRAPH global context. After
- * running this you should not use the pointer in ggctx.
+ * Bring the GRAPH global contexts forward with the rest of the transaction's
+ * changes, just before it commits. Graphs that can't be brought forward are
+ * dropped.
  */
-static void free_graph_context(graph_context *ggctx)
-{
-    QueueNode *curr_vertex = NULL;
+static void apply_remaining_graph_changes(void) {
+    CommandId last = GetCurrentCommandId(false);
+    graph_context *ggctx;
 
-    // don't do anything if NULL 
-    if (!ggctx)
+    // nothing was written, there is nothing to apply
+    if (!TransactionIdIsValid(GetTopTransactionIdIfAny()))
         return;
 
-    // free the graph name 
-    pfree(ggctx->graph_name);
-    ggctx->graph_name = NULL;
-
-    ggctx->graph_oid = InvalidOid;
-    ggctx->next = NULL;
+    /*
+     * The last command of a transaction block has been ended. Otherwise, it
+     * may have written something.
+     */
+    if (!IsTransactionBlock())
+        last++;
 
-    // free the vertex edge lists, starting with the head 
-    curr_vertex = peek_queue_head(ggctx->vertices);
-    while (curr_vertex) {
-        QueueNode *next_vertex = NULL;
-        vertex_entry *value = NULL;
-        bool found = false;
-        graphid id;
+    for (ggctx = global_graph_contexts; ggctx != NULL; ggctx = ggctx->next) {
+        if (ggctx->stale || ggctx->completion_count == 0)
+            continue;
 
-        // get the next vertex in the list, if any 
-        next_vertex = next_queue_node(curr_vertex);
+        if (are_changes_logged(ggctx->curcid, last))
+            apply_graph_changes(ggctx, last);
+        else
+            ggctx->stale = true;
+    }
+}
 
-        // get the current vertex id 
-        id = get_graphid(curr_vertex);
+/*
+ * Finish the GRAPH global contexts at the end of the transaction. After a
+ * commit, the graphs are valid for snapshots taken after it, as long as no
+ * other transaction completed in the meantime. After an abort, the graphs
+ * that hold any of the transaction's changes are dropped.
+ */
+static void end_graph_changes(bool commit) {
+    bool had_xid = TransactionIdIsValid(GetTopTransactionIdIfAny());
+    uint64 completion_count = 0;
+    graph_context *ggctx;
+
+    if (global_graph_contexts != NULL) {
+        LWLockAcquire(ProcArrayLock, LW_SHARED);
+        completion_count = ShmemVariableCache->xactCompletionCount;
+        LWLockRelease(ProcArrayLock);
+    }
 
-        // retrieve the vertex entry 
-        value = (vertex_entry *)hash_search(ggctx->vertex_hashtable, (void *)&id, HASH_FIND, &found);
-        Assert(found);
+    for (ggctx = global_graph_contexts; ggctx != NULL; ggctx = ggctx->next) {
+        if (ggctx->stale || ggctx->completion_count == 0)
+            continue;
 
-        // free the edge list associated with this vertex 
-        free_queue(value->in);
-        free_queue(value->out);
-        free_queue(value->loop);
+        // it holds changes of the aborted transaction
+        if (!commit && ggctx->curcid > FirstCommandId)
+            ggctx->stale = true;
 
-        value->in = NULL;
-        value->out = NULL;
-        value->loop = NULL;
+        // the transaction's own completion is the only one allowed
+        if (ggctx->completion_count + (had_xid ? 1 : 0) != completion_count)
+            ggctx->stale = true;
 
-        // move to the next vertex 
-        curr_vertex = next_vertex;
+        ggctx->completion_count = completion_count;
+        ggctx->curcid = FirstCommandId;
+        ggctx->applied = 0;
     }
 
-    // free the vertices list 
-    free_queue(ggctx->vertices);
-    ggctx->vertices = NULL;
+    // the log itself goes away with the TopTransactionContext
+    change_log = NULL;
+    change_log_cnt = 0;
+    change_log_cap = 0;
+    change_log_overflow = false;
+    subxact_start_cids = NIL;
+    unlogged_write_cids = NIL;
+    known_snapshot_set = false;
+}
+
+// transaction callback to keep the GRAPH global contexts in step
+static void graph_xact_callback(XactEvent event, void *arg) {
+    graph_context *ggctx;
 
-    // free the hashtables 
-    hash_destroy(ggctx->vertex_hashtable);
-    hash_destroy(ggctx->edge_hashtable);
+    switch (event) {
+        case XACT_EVENT_PRE_COMMIT:
+            apply_remaining_graph_changes();
+            break;
 
-    ggctx->vertex_hashtable = NULL;
-    ggctx->edge_hashtable = NULL;
+        case XACT_EVENT_COMMIT:
+            end_graph_changes(true);
+            break;
 
-    pfree(ggctx);
-    ggctx = NULL;
+        case XACT_EVENT_ABORT:
+            end_graph_changes(false);
+            break;
+
+        case XACT_EVENT_PREPARE:
+            // the changes are neither committed nor aborted yet
+            for (ggctx = global_graph_contexts; ggctx != NULL; ggctx = ggctx->next)
+                ggctx->stale = true;
+
+            end_graph_changes(false);
+            break;
+
+        default:
+            break;
+    }
 }
 
 /*
- * It will create the
- * context for the graph specified, provided it isn't already built and valid.
- * During processing it will free (delete) all invalid GRAPH contexts. It
- * returns the GRAPH global context for the specified graph.
+ * Subtransaction callback. When a subtransaction aborts its logged changes
+ * are voided, and graphs that may hold any of its changes are dropped.
  */
-graph_context *manage_graph_contexts(char *graph_name, Oid graph_oid) {
-    graph_context *new_ggctx = NULL;
-    graph_context *curr_ggctx = NULL;
-    graph_context *prev_ggctx = NULL;
+static void graph_subxact_callback(SubXactEvent event, SubTransactionId mySubid, SubTransactionId parentSubid, void *arg) {
+    int nest_level = GetCurrentTransactionNestLevel();
+    MemoryContext oldctx;
+    CommandId start_cid;
+    graph_context *ggctx;
+
+    switch (event) {
+        case SUBXACT_EVENT_START_SUB:
+            oldctx = MemoryContextSwitchTo(TopTransactionContext);
+            subxact_start_cids = lcons_int(GetCurrentCommandId(false), subxact_start_cids);
+            MemoryContextSwitchTo(oldctx);
+            break;
 
-    // we need a higher context, or one that isn't destroyed by SRF exit 
-    MemoryContext oldctx = MemoryContextSwitchTo(TopMemoryContext);
+        case SUBXACT_EVENT_COMMIT_SUB:
+            for (int i = change_log_cnt - 1; i >= 0 && change_log[i].nest_level >= nest_level; i--)
+                change_log[i].nest_level = nest_level - 1;
 
-    // free the invalidated GRAPH global contexts first 
-    prev_ggctx = NULL;
-    curr_ggctx = global_graph_contexts;
-    while (curr_ggctx) {
-        graph_context *next_ggctx = curr_ggctx->next;
+            subxact_start_cids = list_delete_first(subxact_start_cids);
+            break;
 
-        if (is_ggctx_invalid(curr_ggctx)) {
-            if (prev_ggctx == NULL)
-                global_graph_contexts = next_ggctx;
-            else
-                prev_ggctx->next = curr_ggctx->next;
+        case SUBXACT_EVENT_ABORT_SUB:
+            // the entries keep their command ids, which were used
+            for (int i = change_log_cnt - 1; i >= 0 && change_log[i].nest_level >= nest_level; i--)
+                change_log[i].kind = GRAPH_CHANGE_NONE;
 
-            free_graph_context(curr_ggctx);
-        } else {
-            prev_ggctx = curr_ggctx;
-        }
+            start_cid = (subxact_start_cids != NIL) ? linitial_int(subxact_start_cids) : FirstCommandId;
+            for (ggctx = global_graph_contexts; ggctx != NULL; ggctx = ggctx->next) {
+                if (ggctx->curcid > start_cid)
+                    ggctx->stale = true;
+            }
 
-        curr_ggctx = next_ggctx;
-    }
+            if (subxact_start_cids != NIL)
+                subxact_start_cids = list_delete_first(subxact_start_cids);
+            break;
 
-    curr_ggctx = global_graph_contexts;
-    while (curr_ggctx) {
-        if (curr_ggctx->graph_oid == graph_oid) {
-            MemoryContextSwitchTo(oldctx);
-            return curr_ggctx;
-        }
-        curr_ggctx = curr_ggctx->next;
+        default:
+            break;
     }
+}
 
-    new_ggctx = palloc0(sizeof(graph_context));
+/*
+ * Helper function to find the graph_context used by the specified
+ * graph_oid. If not found, it returns NULL.
+ */
+graph_context *find_graph_context(Oid graph_oid) {
+    graph_context *ggctx = global_graph_contexts;
 
-    if (global_graph_contexts)
-        new_ggctx->next = global_graph_contexts;
-    else
-        new_ggctx->next = NULL;
+    while(ggctx) {
+        if (ggctx->graph_oid == graph_oid)
+            return ggctx;
 
-    global_graph_contexts = new_ggctx;
+        ggctx = ggctx->next;
+    }
 
-    new_ggctx->graph_name = pstrdup(graph_name);
-    new_ggctx->graph_oid = graph_oid;
+    return NULL;
+}
 
-    new_ggctx->xmin = GetActiveSnapshot()->xmin;
-    new_ggctx->xmax = GetActiveSnapshot()->xmax;
-    new_ggctx->curcid = GetActiveSnapshot()->curcid;
+/*
+ * Find the graph's context, if it is there and can show the graph as the
+ * active snapshot sees it, applying the changes logged since it was last used.
+ * Unlike manage_graph_contexts, a graph that isn't loaded is left unloaded,
+ * for callers that need only a few entities and can read them elsewhere.
+ */
+graph_context *find_current_graph_context(Oid graph_oid) {
+    graph_context *ggctx = find_graph_context(graph_oid);
+    MemoryContext oldctx;
 
-    new_ggctx->vertices = NULL;
+    if (ggctx == NULL || !ActiveSnapshotSet() || is_ggctx_invalid(ggctx))
+        return NULL;
 
-    create_hashtables(new_ggctx);
-    load_hashtables(new_ggctx);
-    freeze_hashtables(new_ggctx);
+    if (ggctx->completion_count != 0) {
+        oldctx = MemoryContextSwitchTo(TopMemoryContext);
+        apply_graph_changes(ggctx, GetActiveSnapshot()->curcid);
+        MemoryContextSwitchTo(oldctx);
 
-    MemoryContextSwitchTo(oldctx);
+        if (ggctx->stale)
+            return NULL;
+    }
 
-    return new_ggctx;
+    return ggctx;
 }
 
 /*
- * Helper function to retrieve a vertex_entry from the graph's vertex hash
- * table. If there isn't one, it returns a NULL. The latter is necessary for
- * checking if the vsid and veid entries exist.
+ * Graph accessor functions. Vertices and edges are numbered from 0, image
+ * ones first, followed by the ones created since the image was built.
  */
-vertex_entry *get_vertex_entry(graph_context *ggctx, graphid id)
-{
-    vertex_entry *ve = NULL;
-    bool found = false;
+int64 get_graph_vertex_count(graph_context *ggctx) {
+    if (ggctx->delta != NULL)
+        return ggctx->vertex_cnt + ggctx->delta->new_vertex_cnt;
 
-    // retrieve the current vertex entry 
-    ve = (vertex_entry *)hash_search(ggctx->vertex_hashtable, (void *)&id, HASH_FIND, &found);
-    return ve;
+    return ggctx->vertex_cnt;
 }
 
-// helper function to retrieve an edge_entry from the graph's edge hash table 
-edge_entry *get_edge_entry(graph_context *ggctx, graphid id)
-{
-    edge_entry *ee = NULL;
-    bool found = false;
-
-    // retrieve the current edge entry 
-    ee = (edge_entry *)hash_search(ggctx->edge_hashtable, (void *)&id, HASH_FIND, &found);
-    // it should be found, otherwise we have problems 
-    Assert(found);
+// the number of edge indexes in use, including those of changed edges
+int64 get_graph_edge_count(graph_context *ggctx) {
+    if (ggctx->delta != NULL)
+        return ggctx->edge_cnt + ggctx->delta->new_edge_cnt;
 
-    return ee;
+    return ggctx->edge_cnt;
 }
 
 /*
- * Helper function to find the graph_context used by the specified
- * graph_oid. If not found, it returns NULL.
+ * Helper function to get the index of a vertex. If there isn't one, it
+ * returns -1. The latter is necessary for checking if the vsid and veid
+ * entries exist.
  */
-graph_context *find_graph_context(Oid graph_oid) {
-    graph_context *ggctx = global_graph_contexts;
+int64 get_vertex_index(graph_context *ggctx, graphid id) {
+    // changed vertices are found in the changes
+    if (ggctx->delta != NULL) {
+        bool found;
+        delta_id *di = hash_search(ggctx->delta->vertex_ids, &id, HASH_FIND, &found);
+
+        if (found)
+            return di->deleted ? -1 : di->index;
+    }
 
-    while(ggctx) {
-        if (ggctx->graph_oid == graph_oid)
-            return ggctx;
+    return find_id(ggctx->vertex_ids, ggctx->vertex_cnt, id);
+}
 
-        ggctx = ggctx->next;
+// helper function to get the index of an edge, -1 if there isn't one
+int64 get_edge_index(graph_context *ggctx, graphid id) {
+    // changed edges are found in the changes
+    if (ggctx->delta != NULL) {
+        bool found;
+        delta_id *di = hash_search(ggctx->delta->edge_ids, &id, HASH_FIND, &found);
+
+        if (found)
+            return di->deleted ? -1 : di->index;
     }
 
-    return NULL;
+    return find_id(ggctx->edge_ids, ggctx->edge_cnt, id);
+}
+
+// vertex accessor functions
+graphid get_vertex_id(graph_context *ggctx, int64 vertex_index) {
+    if (vertex_index < ggctx->vertex_cnt)
+        return ggctx->vertex_ids[vertex_index];
+
+    return ggctx->delta->new_vertices[vertex_index - ggctx->vertex_cnt].id;
 }
 
-// graph vertices accessor 
-Queue *get_graph_vertices(graph_context *ggctx) {
-    return ggctx->vertices;
+Oid get_vertex_label_table_oid(graph_context *ggctx, int64 vertex_index) {
+    if (vertex_index < ggctx->vertex_cnt)
+        return ggctx->vertex_oids[vertex_index];
+
+    return ggctx->delta->new_vertices[vertex_index - ggctx->vertex_cnt].oid;
+}
+
+Datum get_vertex_properties(graph_context *ggctx, int64 vertex_index) {
+    if (ggctx->delta != NULL) {
+        bool found;
+        delta_vertex *dv = hash_search(ggctx->delta->vertices, &vertex_index, HASH_FIND, &found);
+
+        if (found && dv->has_properties)
+            return PointerGetDatum(ggctx->delta->properties + dv->properties);
+    }
+
+    if (vertex_index < ggctx->vertex_cnt)
+        return PointerGetDatum(ggctx->properties + ggctx->vertex_properties[vertex_index]);
+
+    return PointerGetDatum(ggctx->delta->properties + ggctx->delta->new_vertices[vertex_index - ggctx->vertex_cnt].properties);
 }
 
-// vertex_entry accessor functions 
-graphid get_vertex_entry_id(vertex_entry *ve) {
-    return ve->id;
+/*
+ * Get the adjacency entries of a vertex. The exiting edges come first, then
+ * the entering edges and the self loops.
+ */
+void get_vertex_adjacency(graph_context *ggctx, int64 vertex_index, vertex_adjacency *adj) {
+    int64 offset;
+
+    if (ggctx->delta != NULL) {
+        bool found;
+        delta_vertex *dv = hash_search(ggctx->delta->vertices, &vertex_index, HASH_FIND, &found);
+
+        if (found && dv->has_edges) {
+            adj->edges = dv->edges;
+            adj->vertices = dv->vertices;
+            adj->labels = dv->labels;
+            adj->out_cnt = dv->out_cnt;
+            adj->in_cnt = dv->in_cnt;
+            adj->loop_cnt = dv->loop_cnt;
+            return;
+        }
+    }
+
+    // a created vertex has no edges until some are added to it
+    if (vertex_index >= ggctx->vertex_cnt) {
+        MemSet(adj, 0, sizeof(vertex_adjacency));
+        return;
+    }
+
+    offset = ggctx->vertex_offsets[vertex_index];
+
+    adj->edges = &ggctx->adjacency_edges[offset];
+    adj->vertices = &ggctx->adjacency_vertices[offset];
+    adj->labels = &ggctx->adjacency_labels[offset];
+    adj->out_cnt = ggctx->vertex_out_cnts[vertex_index];
+    adj->in_cnt = ggctx->vertex_in_cnts[vertex_index];
+    adj->loop_cnt = ggctx->vertex_offsets[vertex_index + 1] - offset - adj->out_cnt - adj->in_cnt;
 }
 
-Queue *get_vertex_entry_edges_in(vertex_entry *ve) {
-    return ve->in;
+// edge accessor functions
+graphid get_edge_id(graph_context *ggctx, int64 edge_index) {
+    if (edge_index < ggctx->edge_cnt)
+        return ggctx->edge_ids[edge_index];
+
+    return ggctx->delta->new_edges[edge_index - ggctx->edge_cnt].id;
 }
 
-Queue *get_vertex_entry_edges_out(vertex_entry *ve) {
-    return ve->out;
+Oid get_edge_label_table_oid(graph_context *ggctx, int64 edge_index) {
+    if (edge_index < ggctx->edge_cnt)
+        return ggctx->edge_oids[edge_index];
+
+    return ggctx->delta->new_edges[edge_index - ggctx->edge_cnt].oid;
 }
 
-Queue *get_vertex_entry_edges_self(vertex_entry *ve) {
-    return ve->loop;
+Datum get_edge_properties(graph_context *ggctx, int64 edge_index) {
+    if (edge_index < ggctx->edge_cnt)
+        return PointerGetDatum(ggctx->properties + ggctx->edge_properties[edge_index]);
+
+    return PointerGetDatum(ggctx->delta->properties + ggctx->delta->new_edges[edge_index - ggctx->edge_cnt].properties);
 }
 
-Oid get_vertex_entry_label_table_oid(vertex_entry *ve) {
-    return ve->oid;
+int64 get_edge_start_index(graph_context *ggctx, int64 edge_index) {
+    if (edge_index < ggctx->edge_cnt)
+        return ggctx->edge_starts[edge_index];
+
+    return ggctx->delta->new_edges[edge_index - ggctx->edge_cnt].start;
 }
 
-Datum get_vertex_entry_properties(vertex_entry *ve) {
-    return ve->properties;
+int64 get_edge_end_index(graph_context *ggctx, int64 edge_index) {
+    if (edge_index < ggctx->edge_cnt)
+        return ggctx->edge_ends[edge_index];
+
+    return ggctx->delta->new_edges[edge_index - ggctx->edge_cnt].end;
 }
 
-// edge_entry accessor functions 
-graphid get_edge_entry_id(edge_entry *ee) {
-    return ee->id;
+graphid get_start_id(graph_context *ggctx, int64 edge_index) {
+    return get_vertex_id(ggctx, get_edge_start_index(ggctx, edge_index));
 }
 
-Oid get_edge_entry_label_table_oid(edge_entry *ee) {
-    return ee->oid;
+graphid get_end_id(graph_context *ggctx, int64 edge_index) {
+    return get_vertex_id(ggctx, get_edge_end_index(ggctx, edge_index));
 }
 
-Datum get_edge_entry_properties(edge_entry *ee) {
-    return ee->properties;
+// get the weight property as a float8, or NaN if it isn't a number
+static float8 extract_edge_weight(Datum properties, char *property) {
+    gtype *agt = DATUM_GET_GTYPE_P(properties);
+    gtype_value key = { .type = AGTV_STRING, .val.string = { strlen(property), property } };
+    gtype_value *value = find_gtype_value_from_container(&agt->root, GT_FOBJECT, &key);
+
+    if (value == NULL)
+        return get_float8_nan();
+
+    switch (value->type) {
+        case AGTV_INTEGER:
+            return (float8)value->val.int_value;
+        case AGTV_FLOAT:
+            return value->val.float_value;
+        case AGTV_NUMERIC:
+            return DatumGetFloat8(DirectFunctionCall1(numeric_float8, NumericGetDatum(value->val.numeric)));
+        default:
+            return get_float8_nan();
+    }
 }
 
-graphid get_start_id(edge_entry *ee) {
-    return ee->start_id;
+/*
+ * Get the weights of the image's edges for the property. They are extracted
+ * the first time the property is asked for, and kept with the image.
+ */
+const float8 *get_edge_weights(graph_context *ggctx, char *property) {
+    edge_weights *weights;
+
+    for (weights = ggctx->weights; weights != NULL; weights = weights->next) {
+        if (strcmp(weights->property, property) == 0)
+            return weights->values;
+    }
+
+    weights = MemoryContextAlloc(TopMemoryContext, sizeof(edge_weights));
+    weights->property = MemoryContextStrdup(TopMemoryContext, property);
+    weights->values = MemoryContextAllocHuge(TopMemoryContext, sizeof(float8) * Max(ggctx->edge_cnt, 1));
+
+    for (int64 i = 0; i < ggctx->edge_cnt; i++) {
+        weights->values[i] = extract_edge_weight(PointerGetDatum(ggctx->properties + ggctx->edge_properties[i]), property);
+    }
+
+    weights->next = ggctx->weights;
+    ggctx->weights = weights;
+
+    return weights->values;
 }
 
-graphid get_end_id(edge_entry *ee) {
-    return ee->end_id;
+// get the weight of an edge, the edges created since the image was built included
+float8 get_edge_weight(graph_context *ggctx, const float8 *weights, int64 edge_index, char *property) {
+    if (edge_index < ggctx->edge_cnt)
+        return weights[edge_index];
+
+    return extract_edge_weight(get_edge_properties(ggctx, edge_index), property);
 }
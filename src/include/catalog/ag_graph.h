@@ -27,8 +27,10 @@
 #define Anum_ag_graph_oid 1
 #define Anum_ag_graph_name 2
 #define Anum_ag_graph_namespace 3
+#define Anum_ag_graph_directed 4
+#define Anum_ag_graph_edge_endpoint_indexes 5
 
-#define Natts_ag_graph 3
+#define Natts_ag_graph 5
 
 
 #define session_graph_use() ag_relation_id("session_graph_use", "table")
@@ -40,7 +42,7 @@
 #define ag_graph_namespace_index_id() \
     ag_relation_id("ag_graph_namespace_index", "index")
 
-void insert_graph(const Name graph_name, const Oid nsp_id);
+void insert_graph(const Name graph_name, const Oid nsp_id, bool edge_endpoint_indexes);
 void delete_graph(const Name graph_name);
 void update_graph_name(const Name graph_name, const Name new_name);
 
@@ -22,6 +22,8 @@
 
 #include "postgres.h"
 
+#include "utils/relcache.h"
+
 #define LABEL_TYPE_VERTEX 'v'
 #define LABEL_TYPE_EDGE 'e'
 
@@ -56,5 +58,9 @@
 
 void create_label(char *graph_name, char *label_name, char label_type,
                   List *parents);
+Oid get_edge_endpoint_index(Relation rel, AttrNumber attnum);
+void label_commands_init(void);
+
+extern bool edge_endpoint_indexes;
 
 #endif
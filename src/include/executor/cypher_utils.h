@@ -50,6 +50,19 @@
     estate->es_output_cid--; \
     estate->es_snapshot->curcid--;
 
+/*
+ * Tuples waiting to be inserted into a label table with table_multi_insert.
+ */
+#define ENTITY_INSERT_BUFFER_SIZE 1000
+
+typedef struct entity_insert_buffer
+{
+    ResultRelInfo *resultRelInfo;
+    BulkInsertState bistate;
+    TupleTableSlot *slots[ENTITY_INSERT_BUFFER_SIZE];
+    int nused;
+} entity_insert_buffer;
+
 typedef struct cypher_create_custom_scan_state
 {
     CustomScanState css;
@@ -59,6 +72,8 @@ typedef struct cypher_create_custom_scan_state
     uint32 flags;
     TupleTableSlot *slot;
     Oid graph_oid;
+    // entity_insert_buffers of a terminal CREATE, NIL otherwise
+    List *insert_buffers;
 } cypher_create_custom_scan_state;
 
 typedef struct cypher_set_custom_scan_state
@@ -77,6 +92,10 @@ typedef struct cypher_delete_custom_scan_state
     cypher_delete_information *delete_data;
     int flags;
     List *edge_labels;
+    // start_id and end_id index of each edge label, found with the first vertex
+    List *edge_start_indexes;
+    List *edge_end_indexes;
+    bool edge_indexes_found;
     Oid graph_oid;
 } cypher_delete_custom_scan_state;
 
@@ -106,11 +125,19 @@ ResultRelInfo *create_entity_result_rel_info(EState *estate, char *graph_name,
 void destroy_entity_result_rel_info(ResultRelInfo *result_rel_info);
 
 bool entity_exists(EState *estate, Oid graph_oid, graphid id);
+bool find_entity_tuple(Relation rel, Snapshot snapshot, graphid id,
+                       TupleTableSlot *slot);
 HeapTuple insert_entity_tuple(ResultRelInfo *resultRelInfo,
                               TupleTableSlot *elemTupleSlot,
                               EState *estate);
 HeapTuple insert_entity_tuple_cid(ResultRelInfo *resultRelInfo,
                                   TupleTableSlot *elemTupleSlot,
                                   EState *estate, CommandId cid);
+entity_insert_buffer *create_entity_insert_buffer(ResultRelInfo *resultRelInfo);
+void buffer_entity_tuple(entity_insert_buffer *buffer,
+                         TupleTableSlot *elemTupleSlot, EState *estate);
+void flush_entity_insert_buffer(entity_insert_buffer *buffer, EState *estate);
+void free_entity_insert_buffer(entity_insert_buffer *buffer);
+void materialize_slot_variable_edges(TupleTableSlot *slot);
 
 #endif
@@ -166,11 +166,19 @@ typedef struct cypher_call
  * pattern
  */
 
+typedef enum cypher_path_kind
+{
+    CYPHER_PATH_NORMAL,
+    CYPHER_PATH_SHORTEST,
+    CYPHER_PATH_ALL_SHORTEST
+} cypher_path_kind;
+
 typedef struct cypher_path
 {
     ExtensibleNode extensible;
     List *path; // [ node ( , relationship , node , ... ) ]
     char *var_name;
+    cypher_path_kind kind;
     int location;
 } cypher_path;
 
@@ -31,6 +31,7 @@ typedef struct graph_cache_data
     NameData name;
     Oid namespace;
     bool directed;
+    bool edge_endpoint_indexes;
 } graph_cache_data;
 
 // label_cache_data contains the same fields that ag_label catalog table has
@@ -76,6 +76,8 @@ gtype *extract_edge_properties(edge *v);
 Datum build_edge(PG_FUNCTION_ARGS);
 edge *create_edge(graphid id,graphid start_id,graphid end_id, Oid graph_oid, gtype *properties);
 int extract_edge_label_length(edge *v);
+Datum get_vertex(Oid graph_oid, graphid id);
+Datum get_edge(Oid graph_oid, graphid id);
 
 #define EDGEOID \
     (GetSysCacheOid2(TYPENAMENSP, Anum_pg_type_oid, CStringGetDatum("edge"), ObjectIdGetDatum(postgraph_namespace_id())))
@@ -18,32 +18,72 @@
 #ifndef POSTGRAPH_GLOBAL_GRAPH_H
 #define POSTGRAPH_GLOBAL_GRAPH_H
 
+#include "access/htup.h"
+#include "storage/dsm.h"
+#include "storage/shm_toc.h"
+#include "utils/relcache.h"
+
 #include "utils/graphid.h"
-#include "utils/queue.h"
 
-typedef struct vertex_entry vertex_entry;
-typedef struct edge_entry edge_entry;
 typedef struct graph_context graph_context;
 
+/*
+ * The adjacency entries of a vertex, as parallel arrays: the edge's index, the
+ * index of the vertex at the other end and the edge's label table. The exiting
+ * edges come first, followed by the entering edges and the self loops.
+ */
+typedef struct vertex_adjacency
+{
+    const int64 *edges;
+    const int64 *vertices;
+    const Oid *labels;
+    int64 out_cnt;
+    int64 in_cnt;
+    int64 loop_cnt;
+} vertex_adjacency;
+
+// changes made to vertices and edges, as logged by the executors
+typedef enum graph_change_kind
+{
+    GRAPH_CHANGE_NONE,
+    GRAPH_CHANGE_INSERT,
+    GRAPH_CHANGE_UPDATE,
+    GRAPH_CHANGE_DELETE
+} graph_change_kind;
+
+// GUC variables
+extern bool shared_graph_cache;
+extern int shared_graph_cache_size;
+extern int graph_load_workers;
+
 // GRAPH global context functions 
+void global_graph_init(void);
 graph_context *manage_graph_contexts(char *graph_name, Oid graph_oid);
 graph_context *find_graph_context(Oid graph_oid);
+graph_context *find_current_graph_context(Oid graph_oid);
 bool is_ggctx_invalid(graph_context *ggctx);
+void log_graph_change(Relation rel, HeapTuple tuple, CommandId cid, graph_change_kind kind);
+void mark_unlogged_graph_write(Oid relid);
+extern PGDLLEXPORT void graph_load_worker_main(dsm_segment *seg, shm_toc *toc);
 // GRAPH retrieval functions 
-Queue *get_graph_vertices(graph_context *ggctx);
-vertex_entry *get_vertex_entry(graph_context *ggctx, graphid vertex_id);
-edge_entry *get_edge_entry(graph_context *ggctx, graphid edge_id);
-// vertex entry accessor functions
-graphid get_vertex_entry_id(vertex_entry *ve);
-Queue *get_vertex_entry_edges_in(vertex_entry *ve);
-Queue *get_vertex_entry_edges_out(vertex_entry *ve);
-Queue *get_vertex_entry_edges_self(vertex_entry *ve);
-Oid get_vertex_entry_label_table_oid(vertex_entry *ve);
-Datum get_vertex_entry_properties(vertex_entry *ve);
-// edge entry accessor functions 
-graphid get_edge_entry_id(edge_entry *ee);
-Oid get_edge_entry_label_table_oid(edge_entry *ee);
-Datum get_edge_entry_properties(edge_entry *ee);
-graphid get_start_id(edge_entry *ee);
-graphid get_end_id(edge_entry *ee);
+int64 get_graph_vertex_count(graph_context *ggctx);
+int64 get_graph_edge_count(graph_context *ggctx);
+int64 get_vertex_index(graph_context *ggctx, graphid vertex_id);
+int64 get_edge_index(graph_context *ggctx, graphid edge_id);
+// vertex accessor functions
+graphid get_vertex_id(graph_context *ggctx, int64 vertex_index);
+Oid get_vertex_label_table_oid(graph_context *ggctx, int64 vertex_index);
+Datum get_vertex_properties(graph_context *ggctx, int64 vertex_index);
+void get_vertex_adjacency(graph_context *ggctx, int64 vertex_index, vertex_adjacency *adj);
+// edge accessor functions 
+graphid get_edge_id(graph_context *ggctx, int64 edge_index);
+Oid get_edge_label_table_oid(graph_context *ggctx, int64 edge_index);
+Datum get_edge_properties(graph_context *ggctx, int64 edge_index);
+int64 get_edge_start_index(graph_context *ggctx, int64 edge_index);
+int64 get_edge_end_index(graph_context *ggctx, int64 edge_index);
+graphid get_start_id(graph_context *ggctx, int64 edge_index);
+graphid get_end_id(graph_context *ggctx, int64 edge_index);
+// edge weight functions
+const float8 *get_edge_weights(graph_context *ggctx, char *property);
+float8 get_edge_weight(graph_context *ggctx, const float8 *weights, int64 edge_index, char *property);
 #endif
@@ -120,6 +120,18 @@ typedef enum
 #define AG_GET_ARG_GTYPE_P(x) DATUM_GET_GTYPE_P(PG_GETARG_DATUM(x))
 #define AG_RETURN_GTYPE_P(x) PG_RETURN_POINTER(x)
 
+/*
+ * Return an internal transition state. A state that was never created must
+ * go back as SQL NULL, so the final and serial functions never see a NULL
+ * pointer.
+ */
+#define AGG_RETURN_STATE(state) \
+    do { \
+        if ((state) == NULL) \
+            PG_RETURN_NULL(); \
+        PG_RETURN_POINTER(state); \
+    } while (0)
+
 typedef struct gtype_pair gtype_pair;
 typedef struct gtype_value gtype_value;
 
@@ -627,12 +639,16 @@ uint32 get_gtype_offset(const gtype_container *agtc, int index);
 uint32 get_gtype_length(const gtype_container *agtc, int index);
 int compare_gtype_containers_orderability(gtype_container *a, gtype_container *b);
 gtype_value *find_gtype_value_from_container(gtype_container *container, uint32 flags, const gtype_value *key);
+bool find_gtype_slice_from_object(gtype_container *container, const char *key, int key_len,
+                                  gtentry *entry, char **data, uint32 *len);
+gtype *gtype_slice_to_gtype(gtentry entry, char *data, uint32 len);
 gtype_value *get_ith_gtype_value_from_container(gtype_container *container, uint32 i);
 gtype_value *push_gtype_value(gtype_parse_state **pstate, gtype_iterator_token seq, gtype_value *agtval);
 gtype_iterator *gtype_iterator_init(gtype_container *container);
 gtype_iterator_token gtype_iterator_next(gtype_iterator **it, gtype_value *val, bool skip_nested);
 gtype *gtype_value_to_gtype(gtype_value *val);
 bool gtype_deep_contains(gtype_iterator **val, gtype_iterator **m_contained);
+bool equals_gtype_scalar_value(const gtype_value *a, const gtype_value *b);
 void gtype_hash_scalar_value(const gtype_value *scalar_val, uint32 *hash);
 void gtype_hash_scalar_value_extended(const gtype_value *scalar_val, uint64 *hash, uint64 seed);
 Datum get_numeric_datum_from_gtype_value(gtype_value *agtv);
@@ -671,6 +687,7 @@ Datum gtype_to_float8(PG_FUNCTION_ARGS);
     (GetSysCacheOid2(TYPENAMENSP, Anum_pg_type_oid, CStringGetDatum("_gtype"), ObjectIdGetDatum(postgraph_namespace_id())))
 
 Datum gtype_object_field_impl(FunctionCallInfo fcinfo, gtype *gtype_in, char *key, int key_len, bool as_text);
+Datum gtype_field_access_impl(FunctionCallInfo fcinfo, gtype *gtype_in, gtype *key);
 
 void gtype_put_escaped_value(StringInfo out, gtype_value *scalar_val);
 
@@ -22,6 +22,7 @@
 
 #include "utils/gtype.h"
 #include "utils/global_graph.h"
+#include "utils/variable_edge.h"
 
 /*
  * We declare the path_container here, and in this way, so that it may be
@@ -36,4 +37,37 @@ typedef struct path_container path_container;
  */
 gtype_value *agtv_materialize_vle_path(gtype *agt_arg_vpc);
 
+/*
+ * The edge label filter of a path finding function, resolved to the label
+ * tables it matches, so edges are checked by comparing Oids.
+ */
+typedef struct label_filter
+{
+    bool active;                   // false if every label matches
+    Oid *oids;                     // label tables matched, sorted
+    int oid_cnt;
+} label_filter;
+
+// a key of the edge property constraint and the scalar it must equal
+typedef struct property_probe
+{
+    gtype_value key;
+    gtype_value value;
+} property_probe;
+
+// the edge property constraint of a path finding function, compiled
+typedef struct property_filter
+{
+    gtype *properties;             // the constraint, NULL if there is none
+    int key_cnt;                   // number of keys in the constraint
+    property_probe *probes;        // the keys with scalar values
+    int probe_cnt;
+    bool has_containers;           // some values are objects or lists
+} property_filter;
+
+// helper functions shared by the path finding functions
+void build_label_filter(label_filter *filter, Oid graph_oid, char *label_name);
+void build_property_filter(property_filter *filter, gtype *properties);
+bool check_edge_constraints(graph_context *ggctx, int64 edge_index, Oid label_oid, label_filter *labels, property_filter *properties);
+
 #endif
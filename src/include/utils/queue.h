@@ -20,48 +20,67 @@
 
 #include "utils/graphid.h"
 
-#define IS_GRAPHID_STACK_EMPTY(queue) \
-            queue_size(queue) == 0
-#define PEEK_GRAPHID_STACK(queue) \
-            (graphid) get_graphid(peek_queue_head(queue))
+#define IS_GRAPHID_STACK_EMPTY(stack) \
+            ((stack)->size == 0)
+#define PEEK_GRAPHID_STACK(stack) \
+            peek_graphid_stack(stack)
 
-// declare the QueueNode 
-typedef struct QueueNode QueueNode;
+/*
+ * A stack of graphids (int64), also used for vertex and edge indexes, kept in
+ * one array that doubles when it is full. Pushing and popping don't allocate,
+ * other than to grow the array.
+ */
+typedef struct graphid_stack
+{
+    graphid *ids;                  // the entries, bottom first
+    int64 size;                    // number of entries
+    int64 capacity;                // allocated entries
+} graphid_stack;
 
-// declare the Queue container 
-typedef struct Queue Queue;
+// create a new, empty, graphid stack
+graphid_stack *new_graphid_stack(void);
+// free a graphid stack and its entries
+void free_graphid_stack(graphid_stack *stack);
+// double the capacity of a graphid stack
+void grow_graphid_stack(graphid_stack *stack);
 
-// QueueNode access functions 
-QueueNode *next_queue_node(QueueNode *queuenode);
-graphid get_graphid(QueueNode *queuenode);
+// push a graphid onto the top of the stack
+static inline void push_graphid_stack(graphid_stack *stack, graphid id)
+{
+    if (stack->size == stack->capacity)
+        grow_graphid_stack(stack);
 
-// graphid queue functions 
-// create a new Queue queue 
-Queue *new_graphid_queue(void);
-// free a Queue queue 
-void free_graphid_queue(Queue *queue);
-// push a graphid onto a Queue queue 
-void push_graphid_queue(Queue *queue, graphid id);
-// pop (remove) a QueueNode from the top of the queue 
-graphid pop_graphid_queue(Queue *queue);
-// peek (doesn't remove) at the head entry of a Queue queue 
-QueueNode *peek_queue_head(Queue *queue);
-// peek (doesn't remove) at the tail entry of a Queue queue 
-QueueNode *peek_queue_tail(Queue *queue);
-// return the size of a Queue queue 
-int64 queue_size(Queue *queue);
+    stack->ids[stack->size++] = id;
+}
 
-// graphid list functions 
-/*
- * Helper function to add a graphid to the end of a Queue container.
- * If the container is NULL, it creates the container with the entry.
- */
-Queue *append_graphid(Queue *container, graphid id);
-// free a Queue container 
-void free_queue(Queue *container);
-// return a reference to the head entry of a list 
-QueueNode *get_list_head(Queue *list);
-// get the size of the passed list 
-int64 get_list_size(Queue *list);
+// pop (remove) the graphid from the top of the stack
+static inline graphid pop_graphid_stack(graphid_stack *stack)
+{
+    if (stack->size <= 0)
+        elog(ERROR, "pop_graphid_stack: empty stack");
+
+    return stack->ids[--stack->size];
+}
+
+// peek (doesn't remove) at the graphid on the top of the stack
+static inline graphid peek_graphid_stack(graphid_stack *stack)
+{
+    if (stack->size <= 0)
+        elog(ERROR, "peek_graphid_stack: empty stack");
+
+    return stack->ids[stack->size - 1];
+}
+
+// return the size of the stack
+static inline int64 graphid_stack_size(graphid_stack *stack)
+{
+    return stack->size;
+}
+
+// remove all entries, keeping the array for reuse
+static inline void reset_graphid_stack(graphid_stack *stack)
+{
+    stack->size = 0;
+}
 
 #endif
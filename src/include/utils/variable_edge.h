@@ -36,7 +36,7 @@
 #include "utils/graphid.h"
 
 /* Convenience macros */
-#define DATUM_GET_VARIABLE_EDGE(d) ((vertex *)PG_DETOAST_DATUM(d))
+#define DATUM_GET_VARIABLE_EDGE(d) ((VariableEdge *)PG_DETOAST_DATUM(d))
 #define VARIABLE_EDGE_GET_DATUM(p) PointerGetDatum(p)
 #define AG_GET_ARG_VARIABLE_EDGE(x) DATUM_GET_VARIABLE_EDGE(PG_GETARG_DATUM(x))
 #define AG_RETURN_VARIABLE_EDGE(x) PG_RETURN_POINTER(x)
@@ -55,6 +55,33 @@ typedef struct
     prentry children[FLEXIBLE_ARRAY_MEMBER];
 } VariableEdge;
 
+/*
+ * The variable_edges returned by the path finding functions are compact: they
+ * hold the graph oid and the graphids of the path, from its start vertex to
+ * its end vertex, rather than the edges and vertices themselves. children[0]
+ * is the number of edges and interior vertices, flagged as compact. The edges
+ * and vertices are only built, from the graph's cached image or from the
+ * label tables, when something needs their properties.
+ */
+#define VARIABLE_EDGE_COMPACT 0x80000000
+
+#define VARIABLE_EDGE_SIZE(ve) \
+    ((ve)->children[0] & ~VARIABLE_EDGE_COMPACT)
+
+#define IS_COMPACT_VARIABLE_EDGE(ve) \
+    (((ve)->children[0] & VARIABLE_EDGE_COMPACT) != 0)
+
+#define EXTRACT_COMPACT_VARIABLE_EDGE_GRAPH_OID(ve) \
+    ((Oid)(ve)->children[1])
+
+// the graphids of the path, 0 is the start vertex
+#define EXTRACT_COMPACT_VARIABLE_EDGE_PATH(ve) \
+    ((graphid *)(&(ve)->children[2]))
+
+VariableEdge *create_compact_variable_edge(Oid graph_oid, graphid *graphid_array, int graphid_array_size);
+VariableEdge *materialize_variable_edge(VariableEdge *ve);
+graphid *extract_variable_edge_ids(VariableEdge *ve);
+
 #define VARIABLEEDGEOID \
     (GetSysCacheOid2(TYPENAMENSP, Anum_pg_type_oid, CStringGetDatum("variable_edge"), ObjectIdGetDatum(postgraph_namespace_id())))
 